@@ -10,12 +10,75 @@
 
 import { FrictionRidgeMetadataExplorerVersion } from './version.min.js';
 import { FRME_EXPLANATIONS } from './frme_explanations.min.js';
+import { DecodePool } from './frme_decode_pool.min.js';
+import { findCachedDigest, loadCachedPixels, loadCachedTransaction,
+    storeCachedPixels, storeCachedTransaction } from
+    './frme_transaction_cache.min.js';
+
+/** Largest width or height of an image at 100% zoom */
+const DISPLAY_DIMENSION = 500
+
+/** Zoom levels offered, as multiples of DISPLAY_DIMENSION */
+const ZOOM_LEVELS = [1, 2, 4]
+
+/** Farthest the cursor may be from a minutia to describe it, in CSS pixels */
+const HOVER_DISTANCE = 8
+
+/** Bytes of displayed images kept as ImageBitmaps, for switching records */
+const BITMAP_CACHE_BUDGET = 64 * 1024 * 1024
+
+/** Value of the point system chooser when no minutiae are drawn */
+const NO_POINT_SYSTEM = -1
+
+/** Names of Module.MinutiaeType values, singular and plural, Other last */
+const MINUTIA_TYPE_NAMES = [["Ridge ending", "ridge endings"],
+    ["Bifurcation", "bifurcations"], ["Core", "cores"], ["Delta", "deltas"],
+    ["Other", "other"]]
 
 var FrictionRidgeMetadataExplorerVars = {
-	records: null,
-	currentRecordNumber: 0
+	// ParseSession, RecordStream, or CachedSession owning everything from
+	// the current file
+	session: null,
+	currentRecordNumber: 0,
+	zoom: 1,
+	// Value of the Module.PointSystem to draw, NO_POINT_SYSTEM, or null
+	// for the first point set of each record
+	pointSystem: null,
+	// Promises of decoded pixels (or null), parallel to session's records
+	decodedImages: [],
+	// Promise of codecs needed to decode session's images on this thread
+	codecsLoaded: Promise.resolve(),
+	// {bitmap, scale, bytes} of images drawn, keyed by record number and
+	// display dimension, least recently drawn first
+	imageBitmaps: new Map(),
+	imageBitmapBytes: 0,
+	// PointSetCopy arrays of records parsed, by record number
+	recordPointSets: new Map(),
+	// {pointSets, scale} of the image drawn, for redrawing the overlay
+	overlay: null,
+	// Minutiae drawn on the overlay, indexed for hit-testing, or null
+	hoverPoints: null,
+	// Latest mouse event over the canvas, until the next frame handles it
+	pendingPointer: null,
+	// Image coordinates where a selection began, while dragging, or null
+	selectionStart: null,
+	// Recent client and WebAssembly phases, for the diagnostics panel
+	phases: [],
+	// Name and size of the current file, for the diagnostics report
+	fileInfo: null,
+	// Files being summarized together, if several were opened
+	batch: null
 }
 
+/** Workers decoding images off of the main thread, if supported */
+var decodePool = null
+
+/** URL of the WebAssembly module's JavaScript */
+var moduleScriptURL = null
+
+/** Promises of codec side modules loaded (or loading), by file name */
+var codecModules = new Map()
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
@@ -35,11 +98,59 @@ export function removeHighlight(event)
 	event.target.classList.remove('highlight');
 }
 
-export function drop(event)
+export async function drop(event)
 {
 	event.preventDefault();
-	attachFileInput(event.dataTransfer);
 	removeHighlight(event);
+	openFiles(await getDroppedFiles(event.dataTransfer));
+}
+
+/**
+ * @brief
+ * Obtain every file dropped, including those within dropped directories.
+ *
+ * @param dataTransfer
+ * DataTransfer from a drop event.
+ *
+ * @return
+ * Promise of an Array of File.
+ */
+async function getDroppedFiles(dataTransfer)
+{
+	// Entries must be obtained before the drop event handler returns
+	var entries = []
+	for (const item of dataTransfer.items ?? []) {
+		const entry = (item.kind === 'file' &&
+		    typeof item.webkitGetAsEntry === 'function') ?
+		    item.webkitGetAsEntry() : null
+		if (entry === null)
+			return (Array.from(dataTransfer.files))
+		entries.push(entry)
+	}
+	if (entries.length == 0)
+		return (Array.from(dataTransfer.files))
+
+	var files = []
+	while (entries.length > 0) {
+		const entry = entries.shift()
+		if (entry.isFile) {
+			files.push(await new Promise((resolve, reject) =>
+			    entry.file(resolve, reject)))
+		} else if (entry.isDirectory) {
+			// Directories are listed a block of entries at a time
+			const reader = entry.createReader()
+			for (;;) {
+				const block = await new Promise(
+				    (resolve, reject) =>
+				    reader.readEntries(resolve, reject))
+				if (block.length == 0)
+					break
+				entries.push(...block)
+			}
+		}
+	}
+
+	return (files)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -102,10 +213,13 @@ function pointSystemName(ps)
 	}
 }
 
-/** Remove uploaded file at `path` */
-function removeUpload(path)
+/**
+ * @return
+ * true if point system `ps` is present in `summary` (Module.RecordSummary)
+ */
+function hasPointSystem(summary, ps)
 {
-	FS.unlink(path);
+	return ((summary.pointSystems & (1 << ps.value)) != 0)
 }
 
 /** Display the version number on the page. */
@@ -257,10 +371,10 @@ function generateModalWithLink(link_text, headline, body,
 /** Hides the "No Image" image */
 function removeImagePlaceholder()
 {
-	// Un-hide the canvas
-	var canvas = document.getElementById("decoded_image")
-	if (canvas.classList.contains("d-none"))
-		canvas.classList.remove("d-none")
+	// Un-hide the canvases
+	var layers = document.getElementById("image_layers")
+	if (layers.classList.contains("d-none"))
+		layers.classList.remove("d-none")
 
 	// Remove the placeholder image
 	var placeholder = document.getElementById("placeholderRect")
@@ -271,10 +385,10 @@ function removeImagePlaceholder()
 /** Shows the "No Image" image */
 function addImagePlaceholder()
 {
-	// Hide the canvas
-	var canvas = document.getElementById("decoded_image")
-	if (!canvas.classList.contains("d-none"))
-		canvas.classList.add("d-none")
+	// Hide the canvases
+	var layers = document.getElementById("image_layers")
+	if (!layers.classList.contains("d-none"))
+		layers.classList.add("d-none")
 
 	// Add placeholder image
 	if (document.getElementById('placeholderRect'))
@@ -302,6 +416,50 @@ function addImagePlaceholder()
 	imageCol.prepend(placeholder)
 }
 
+/******************************************************************************
+ * Image download
+ ******************************************************************************/
+
+/** Shows or hides the link to download the displayed image */
+function showDownloadLink(visible)
+{
+	var link = document.getElementById("downloadImage")
+	if (visible)
+		link.classList.remove("d-none")
+	else if (!link.classList.contains("d-none"))
+		link.classList.add("d-none")
+}
+
+/** Save the currently-displayed image as a PNG file */
+export function downloadCurrentImage(event)
+{
+	event.preventDefault()
+
+	if (FrictionRidgeMetadataExplorerVars.session == null)
+		return
+
+	const recordNumber = FrictionRidgeMetadataExplorerVars.
+	    currentRecordNumber
+	const record = FrictionRidgeMetadataExplorerVars.session.getRecord(
+	    recordNumber)
+	if (!record.image.containsImage())
+		return
+
+	// Size matters more than speed for a file the user keeps
+	const start = beginPhase('Encoding PNG for download')
+	const png = record.image.getPNG(Module.getPNGEncodingForArchival())
+	endPhase('Encoding PNG for download', start)
+	collectProfile()
+
+	const url = URL.createObjectURL(new Blob([png], {type: "image/png"}))
+	var link = document.createElement("a")
+	link.href = url
+	link.download = "frme-image-" + (recordNumber + 1) + ".png"
+	link.click()
+	// Revoking during click() can cancel the download
+	setTimeout(() => URL.revokeObjectURL(url), 0)
+}
+
 /******************************************************************************
  * Offline alert dialog
  ******************************************************************************/
@@ -335,15 +493,69 @@ export function onInitialPageLoad()
 	showVersion()
 }
 
+/**
+ * @brief
+ * Decode images using workers running the WebAssembly module.
+ *
+ * @param moduleScript
+ * URL of the WebAssembly module's JavaScript.
+ * @param wasmModule
+ * Promise of the compiled WebAssembly.Module, shared with the workers.
+ */
+export function setModuleScript(moduleScript, wasmModule = null)
+{
+	moduleScriptURL = moduleScript
+
+	if (typeof Worker === 'undefined')
+		return
+
+	if (decodePool !== null)
+		decodePool.terminate()
+	decodePool = new DecodePool(moduleScript, wasmModule)
+}
+
+/**
+ * @brief
+ * Log the WASM heap's size and use, to check that memory is reused from file
+ * to file rather than growing.
+ *
+ * @param when
+ * Description of the point at which statistics were taken.
+ */
+function logHeapStatistics(when)
+{
+	const heap = Module.getHeapStatistics()
+	if (!heap.available) {
+		console.debug("Heap " + when + ": unavailable")
+		return
+	}
+	console.debug("Heap " + when + ": " + heap.allocatedBytes +
+	    " bytes allocated, " + heap.freeBytes + " free, " +
+	    heap.heapSize + " heap (high-water mark " + heap.peakFootprint +
+	    ")")
+}
+
 /** Reset interface to unused state */
 function resetInterface()
 {
-	FrictionRidgeMetadataExplorerVars.records = null;
+	// Release everything parsed from the previous file at once
+	if (FrictionRidgeMetadataExplorerVars.session !== null) {
+		FrictionRidgeMetadataExplorerVars.session.delete()
+		logHeapStatistics("after releasing file")
+	}
+	FrictionRidgeMetadataExplorerVars.session = null;
+	FrictionRidgeMetadataExplorerVars.fileInfo = null;
 	FrictionRidgeMetadataExplorerVars.currentRecordNumber = 0;
+	FrictionRidgeMetadataExplorerVars.decodedImages = [];
+	FrictionRidgeMetadataExplorerVars.codecsLoaded = Promise.resolve();
+	FrictionRidgeMetadataExplorerVars.recordPointSets.clear();
+	clearImageBitmaps();
+	clearOverlay();
 
 	document.getElementById("file_selector").value = null;
 
 	document.getElementById('decoded_image').height = 0;
+	showDownloadLink(false);
 
 	document.getElementById("results_container").classList.
 	    add("d-none");
@@ -357,6 +569,14 @@ function resetInterface()
 	var recordNumberBlock = document.getElementById("recordNumberBlock");
 	while (recordNumberBlock.firstChild)
 		recordNumberBlock.removeChild(recordNumberBlock.firstChild)
+
+	var zoomBlock = document.getElementById("zoomBlock");
+	while (zoomBlock.firstChild)
+		zoomBlock.removeChild(zoomBlock.firstChild)
+
+	var pointSystemBlock = document.getElementById("pointSystemBlock");
+	while (pointSystemBlock.firstChild)
+		pointSystemBlock.removeChild(pointSystemBlock.firstChild)
 }
 
 /**
@@ -386,73 +606,352 @@ function resizeTo(canvas,pct){
  *
  * @param ctx
  * canvas 2d context
- * @param points
- * WASM std::vector<PointShim>
+ * @param pointSet
+ * WASM PointSet
+ *
+ * @note
+ * Points are read through views of WASM memory, so nothing may call into WASM
+ * between obtaining the views and finishing drawing.
  */
-function drawMinutiae(ctx, points)
+function drawMinutiae(ctx, pointSet)
 {
 	const radius = 4
 	const halfRadius = radius / 2
+	const length = 12
+	const deg2Rad = Math.PI / 180
+
+	const xs = pointSet.getX()
+	const ys = pointSet.getY()
+	const angles = pointSet.getAngle()
+	const types = pointSet.getType()
+
+	// One path of dots and one of angles per color, drawn in a few passes
+	const ridgeEnding = Module.MinutiaeType.RidgeEnding.value
+	const bifurcation = Module.MinutiaeType.Bifurcation.value
+	const other = Module.MinutiaeType.Other.value
+	const layers = [
+	    {color: "rgba(255, 0, 0, 0.5)", dots: new Path2D(),
+	        angles: new Path2D()},
+	    {color: "rgba(0, 0, 255, 0.5)", dots: new Path2D(),
+	        angles: new Path2D()},
+	    {color: "rgba(255, 165, 0, 0.5)", dots: new Path2D(),
+	        angles: new Path2D()},
+	    {color: "rgba(0, 255, 0, 0.5)", dots: new Path2D(), angles: null}]
+
+	for (var i = 0; i < xs.length; ++i) {
+		var layer = layers[3]
+		if (types[i] == ridgeEnding)
+			layer = layers[0]
+		else if (types[i] == bifurcation)
+			layer = layers[1]
+		else if (types[i] == other)
+			layer = layers[2]
+
+		const cx = xs[i] - halfRadius
+		const cy = ys[i] - halfRadius
+
+		layer.dots.moveTo(cx + radius, cy)
+		layer.dots.arc(cx, cy, radius, 0, 2 * Math.PI)
 
-	function deg2Rad(d) { return (d * (Math.PI / 180)) }
-
-	for (var i = 0; i < points.size(); ++i) {
-		const p = points.get(i)
-		var drawAngle = true;
-		ctx.beginPath()
-		if (p.type == Module.MinutiaeType.RidgeEnding) {
-			ctx.fillStyle = "rgba(255, 0, 0, 0.5)"
-			ctx.strokeStyle = "rgba(255, 0, 0, 0.5)"
-		} else if (p.type == Module.MinutiaeType.Bifurcation) {
-			ctx.fillStyle = "rgba(0, 0, 255, 0.5)"
-			ctx.strokeStyle = "rgba(0, 0, 255, 0.5)"
-		} else {
-			ctx.fillStyle = "rgba(0, 255, 0, 0.5)"
-			ctx.strokeStyle = "rgba(0, 255, 0, 0.5)"
-			drawAngle = false;
+		// Angle
+		if (layer.angles !== null) {
+			const theta = -angles[i] * deg2Rad
+			layer.angles.moveTo(cx, cy)
+			layer.angles.lineTo(cx + (length * Math.cos(theta)),
+			    cy + (length * Math.sin(theta)))
+		}
+	}
+
+	for (const layer of layers) {
+		ctx.fillStyle = layer.color
+		ctx.fill(layer.dots)
+		if (layer.angles !== null) {
+			ctx.strokeStyle = layer.color
+			ctx.stroke(layer.angles)
 		}
+	}
+}
+
+/**
+ * @brief
+ * Draw fingerprint image, leaving minutiae to the overlay
+ *
+ * @param canvas
+ * canvas to draw on (will be resized)
+ * @param context
+ * canvas 2d context
+ * @param image
+ * WASM ImageShim
+ * @param pixels
+ * {level, width, height, rgba} already decoded by DecodePool, or null to
+ * decode `image` now
+ *
+ * @return
+ * Canvas pixels per full resolution image pixel
+ *
+ * @note
+ * Draws the smallest pyramid level of `image` that covers the display size,
+ * rather than drawing full resolution and scaling it down.
+ */
+function drawImageLayer(canvas, context, image, pixels = null)
+{
+	const maxDimension = getDisplayDimension()
 
-		const cx = p.x - halfRadius;
-		const cy = p.y - halfRadius;
+	showDownloadLink(true)
 
-		ctx.arc(cx, cy, radius, 0, 2 * Math.PI)
-		ctx.fill()
+	var level = 0
+	if (pixels !== null) {
+		level = pixels.level
+		canvas.width = pixels.width
+		canvas.height = pixels.height
+		context.putImageData(new ImageData(pixels.rgba, pixels.width,
+		    pixels.height), 0, 0)
+	} else {
+		level = image.getPyramidLevelForSize(maxDimension)
+
+		// Pixels are a view of WASM memory, so copy them to the canvas
+		// before calling back into WASM (which could grow memory and
+		// detach the view)
+		const rgba = image.getRGBAPixels(level)
+		const imageData = new ImageData(new Uint8ClampedArray(
+		    rgba.buffer, rgba.byteOffset, rgba.length),
+		    image.getPyramidLevelWidth(level),
+		    image.getPyramidLevelHeight(level))
+		canvas.width = imageData.width
+		canvas.height = imageData.height
+		context.putImageData(imageData, 0, 0)
+	}
 
-		// Angle
-		if (drawAngle) {
-			const length = 12;
-			ctx.beginPath();
-			ctx.moveTo(cx, cy);
-			ctx.lineTo(
-			    cx + (length * Math.cos(deg2Rad(-p.angle))),
-			    cy + (length * Math.sin(deg2Rad(-p.angle))));
-			ctx.stroke();
+	// Points are full resolution
+	var scale = 1 / (1 << level)
+
+	const width = canvas.width
+	const height = canvas.height
+	if (width > maxDimension || height > maxDimension) {
+		resizeTo(canvas, 0.01 * (100 / (Math.max(width, height) /
+		    maxDimension)))
+		scale *= canvas.width / width
+	}
+
+	return (scale)
+}
+
+/**
+ * @brief
+ * Draw an image's point sets on the overlay, and offer to choose between
+ * them.
+ *
+ * @param pointSets
+ * PointSetCopy of each point set of the image drawn.
+ * @param scale
+ * Canvas pixels per full resolution image pixel.
+ */
+function showPointSets(pointSets, scale)
+{
+	FrictionRidgeMetadataExplorerVars.overlay = {pointSets: pointSets,
+	    scale: scale}
+	configurePointSystemChooser(pointSets)
+	drawOverlay()
+}
+
+/**
+ * @brief
+ * Draw the chosen point set on the overlay, sized to match the image.
+ *
+ * @note
+ * The image itself is not redrawn, so changing point systems is cheap.
+ */
+function drawOverlay()
+{
+	const overlay = FrictionRidgeMetadataExplorerVars.overlay
+	const canvas = document.getElementById("decoded_image")
+	var overlayCanvas = document.getElementById("minutiae_overlay")
+
+	// Resizing also clears
+	overlayCanvas.width = (overlay === null) ? 0 : canvas.width
+	overlayCanvas.height = (overlay === null) ? 0 : canvas.height
+	if (overlay === null) {
+		clearHoverPoints()
+		return
+	}
+
+	const points = choosePointSet(overlay.pointSets)
+	if (points !== null) {
+		console.debug("Drawing minutia points for " +
+		    pointSystemName(points.system))
+		var ctx = overlayCanvas.getContext("2d")
+		ctx.save()
+		ctx.scale(overlay.scale, overlay.scale)
+		drawMinutiae(ctx, points)
+		ctx.restore()
+	}
+	setHoverPoints(points, overlay.scale)
+}
+
+/** Remove minutiae from the overlay */
+function clearOverlay()
+{
+	FrictionRidgeMetadataExplorerVars.overlay = null
+	drawOverlay()
+}
+
+/**
+ * @return
+ * Point set of `pointSets` in the chosen point system (or the first, if none
+ * is in that system), or null if none are to be drawn.
+ */
+function choosePointSet(pointSets)
+{
+	const chosen = FrictionRidgeMetadataExplorerVars.pointSystem
+	if (pointSets.length == 0 || chosen === NO_POINT_SYSTEM)
+		return (null)
+
+	const found = pointSets.find((ps) => ps.system.value === chosen)
+	return ((found === undefined) ? pointSets[0] : found)
+}
+
+/**
+ * @brief
+ * Obtain every point set of a record, copied out of WASM memory.
+ *
+ * @param session
+ * ParseSession, RecordStream, or CachedSession holding the record.
+ * @param recordNumber
+ * The record in `session`.
+ *
+ * @return
+ * Array of PointSetCopy, converted once per record (or read from the
+ * transaction cache, if `session` has not been parsed).
+ */
+function getRecordPointSets(session, recordNumber)
+{
+	var pointSets = FrictionRidgeMetadataExplorerVars.recordPointSets.
+	    get(recordNumber)
+	if (pointSets !== undefined)
+		return (pointSets)
+
+	if (session instanceof CachedSession && session.session === null) {
+		pointSets = session.getCachedRecord(recordNumber).pointSets.map(
+		    (values) => new PointSetCopy(values))
+	} else {
+		const record = session.getRecord(recordNumber)
+		const allPointSets = Module.getAllPointSets(record.image,
+		    record.minutiaeDataRecords)
+		pointSets = []
+		for (let i = 0; i < allPointSets.size(); ++i) {
+			const pointSet = allPointSets.get(i)
+			pointSets.push(copyPointSet(pointSet))
+			pointSet.delete()
 		}
+		allPointSets.delete()
 	}
+
+	// Records streamed before their Type-9 records have no minutiae yet
+	if (session instanceof Module.RecordStream &&
+	    !session.hasMinutiaeData())
+		return (pointSets)
+
+	FrictionRidgeMetadataExplorerVars.recordPointSets.set(recordNumber,
+	    pointSets)
+	return (pointSets)
+}
+
+/** @return Key of a record's image in imageBitmaps at the current zoom */
+function getBitmapKey(recordNumber)
+{
+	return (recordNumber + ":" + getDisplayDimension())
+}
+
+/**
+ * @brief
+ * Keep the image just drawn, so returning to the record draws it without
+ * decoding or scaling it again.
+ *
+ * @param session
+ * Session holding the record.
+ * @param recordNumber
+ * The record in `session` drawn.
+ * @param canvas
+ * Canvas the image was drawn on, without minutiae.
+ * @param scale
+ * Canvas pixels per full resolution image pixel.
+ *
+ * @note
+ * createImageBitmap() copies the canvas before returning, so the canvas may
+ * be drawn over while the bitmap is prepared.
+ */
+function cacheImageBitmap(session, recordNumber, canvas, scale)
+{
+	if (typeof createImageBitmap === 'undefined' || canvas.width == 0 ||
+	    canvas.height == 0)
+		return
+
+	const key = getBitmapKey(recordNumber)
+	createImageBitmap(canvas).then((bitmap) => {
+		// Another file was opened while waiting
+		if (session !== FrictionRidgeMetadataExplorerVars.session) {
+			bitmap.close()
+			return
+		}
+		storeImageBitmap(key, {bitmap: bitmap, scale: scale,
+		    bytes: 4 * bitmap.width * bitmap.height})
+	}).catch((e) => console.debug("Could not keep bitmap: " + e))
 }
 
-/** Draw fingerprint image and minutia overtop (if any) */
-function drawImageThenMinutiae(canvas, context, points)
+/**
+ * @brief
+ * Add a bitmap to imageBitmaps, closing least recently drawn bitmaps until
+ * within BITMAP_CACHE_BUDGET.
+ *
+ * @param key
+ * Key from getBitmapKey().
+ * @param entry
+ * {bitmap, scale, bytes}.
+ */
+function storeImageBitmap(key, entry)
 {
-	const MAX_DIMENSION = 500
+	var bitmaps = FrictionRidgeMetadataExplorerVars.imageBitmaps
+	if (entry.bytes > BITMAP_CACHE_BUDGET) {
+		entry.bitmap.close()
+		return
+	}
 
-	var image = new Image();
-	image.onload = function() {
-		canvas.width = image.width
-		canvas.height = image.height
+	const previous = bitmaps.get(key)
+	if (previous !== undefined) {
+		bitmaps.delete(key)
+		previous.bitmap.close()
+		FrictionRidgeMetadataExplorerVars.imageBitmapBytes -=
+		    previous.bytes
+	}
+
+	bitmaps.set(key, entry)
+	FrictionRidgeMetadataExplorerVars.imageBitmapBytes += entry.bytes
 
-		context.drawImage(image, 0, 0, image.width, image.height, 0, 0,
-		    canvas.width, canvas.height);
-		if (points != null)
-			drawMinutiae(context, points)
+	// Maps iterate in insertion order, so the oldest come first
+	for (const [oldKey, old] of bitmaps) {
+		if (FrictionRidgeMetadataExplorerVars.imageBitmapBytes <=
+		    BITMAP_CACHE_BUDGET)
+			break
+		bitmaps.delete(oldKey)
+		old.bitmap.close()
+		FrictionRidgeMetadataExplorerVars.imageBitmapBytes -= old.bytes
+	}
+}
 
-		if (image.width > MAX_DIMENSION || image.height > MAX_DIMENSION)
-			resizeTo(canvas, 0.01 * (100 /
-			    (Math.max(image.width, image.height) /
-			    MAX_DIMENSION)))
-	};
+/** Close every bitmap kept by cacheImageBitmap() */
+function clearImageBitmaps()
+{
+	for (const entry of FrictionRidgeMetadataExplorerVars.imageBitmaps.
+	    values())
+		entry.bitmap.close()
+	FrictionRidgeMetadataExplorerVars.imageBitmaps.clear()
+	FrictionRidgeMetadataExplorerVars.imageBitmapBytes = 0
+}
 
-	return image;
+/** @return Largest width or height to display an image at */
+function getDisplayDimension()
+{
+	return (DISPLAY_DIMENSION * FrictionRidgeMetadataExplorerVars.zoom)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -470,19 +969,26 @@ function configureRecordNumberChooser()
 	while (recordNumberBlock.firstChild)
 		recordNumberBlock.removeChild(recordNumberBlock.firstChild)
 
+	// Records still being read are counted, but can't be chosen yet
+	const session = FrictionRidgeMetadataExplorerVars.session
+	const recordCount = session.getRecordCount()
+	const expectedCount = (session instanceof Module.RecordStream) ?
+	    session.getExpectedRecordCount() : recordCount
+
 	// Don't need this to display if there's only a single record
-	if (FrictionRidgeMetadataExplorerVars.records.size() == 1)
+	if (expectedCount == 1)
 		return;
 
 	var select = document.createElement("select");
 	select.id = "recordNumberSelector"
 	select.addEventListener("change", updateRecordNumber);
 
-	for (var i = 1; i <= FrictionRidgeMetadataExplorerVars.records.size();
-	    ++i) {
+	for (var i = 1; i <= recordCount; ++i) {
 		var option = document.createElement("option")
 		option.value = i
 		option.text = i
+		option.selected = ((i - 1) ==
+		    FrictionRidgeMetadataExplorerVars.currentRecordNumber)
 		select.appendChild(option)
 	}
 	select.classList.add("form-select")
@@ -499,8 +1005,7 @@ function configureRecordNumberChooser()
 	span2.appendChild(select)
 
 	var span3 = document.createElement("span")
-	span3.textContent += " of " +
-	    FrictionRidgeMetadataExplorerVars.records.size()
+	span3.textContent += " of " + expectedCount
 	span3.classList.add("small")
 
 	recordNumberBlock.appendChild(span1)
@@ -508,6 +1013,113 @@ function configureRecordNumberChooser()
 	recordNumberBlock.appendChild(span3)
 }
 
+/** Builds an HTML element that changes the size images are displayed at */
+function configureZoomChooser()
+{
+	var zoomBlock = document.getElementById("zoomBlock");
+	while (zoomBlock.firstChild)
+		zoomBlock.removeChild(zoomBlock.firstChild)
+
+	var select = document.createElement("select");
+	select.id = "zoomSelector"
+	select.addEventListener("change", updateZoom);
+
+	for (const zoom of ZOOM_LEVELS) {
+		var option = document.createElement("option")
+		option.value = zoom
+		option.text = (zoom * 100) + "%"
+		option.selected =
+		    (zoom == FrictionRidgeMetadataExplorerVars.zoom)
+		select.appendChild(option)
+	}
+	select.classList.add("form-select")
+	select.classList.add("form-select-sm")
+	// Bootstrap style for select is 100% block
+	select.style["display"] = "inline";
+	select.style["width"] = "unset";
+
+	var span1 = document.createElement("span")
+	span1.textContent = "Zoom "
+	span1.classList.add("small")
+
+	var span2 = document.createElement("span")
+	span2.appendChild(select)
+
+	zoomBlock.appendChild(span1)
+	zoomBlock.appendChild(span2)
+}
+
+/**
+ * @brief
+ * Offer to choose which of an image's point sets is drawn.
+ *
+ * @param pointSets
+ * PointSetCopy of each point set of the image drawn.
+ */
+function configurePointSystemChooser(pointSets)
+{
+	var pointSystemBlock = document.getElementById("pointSystemBlock");
+	while (pointSystemBlock.firstChild)
+		pointSystemBlock.removeChild(pointSystemBlock.firstChild)
+	if (pointSets.length == 0)
+		return
+
+	var select = document.createElement("select");
+	select.id = "pointSystemSelector"
+	select.addEventListener("change", updatePointSystem);
+
+	const drawn = choosePointSet(pointSets)
+	for (const pointSet of pointSets) {
+		var option = document.createElement("option")
+		option.value = pointSet.system.value
+		option.text = pointSystemName(pointSet.system)
+		option.selected = (pointSet === drawn)
+		select.appendChild(option)
+	}
+	var none = document.createElement("option")
+	none.value = NO_POINT_SYSTEM
+	none.text = "None"
+	none.selected = (drawn === null)
+	select.appendChild(none)
+
+	select.classList.add("form-select")
+	select.classList.add("form-select-sm")
+	// Bootstrap style for select is 100% block
+	select.style["display"] = "inline";
+	select.style["width"] = "unset";
+
+	var span1 = document.createElement("span")
+	span1.textContent = "Minutiae "
+	span1.classList.add("small")
+
+	var span2 = document.createElement("span")
+	span2.appendChild(select)
+
+	pointSystemBlock.appendChild(span1)
+	pointSystemBlock.appendChild(span2)
+}
+
+/** Triggered when the point system popover is changed */
+function updatePointSystem()
+{
+	FrictionRidgeMetadataExplorerVars.pointSystem =
+	    parseInt(document.getElementById("pointSystemSelector").value)
+	console.debug("Changing to point system " +
+	    FrictionRidgeMetadataExplorerVars.pointSystem)
+	drawOverlay()
+}
+
+/** Triggered when the zoom popover is changed */
+function updateZoom()
+{
+	FrictionRidgeMetadataExplorerVars.zoom =
+	    parseInt(document.getElementById("zoomSelector").value)
+	console.debug("Changing to zoom " +
+	    FrictionRidgeMetadataExplorerVars.zoom)
+	displayRecords(FrictionRidgeMetadataExplorerVars.session,
+	    FrictionRidgeMetadataExplorerVars.currentRecordNumber)
+}
+
 /** Triggered when the image selection popover is changed */
 function updateRecordNumber()
 {
@@ -515,30 +1127,82 @@ function updateRecordNumber()
 	    parseInt(document.getElementById("recordNumberSelector").value) - 1
 	console.debug("Changing to record number " +
 	    FrictionRidgeMetadataExplorerVars.currentRecordNumber)
-	displayRecords(FrictionRidgeMetadataExplorerVars.records,
+	displayRecords(FrictionRidgeMetadataExplorerVars.session,
 	    FrictionRidgeMetadataExplorerVars.currentRecordNumber)
 }
 
 /**
  * @brief
- * Display a record from a set of records
+ * Display a record from a parsed file
  *
- * @param records
- * Set of records [(image, metadata) pairs]
+ * @param session
+ * ParseSession, RecordStream, or CachedSession holding (image, metadata) pairs
  * @param recordNumber
- * The element in `records` to display
+ * The record in `session` to display
  *
  * @seealso displayRecord()
  */
-function displayRecords(records, recordNumber)
+async function displayRecords(session, recordNumber)
 {
 	console.log("About to display record #" + recordNumber)
-	displayRecord(records.get(recordNumber));
+
+	if (displayRecordFromBitmap(session, recordNumber))
+		return
+	if (session instanceof CachedSession &&
+	    await displayCachedRecord(session, recordNumber))
+		return
+
+	var pixels = null
+	const decoded = FrictionRidgeMetadataExplorerVars.
+	    decodedImages[recordNumber]
+	try {
+		await FrictionRidgeMetadataExplorerVars.codecsLoaded
+	} catch (e) {
+		// Decoding will fail and report which image
+		console.debug("Could not load codec: " + e)
+	}
+	if (decoded != null) {
+		// Failures are decoded again, on this thread, for the message
+		pixels = await decoded.catch(() => null)
+	}
+
+	// Another record or file was chosen while waiting
+	if (session !== FrictionRidgeMetadataExplorerVars.session ||
+	    recordNumber !=
+	    FrictionRidgeMetadataExplorerVars.currentRecordNumber)
+		return
+
+	// Larger levels than the worker sent are decoded on this thread
+	const record = session.getRecord(recordNumber)
+	if (pixels !== null && pixels.level >
+	    record.image.getPyramidLevelForSize(getDisplayDimension()))
+		pixels = null
+
+	displayRecord(session, recordNumber, pixels);
+	collectProfile()
+
+	const stats = Module.getImageCacheStatistics()
+	console.debug("Image cache: " + stats.entries + " images, " +
+	    stats.bytes + "/" + stats.budget + " bytes (peak " +
+	    stats.peakBytes + "), " + stats.hits + " hits, " + stats.misses +
+	    " misses, " + stats.evictions + " evictions")
 }
 
-/** Draws the image from `record` on the page */
-function displayRecord(record)
+/**
+ * @brief
+ * Draws the image from a record on the page, with its minutiae on the overlay
+ *
+ * @param session
+ * ParseSession, RecordStream, or CachedSession holding the record
+ * @param recordNumber
+ * The record in `session` to display
+ * @param pixels
+ * {level, width, height, rgba} already decoded by DecodePool, or null
+ */
+function displayRecord(session, recordNumber, pixels = null)
 {
+	const record = session.getRecord(recordNumber)
+
 	// Grab the canvas, and have it draw images when applied
 	var canvas = document.getElementById("decoded_image");
 	var ctx = canvas.getContext("2d");
@@ -549,108 +1213,320 @@ function displayRecord(record)
 		if (!record.image.containsImage()) {
 			console.debug("Hiding image for min-only record")
 			addImagePlaceholder()
+			showDownloadLink(false)
+			clearOverlay()
+			configurePointSystemChooser([])
 			return;
 		} else {
 			removeImagePlaceholder();
 		}
-
-		const allPointSets = Module.getAllPoints(record.image, minRecs);
-		if (allPointSets.size() != 0) {
-			console.debug("Drawing minutia points for " +
-			    pointSystemName(allPointSets.get(0).system))
-
-			var image = drawImageThenMinutiae(canvas, ctx,
-			    allPointSets.get(0).points);
-			image.src = record.image.getBase64PNG(true);
-		} else {
-			console.debug("No minutiae in point sets to draw")
-
-			var image = drawImageThenMinutiae(canvas, ctx, null);
-			image.src = record.image.getBase64PNG(true);
-		}
 	} else {
 		console.debug("No min data records to draw")
-		var image = drawImageThenMinutiae(canvas, ctx, null);
-		image.src = record.image.getBase64PNG(true);
 	}
-}
-
-////////////////////////////////////////////////////////////////////////////////
-////////////////////////////////////////////////////////////////////////////////
-////////////////////////////////////////////////////////////////////////////////
 
-/******************************************************************************
- * Summary generators
- ******************************************************************************/
+	const scale = drawImageLayer(canvas, ctx, record.image, pixels)
+	cacheImageBitmap(session, recordNumber, canvas, scale)
+	showPointSets(getRecordPointSets(session, recordNumber), scale)
+}
 
 /**
  * @brief
- * Summarize the fingerprint metadata encodings into an interface element.
+ * Draw a record from the bitmap kept when it was last drawn at this zoom.
+ *
+ * @param session
+ * Session holding the record.
+ * @param recordNumber
+ * The record in `session` to display.
  *
  * @return
- * "Card" that can be added to the DOM.
+ * true if the record was drawn, false if no bitmap was kept for it.
+ *
+ * @note
+ * Only the overlay is drawn anew, from point sets already copied out of WASM
+ * memory, so switching between records viewed before decodes nothing.
  */
-function generateSummaryText(an2k)
+function displayRecordFromBitmap(session, recordNumber)
 {
-	const legacyIcon = "sunset";
-	const warningIcon = "dash-circle";
-	const errorIcon = "exclamation-triangle";
-	const goodIcon = "check-circle";
+	var bitmaps = FrictionRidgeMetadataExplorerVars.imageBitmaps
+	const key = getBitmapKey(recordNumber)
+	const entry = bitmaps.get(key)
+	if (entry === undefined)
+		return (false)
 
-	const proprietaryPointTypes = [Module.PointSystem.IAFIS,
-	    Module.PointSystem.Cogent,
-	    Module.PointSystem.Motorola,
-	    Module.PointSystem.Sagem,
-	    Module.PointSystem.NEC,
-	    Module.PointSystem.Other,
-	    Module.PointSystem.Identix];
+	// Now the most recently drawn
+	bitmaps.delete(key)
+	bitmaps.set(key, entry)
 
-	const hasEFS = Module.hasMinutiaeDataFormat(an2k,
-	    Module.PointSystem.EFS)
-	const hasLegacy = Module.hasMinutiaeDataFormat(an2k,
-	    Module.PointSystem.Legacy)
-	const hasM1 = Module.hasMinutiaeDataFormat(an2k,
-	    Module.PointSystem.M1)
-	const hasOpen = hasLegacy || hasM1 || hasEFS;
-	const hasLessDesirableOpen = hasLegacy || hasM1;
+	console.debug("Drawing record #" + recordNumber + " from bitmap")
+	var canvas = document.getElementById("decoded_image")
+	canvas.width = entry.bitmap.width
+	canvas.height = entry.bitmap.height
+	canvas.getContext("2d").drawImage(entry.bitmap, 0, 0)
+	removeImagePlaceholder()
+	showDownloadLink(true)
+	showPointSets(getRecordPointSets(session, recordNumber), entry.scale)
+
+	return (true)
+}
 
-	var hasProprietary = false;
-	for (let i = 0; i < proprietaryPointTypes.length; ++i) {
-		if (Module.hasMinutiaeDataFormat(an2k,
-		    proprietaryPointTypes[i])) {
-			hasProprietary = true
-			break
+/**
+ * @brief
+ * Draw a record entirely from the transaction cache.
+ *
+ * @param session
+ * CachedSession holding the record.
+ * @param recordNumber
+ * The record in `session` to display.
+ *
+ * @return
+ * true if the record was drawn (or another was chosen meanwhile), false if
+ * its pixels at this zoom aren't cached and it must be drawn from `session`'s
+ * parsed records instead.
+ */
+async function displayCachedRecord(session, recordNumber)
+{
+	const record = session.getCachedRecord(recordNumber)
+	var pixels = undefined
+	if (record.hasImage) {
+		try {
+			pixels = await loadCachedPixels(session.digest,
+			    recordNumber, getDisplayDimension())
+		} catch (e) {
+			console.debug("Could not load cached pixels: " + e)
 		}
 	}
 
-	const hasFRImages = Module.hasFrictionRidgeImagery(an2k)
-	const hasFRMetadata = hasProprietary || hasOpen
+	// Another record or file was chosen while waiting
+	if (session !== FrictionRidgeMetadataExplorerVars.session ||
+	    recordNumber !=
+	    FrictionRidgeMetadataExplorerVars.currentRecordNumber)
+		return (true)
 
-	//----------------------------------------------------------------------
+	if (pixels === undefined) {
+		// Parse now, so codecs load while waiting in displayRecords()
+		session.open()
+		return (false)
+	}
 
-	var content_type = ""
-	if (hasProprietary) {
-		if (hasOpen) {
-			content_type = "proprietary_and_open"
-		} else {
-			content_type = "proprietary"
-		}
-	} else if (hasEFS) {
-		if (hasLessDesirableOpen) {
-			content_type = "efs_and_legacy"
-		} else {
-			content_type = "efs"
-		}
-	} else if (hasLessDesirableOpen) {
-		content_type = "other_open"
-	} else {
-		if (hasFRImages) {
-			content_type = "image"
-		} else {
-			content_type = "unknown"
-		}
+	console.debug("Drawing record #" + recordNumber + " from cache")
+	var canvas = document.getElementById("decoded_image")
+	var ctx = canvas.getContext("2d")
+	ctx.clearRect(0, 0, canvas.width, canvas.height)
+	removeImagePlaceholder()
+	const scale = drawImageLayer(canvas, ctx, null, pixels)
+	cacheImageBitmap(session, recordNumber, canvas, scale)
+	showPointSets(getRecordPointSets(session, recordNumber), scale)
+
+	return (true)
+}
+
+/******************************************************************************
+ * Minutia hover and selection
+ ******************************************************************************/
+
+/**
+ * @brief
+ * Make drawn minutiae available to hover over and select.
+ *
+ * @param points
+ * PointSetCopy drawn on the overlay, or null.
+ * @param scale
+ * Canvas pixels per image pixel.
+ */
+function setHoverPoints(points, scale)
+{
+	clearHoverPoints()
+	if (points === null || points.size() == 0)
+		return
+
+	// Already copied out of WASM memory, so safe to keep
+	var hoverPoints = {system: points.system, x: points.getX(),
+	    y: points.getY(), angle: points.getAngle(),
+	    type: points.getType(), scale: scale}
+	hoverPoints.index = Module.PointIndex.fromCoordinates(hoverPoints.x,
+	    hoverPoints.y)
+	FrictionRidgeMetadataExplorerVars.hoverPoints = hoverPoints
+}
+
+/** Forget minutiae drawn, and hide their description */
+function clearHoverPoints()
+{
+	const hoverPoints = FrictionRidgeMetadataExplorerVars.hoverPoints
+	if (hoverPoints !== null)
+		hoverPoints.index.delete()
+	FrictionRidgeMetadataExplorerVars.hoverPoints = null
+	FrictionRidgeMetadataExplorerVars.selectionStart = null
+	hideMinutiaTooltip()
+}
+
+/**
+ * @return
+ * {x, y, scale}, where x and y are the image coordinates under mouse `event`
+ * on the canvas, and scale is CSS pixels per image pixel.
+ */
+function getImageCoordinates(event, hoverPoints)
+{
+	const canvas = event.target
+	const scale = hoverPoints.scale * canvas.clientWidth / canvas.width
+	return ({x: Math.max(0, Math.round(event.offsetX / scale)),
+	    y: Math.max(0, Math.round(event.offsetY / scale)), scale: scale})
+}
+
+/** @return Description of minutia `i` of `hoverPoints` */
+function describeMinutia(hoverPoints, i)
+{
+	const other = MINUTIA_TYPE_NAMES.length - 1
+	return (MINUTIA_TYPE_NAMES[Math.min(hoverPoints.type[i], other)][0] +
+	    ", " +
+	    hoverPoints.angle[i] + "\u00B0, " +
+	    pointSystemName(hoverPoints.system) + " (" + hoverPoints.x[i] +
+	    ", " + hoverPoints.y[i] + ")")
+}
+
+/** @return Description of the minutiae of `hoverPoints` between two points */
+function describeSelection(hoverPoints, start, end)
+{
+	const selected = hoverPoints.index.query(Math.min(start.x, end.x),
+	    Math.min(start.y, end.y), Math.max(start.x, end.x),
+	    Math.max(start.y, end.y))
+
+	// Counted by type
+	const other = MINUTIA_TYPE_NAMES.length - 1
+	var counts = new Array(MINUTIA_TYPE_NAMES.length).fill(0)
+	for (const i of selected)
+		++counts[Math.min(hoverPoints.type[i], other)]
+
+	var parts = []
+	MINUTIA_TYPE_NAMES.forEach((names, type) => {
+		if (counts[type] > 0)
+			parts.push(counts[type] + " " + names[1])
+	})
+
+	return (selected.length + " selected" + ((parts.length > 0) ?
+	    " (" + parts.join(", ") + ")" : ""))
+}
+
+/** Show `text` beside the cursor of mouse `event` on the canvas */
+function showMinutiaTooltip(event, text)
+{
+	var tooltip = document.getElementById("minutia_tooltip")
+	tooltip.textContent = text
+	tooltip.style.left = (event.target.offsetLeft + event.offsetX + 12) +
+	    "px"
+	tooltip.style.top = (event.target.offsetTop + event.offsetY + 12) +
+	    "px"
+	tooltip.classList.remove("d-none")
+}
+
+/** Hide the description of minutiae */
+function hideMinutiaTooltip()
+{
+	var tooltip = document.getElementById("minutia_tooltip")
+	if (!tooltip.classList.contains("d-none"))
+		tooltip.classList.add("d-none")
+}
+
+/**
+ * @brief
+ * Describe the minutia under the cursor, or the minutiae being selected.
+ *
+ * @note
+ * Runs at most once per frame, however often the mouse moves.
+ */
+function updateMinutiaTooltip()
+{
+	const event = FrictionRidgeMetadataExplorerVars.pendingPointer
+	const hoverPoints = FrictionRidgeMetadataExplorerVars.hoverPoints
+	FrictionRidgeMetadataExplorerVars.pendingPointer = null
+	// Already handled (e.g., by endSelection())
+	if (event === null)
+		return
+	if (hoverPoints === null) {
+		hideMinutiaTooltip()
+		return
 	}
 
+	const location = getImageCoordinates(event, hoverPoints)
+	const start = FrictionRidgeMetadataExplorerVars.selectionStart
+	if (start !== null) {
+		showMinutiaTooltip(event, describeSelection(hoverPoints, start,
+		    location))
+		return
+	}
+
+	const i = hoverPoints.index.nearest(location.x, location.y,
+	    Math.ceil(HOVER_DISTANCE / location.scale))
+	if (i < 0)
+		hideMinutiaTooltip()
+	else
+		showMinutiaTooltip(event, describeMinutia(hoverPoints, i))
+}
+
+/** Triggered when the mouse moves over the image */
+export function hoverOverImage(event)
+{
+	if (FrictionRidgeMetadataExplorerVars.pendingPointer === null)
+		requestAnimationFrame(updateMinutiaTooltip)
+	FrictionRidgeMetadataExplorerVars.pendingPointer = event
+}
+
+/** Triggered when the mouse leaves the image */
+export function leaveImage(event)
+{
+	FrictionRidgeMetadataExplorerVars.pendingPointer = null
+	FrictionRidgeMetadataExplorerVars.selectionStart = null
+	hideMinutiaTooltip()
+}
+
+/** Triggered when a mouse button is pressed over the image */
+export function startSelection(event)
+{
+	const hoverPoints = FrictionRidgeMetadataExplorerVars.hoverPoints
+	if (hoverPoints === null || event.button != 0)
+		return
+
+	event.preventDefault()
+	FrictionRidgeMetadataExplorerVars.selectionStart =
+	    getImageCoordinates(event, hoverPoints)
+}
+
+/** Triggered when a mouse button is released over the image */
+export function endSelection(event)
+{
+	const start = FrictionRidgeMetadataExplorerVars.selectionStart
+	if (start === null)
+		return
+
+	// A click describes the minutia under it, as hovering does
+	const end = getImageCoordinates(event,
+	    FrictionRidgeMetadataExplorerVars.hoverPoints)
+	if (end.x == start.x && end.y == start.y)
+		FrictionRidgeMetadataExplorerVars.selectionStart = null
+
+	// The description of the selection stays until the mouse moves
+	FrictionRidgeMetadataExplorerVars.pendingPointer = event
+	updateMinutiaTooltip()
+	FrictionRidgeMetadataExplorerVars.selectionStart = null
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+/******************************************************************************
+ * Summary generators
+ ******************************************************************************/
+
+/**
+ * @brief
+ * Summarize the fingerprint metadata encodings into an interface element.
+ *
+ * @return
+ * "Card" that can be added to the DOM.
+ */
+function generateSummaryText(summary)
+{
+	const content_type = getContentType(summary)
 	const color = FRME_EXPLANATIONS.short[content_type].color
 	const icon = FRME_EXPLANATIONS.short[content_type].icon
 	const header = FRME_EXPLANATIONS.short[content_type].header
@@ -699,6 +1575,68 @@ function generateSummaryText(an2k)
 	return (card)
 }
 
+/**
+ * @brief
+ * Categorize the friction ridge metadata in a transaction.
+ *
+ * @param summary
+ * Module.RecordSummary of the transaction.
+ *
+ * @return
+ * Key of FRME_EXPLANATIONS.short describing the transaction.
+ */
+function getContentType(summary)
+{
+	const proprietaryPointTypes = [Module.PointSystem.IAFIS,
+	    Module.PointSystem.Cogent,
+	    Module.PointSystem.Motorola,
+	    Module.PointSystem.Sagem,
+	    Module.PointSystem.NEC,
+	    Module.PointSystem.Other,
+	    Module.PointSystem.Identix];
+
+	const hasEFS = hasPointSystem(summary, Module.PointSystem.EFS)
+	const hasLegacy = hasPointSystem(summary, Module.PointSystem.Legacy)
+	const hasM1 = hasPointSystem(summary, Module.PointSystem.M1)
+	const hasOpen = hasLegacy || hasM1 || hasEFS;
+	const hasLessDesirableOpen = hasLegacy || hasM1;
+
+	var hasProprietary = false;
+	for (let i = 0; i < proprietaryPointTypes.length; ++i) {
+		if (hasPointSystem(summary, proprietaryPointTypes[i])) {
+			hasProprietary = true
+			break
+		}
+	}
+
+	const hasFRImages = summary.hasFrictionRidgeImagery
+
+	var content_type = ""
+	if (hasProprietary) {
+		if (hasOpen) {
+			content_type = "proprietary_and_open"
+		} else {
+			content_type = "proprietary"
+		}
+	} else if (hasEFS) {
+		if (hasLessDesirableOpen) {
+			content_type = "efs_and_legacy"
+		} else {
+			content_type = "efs"
+		}
+	} else if (hasLessDesirableOpen) {
+		content_type = "other_open"
+	} else {
+		if (hasFRImages) {
+			content_type = "image"
+		} else {
+			content_type = "unknown"
+		}
+	}
+
+	return (content_type)
+}
+
 /**
  * @brief
  * Summarize the fingerprint metadata encodings into an HTMLtable.
@@ -706,7 +1644,7 @@ function generateSummaryText(an2k)
  * @return
  * Table that can be added to the DOM.
  */
-function generatePointSystemTypeTable(an2k)
+function generatePointSystemTypeTable(summary)
 {
 	const pointTypes = [Module.PointSystem.Legacy,
 	    Module.PointSystem.IAFIS,
@@ -727,24 +1665,20 @@ function generatePointSystemTypeTable(an2k)
 	    Module.PointSystem.Identix,
 	    Module.PointSystem.Other];
 
-	const hasEFS = Module.hasMinutiaeDataFormat(an2k,
-	    Module.PointSystem.EFS)
-	const hasLegacy = Module.hasMinutiaeDataFormat(an2k,
-	    Module.PointSystem.Legacy)
-	const hasM1 = Module.hasMinutiaeDataFormat(an2k,
-	    Module.PointSystem.M1)
+	const hasEFS = hasPointSystem(summary, Module.PointSystem.EFS)
+	const hasLegacy = hasPointSystem(summary, Module.PointSystem.Legacy)
+	const hasM1 = hasPointSystem(summary, Module.PointSystem.M1)
 	const hasOpen = hasLegacy || hasM1 || hasEFS;
 
 	var hasProprietary = false;
 	for (let i = 0; i < proprietaryPointTypes.length; ++i) {
-		if (Module.hasMinutiaeDataFormat(an2k,
-		    proprietaryPointTypes[i])) {
+		if (hasPointSystem(summary, proprietaryPointTypes[i])) {
 			hasProprietary = true
 			break
 		}
 	}
 
-	const hasFRImages = Module.hasFrictionRidgeImagery(an2k)
+	const hasFRImages = summary.hasFrictionRidgeImagery
 	const hasFRMetadata = hasProprietary || hasOpen
 
 	var table = document.createElement("table");
@@ -772,7 +1706,7 @@ function generatePointSystemTypeTable(an2k)
 		td.appendChild(document.createTextNode(pointSystemName(type)));
 		td = tr.insertCell();
 
-		const hasType = Module.hasMinutiaeDataFormat(an2k, type)
+		const hasType = hasPointSystem(summary, type)
 		td.appendChild(document.createTextNode(hasType ? "Yes" : "No"));
 
 		var styles = FRME_EXPLANATIONS.table.proprietary.omitted;
@@ -918,97 +1852,1145 @@ function generateModalForExplanationWithLink(link_text, explanation,
 ////////////////////////////////////////////////////////////////////////////////
 
 /*******************************************************************************
- * File upload
+ * Diagnostics
 *******************************************************************************/
 
-/** On file upload, process and display the record */
-export function attachFileInput(fileInput) {
-	const uploadedImageFileName = 'UPLOAD';
-	const uploadedFilePath = '/' + uploadedImageFileName;
+/** Most phases retained for the diagnostics panel */
+const MAX_DIAGNOSTIC_PHASES = 512
 
-	if (fileInput.files.length == 0)
-		return;
-	var file = fileInput.files[0];
-
-	var fr = new FileReader();
-	fr.onload = function () {
-		resetInterface();
-
-		// Save the file
-		const data = new Uint8Array(fr.result);
-		FS.createDataFile('/', uploadedImageFileName, data, true,
-		    false, true);
-
-		// Check if it is ANSI/NIST-ITL
-		if (!Module.AN2K.isAN2K(uploadedFilePath)) {
-			removeUpload(uploadedFilePath);
-			alert("This file does not appear to be formatted as " +
-			    "ANSI/NIST-ITL.");
-			return;
-		}
+/** Prefix of performance timeline entries created here */
+const PERFORMANCE_PREFIX = "frme:"
 
-		// Try to parse the file
-		try {
-			console.time('Parsing ANSI/NIST-ITL file');
-			var an2k = new Module.AN2K(uploadedFilePath);
-			console.timeEnd('Parsing ANSI/NIST-ITL file');
-		} catch (e) {
-			removeUpload(uploadedFilePath);
-			alertException(e);
-			return;
-		}
+/**
+ * @brief
+ * Start timing a client-side phase.
+ *
+ * @param name
+ * Name of the phase.
+ *
+ * @return
+ * Start time, to pass to endPhase().
+ */
+function beginPhase(name)
+{
+	console.time(name)
+	return (performance.now())
+}
 
-		var statusMessage = document.getElementById('status_message')
-		statusMessage.appendChild(generateSummaryText(an2k))
-		statusMessage.appendChild(document.createElement("br"))
-		statusMessage.appendChild(generatePointSystemTypeTable(an2k))
-
-		// Enable popovers (after adding table to the DOM)
-		const popoverTriggerList =
-		    document.querySelectorAll('[data-bs-toggle="popover"]')
-		const popoverList = [...popoverTriggerList].map(
-		    popoverTriggerEl => new bootstrap.Popover(popoverTriggerEl))
-		const tooltipTriggerList =
-		    document.querySelectorAll('[data-bs-toggle="tooltip"]')
-		const tooltipList = [...tooltipTriggerList].map(
-		    tooltipTriggerEl => new bootstrap.Tooltip(tooltipTriggerEl))
-
-		console.time('Parsing records');
-		try {
-			FrictionRidgeMetadataExplorerVars.records =
-			    Module.getFrictionRidgeImagesWithMinutiaeData(an2k);
-		} catch (e) {
-			an2k.delete()
-			removeUpload(uploadedFilePath)
-			alertException(e);
-			return;
-		}
-		console.timeEnd('Parsing records');
-		an2k.delete();
-		removeUpload(uploadedFilePath)
+/**
+ * @brief
+ * Finish timing a client-side phase.
+ *
+ * @param name
+ * Name of the phase, as passed to beginPhase().
+ * @param start
+ * Value returned from beginPhase().
+ */
+function endPhase(name, start)
+{
+	console.timeEnd(name)
+	recordPhase({source: "js", name: name, depth: 0, start: start,
+	    duration: performance.now() - start, bytes: 0, allocations: 0})
+}
 
-		console.debug(FrictionRidgeMetadataExplorerVars.records.size() +
-		    " elements")
+/**
+ * @brief
+ * Add a phase to the performance timeline and the diagnostics panel.
+ *
+ * @param phase
+ * {source, name, depth, start, duration, bytes, allocations}, with times in
+ * milliseconds on the performance.now() clock.
+ */
+function recordPhase(phase)
+{
+	try {
+		performance.measure(PERFORMANCE_PREFIX + phase.name, {
+		    start: phase.start, duration: phase.duration,
+		    detail: {source: phase.source, bytes: phase.bytes,
+		    allocations: phase.allocations}})
+	} catch (e) {
+		// User Timing Level 3 unsupported; the panel still has it
+	}
 
-		if (FrictionRidgeMetadataExplorerVars.records.size() > 0) {
-			removeImagePlaceholder()
+	var phases = FrictionRidgeMetadataExplorerVars.phases
+	phases.push(phase)
+	if (phases.length > MAX_DIAGNOSTIC_PHASES)
+		phases.splice(0, phases.length - MAX_DIAGNOSTIC_PHASES)
+}
 
-			console.time('Updating display');
-			displayRecord(FrictionRidgeMetadataExplorerVars.records.
-			    get(FrictionRidgeMetadataExplorerVars.
-			    currentRecordNumber));
-			configureRecordNumberChooser()
-			console.timeEnd('Updating display');
-		} else {
-			addImagePlaceholder();
+/**
+ * @brief
+ * Move spans recorded by the WebAssembly module onto the performance
+ * timeline and into the diagnostics panel.
+ */
+function collectProfile()
+{
+	const spans = Module.getProfile()
+	for (var i = 0; i < spans.size(); ++i) {
+		const span = spans.get(i)
+		recordPhase({source: "wasm", name: span.name, depth: span.depth,
+		    start: span.start, duration: span.duration,
+		    bytes: span.bytes, allocations: span.allocations})
+	}
+	spans.delete()
+	Module.clearProfile()
+
+	updateDiagnostics()
+}
+
+/** @return true if the page was asked to show diagnostics */
+function diagnosticsRequested()
+{
+	return (new URLSearchParams(window.location.search).has("diagnostics"))
+}
+
+/** @return Report of recent phases and memory use, for slow-file reports */
+function generateDiagnosticReport()
+{
+	return ({
+	    version: FrictionRidgeMetadataExplorerVersion,
+	    userAgent: navigator.userAgent,
+	    file: FrictionRidgeMetadataExplorerVars.fileInfo,
+	    heap: Module.getHeapStatistics(),
+	    imageCache: Module.getImageCacheStatistics(),
+	    phases: FrictionRidgeMetadataExplorerVars.phases})
+}
+
+/** Refresh the diagnostics panel, if shown */
+function updateDiagnostics()
+{
+	if (!diagnosticsRequested())
+		return
+
+	var container = document.getElementById("diagnostics_container")
+	while (container.classList.contains("d-none"))
+		container.classList.remove("d-none")
+
+	var tbody = document.getElementById("diagnostics_phases")
+	while (tbody.firstChild)
+		tbody.removeChild(tbody.firstChild)
+
+	for (const phase of FrictionRidgeMetadataExplorerVars.phases) {
+		var tr = document.createElement("tr")
+		const cells = [phase.source,
+		    "\u00a0".repeat(2 * phase.depth) + phase.name,
+		    phase.duration.toFixed(2), phase.bytes, phase.allocations]
+		for (const cell of cells) {
+			var td = document.createElement("td")
+			td.textContent = cell
+			tr.appendChild(td)
 		}
+		tbody.appendChild(tr)
+	}
+
+	const heap = Module.getHeapStatistics()
+	const cache = Module.getImageCacheStatistics()
+	const heapText = !heap.available ? "unavailable" :
+	    heap.allocatedBytes + " bytes allocated, " + heap.freeBytes +
+	    " free, " + heap.heapSize + " total (high-water mark " +
+	    heap.peakFootprint + ")"
+	document.getElementById("diagnostics_memory").textContent =
+	    "Heap: " + heapText + ". Image cache: " + cache.bytes +
+	    "/" + cache.budget + " bytes, " + cache.hits + " hits, " +
+	    cache.misses + " misses, " + cache.evictions + " evictions."
+}
+
+/** Copy the diagnostic report to the clipboard */
+export function copyDiagnostics(event)
+{
+	event.preventDefault()
+
+	const report = JSON.stringify(generateDiagnosticReport(), null, 1)
+	const copied = (navigator.clipboard === undefined) ?
+	    Promise.reject(new Error("No clipboard")) :
+	    navigator.clipboard.writeText(report)
+	copied.catch((e) => {
+		// Saved as a file, since release builds strip console calls
+		const url = URL.createObjectURL(new Blob([report],
+		    {type: "text/plain"}))
+		var link = document.createElement("a")
+		link.href = url
+		link.download = "frme-diagnostics.txt"
+		link.click()
+		// Revoking during click() can cancel the download
+		setTimeout(() => URL.revokeObjectURL(url), 0)
+
+		alert("Could not copy to the clipboard, so the report was " +
+		    "downloaded instead.")
+	})
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+/*******************************************************************************
+ * Batch summary
+*******************************************************************************/
 
+/**
+ * @brief
+ * Summarize a file on the main thread, when workers aren't available.
+ *
+ * @param file
+ * File containing an ANSI/NIST-ITL transaction.
+ *
+ * @return
+ * Promise of the file's Module.RecordSummary.
+ */
+async function summarizeFileOnMainThread(file)
+{
+	const transaction = await readTransactionBuffer(file)
+	var an2k = null
+	try {
+		if (!Module.AN2K.isAN2K(transaction))
+			throw new Error("Not formatted as ANSI/NIST-ITL")
+
+		an2k = new Module.AN2K(transaction)
+		return (Module.getRecordSummary(an2k))
+	} catch (e) {
+		const msg = getExceptionMessageString(e)
+		throw ((msg === null) ? e : new Error(msg))
+	} finally {
+		transaction.delete()
+		if (an2k !== null)
+			an2k.delete()
+	}
+}
+
+/**
+ * @brief
+ * Summarize files, a few at a time.
+ *
+ * @param files
+ * Array of File.
+ * @param onSummary
+ * Called with (index, summary, error) as each file finishes, where exactly
+ * one of summary and error is null.
+ *
+ * @return
+ * Promise resolved once every file has finished.
+ *
+ * @note
+ * Only as many files as there are decode workers (or one, without workers)
+ * are read at once, so memory does not grow with the number of files.
+ */
+async function summarizeFiles(files, onSummary)
+{
+	const report = (i, p) => p.then((summary) => onSummary(i, summary,
+	    null), (e) => onSummary(i, null, e))
+
+	if (decodePool !== null) {
+		await Promise.all(files.map((file, i) =>
+		    report(i, decodePool.summarize(file))))
+	} else {
+		for (let i = 0; i < files.length; ++i)
+			await report(i, summarizeFileOnMainThread(files[i]))
+	}
+}
+
+/** @return Human-readable size of `bytes` */
+function formatFileSize(bytes)
+{
+	if (bytes < 1024)
+		return (bytes + " B")
+	if (bytes < 1024 * 1024)
+		return ((bytes / 1024).toFixed(1) + " KiB")
+	return ((bytes / (1024 * 1024)).toFixed(1) + " MiB")
+}
+
+/** @return Names of point systems present in `summary`, comma-separated */
+function getPointSystemNames(summary)
+{
+	var names = []
+	for (const ps of Object.values(Module.PointSystem))
+		if (hasPointSystem(summary, ps))
+			names.push(pointSystemName(ps))
+
+	return ((names.length == 0) ? "None" : names.join(", "))
+}
+
+/**
+ * @brief
+ * Fill in a batch table row with a file's summary.
+ *
+ * @param row
+ * HTMLTableRowElement created by attachFiles().
+ * @param summary
+ * Module.RecordSummary, or null if the file could not be summarized.
+ * @param error
+ * Error thrown while summarizing, if `summary` is null.
+ */
+function updateBatchRow(row, summary, error)
+{
+	const cells = row.cells
+
+	if (summary === null) {
+		cells[2].classList.add("text-danger")
+		cells[2].colSpan = 4
+		cells[2].textContent = (error instanceof Error) ?
+		    error.message : String(error)
+		while (row.cells.length > 3)
+			row.deleteCell(3)
+		return
+	}
+
+	const content_type = getContentType(summary)
+	const explanation = FRME_EXPLANATIONS.short[content_type]
+	cells[2].innerHTML = '<span class="text-' + explanation.color +
+	    '-emphasis"><i class="bi bi-' + explanation.icon + '"></i> ' +
+	    explanation.header + '</span>'
+	cells[3].textContent = summary.fingerFixedResolutionCount +
+	    summary.fingerCaptureCount + summary.palmCount +
+	    summary.latentCount
+	cells[4].textContent = summary.minutiaeDataRecordCount
+	cells[5].textContent = getPointSystemNames(summary)
+}
+
+/** Hide the batch summary and stop summarizing its files */
+function resetBatch()
+{
+	FrictionRidgeMetadataExplorerVars.batch = null
+	if (decodePool !== null)
+		decodePool.cancelSummaries()
+
+	document.getElementById("batch_container").classList.add("d-none")
+	const body = document.getElementById("batch_files")
+	while (body.firstChild)
+		body.removeChild(body.firstChild)
+}
+
+/**
+ * @brief
+ * Summarize several files in a table, filled in as each file finishes.
+ *
+ * @param files
+ * Array of File.
+ */
+async function attachFiles(files)
+{
+	resetInterface()
+	resetBatch()
+
+	const batch = {files: files, completed: 0}
+	FrictionRidgeMetadataExplorerVars.batch = batch
+
+	const status = document.getElementById("batch_status")
+	const updateStatus = () => {
+		status.textContent = batch.completed + " of " + files.length +
+		    " files summarized"
+	}
+	updateStatus()
+
+	var rows = []
+	const body = document.getElementById("batch_files")
+	for (const file of files) {
+		const row = body.insertRow()
+		const open = document.createElement('a')
+		open.href = "#"
+		open.textContent = file.webkitRelativePath || file.name
+		open.addEventListener('click', (e) => {
+			e.preventDefault()
+			attachFile(file)
+		})
+		row.insertCell().appendChild(open)
+		row.insertCell().textContent = formatFileSize(file.size)
+		row.insertCell().innerHTML =
+		    '<span class="text-body-tertiary">Queued</span>'
+		for (let i = 0; i < 3; ++i)
+			row.insertCell()
+		rows.push(row)
+	}
+	document.getElementById("batch_container").classList.remove("d-none")
+
+	const start = beginPhase('Summarizing ' + files.length + ' files')
+	await summarizeFiles(files, (i, summary, error) => {
+		// A newer batch may have replaced this one
+		if (batch !== FrictionRidgeMetadataExplorerVars.batch)
+			return
+
+		updateBatchRow(rows[i], summary, error)
+		++batch.completed
+		updateStatus()
+	})
+	if (batch === FrictionRidgeMetadataExplorerVars.batch)
+		endPhase('Summarizing ' + files.length + ' files', start)
+}
+
+/******************************************************************************
+ * Transaction cache
+ ******************************************************************************/
+
+/**
+ * @brief
+ * Point set copied out of WASM memory (or read from the transaction cache),
+ * drawn like a Module.PointSet.
+ */
+class PointSetCopy {
+	/**
+	 * @param values
+	 * {system, x, y, angle, type}, where system is the value of a
+	 * Module.PointSystem and the rest are typed arrays.
+	 */
+	constructor(values)
+	{
+		this.system = Object.values(Module.PointSystem).find(
+		    (ps) => ps.value == values.system)
+		this.values = values
+	}
+
+	size() { return (this.values.x.length) }
+	getX() { return (this.values.x) }
+	getY() { return (this.values.y) }
+	getAngle() { return (this.values.angle) }
+	getType() { return (this.values.type) }
+}
+
+/** @return PointSetCopy of Module.PointSet `pointSet` */
+function copyPointSet(pointSet)
+{
+	// slice() copies out of WASM memory
+	return (new PointSetCopy({system: pointSet.system.value,
+	    x: pointSet.getX().slice(), y: pointSet.getY().slice(),
+	    angle: pointSet.getAngle().slice(),
+	    type: pointSet.getType().slice()}))
+}
+
+/**
+ * @brief
+ * Transaction displayed from the transaction cache.
+ *
+ * @details
+ * Summary, point sets, and pixels come from the cache. The transaction is
+ * parsed only if something else is needed (pixels at an uncached zoom, or an
+ * image to download), after which this behaves like the session parsed.
+ */
+class CachedSession {
+	/**
+	 * @param digest
+	 * SHA-256 digest of the transaction.
+	 * @param cached
+	 * Entry from loadCachedTransaction().
+	 * @param transaction
+	 * Module.TransactionBuffer holding the transaction. Owned (and
+	 * deleted) by this session.
+	 */
+	constructor(digest, cached, transaction)
+	{
+		this.digest = digest
+		this.cached = cached
+		this.transaction = transaction
+		this.session = null
+	}
+
+	getRecordCount() { return (this.cached.records.length) }
+	getRecordSummary() { return (this.cached.summary) }
+
+	/** @return {hasImage, pointSets} of a record, from the cache */
+	getCachedRecord(recordNumber)
+	{
+		return (this.cached.records[recordNumber])
+	}
+
+	/** @return (image, metadata) pair, parsing the transaction if needed */
+	getRecord(recordNumber)
+	{
+		return (this.open().getRecord(recordNumber))
+	}
+
+	/**
+	 * @brief
+	 * Parse the transaction the way it was parsed when cached, and start
+	 * decoding its images.
+	 *
+	 * @return
+	 * RecordStream or ParseSession.
+	 */
+	open()
+	{
+		if (this.session !== null)
+			return (this.session)
+
+		const start = beginPhase('Parsing cached ANSI/NIST-ITL file')
+		if (this.cached.streamed) {
+			this.session = new Module.RecordStream(this.transaction)
+			this.session.append(this.transaction.size())
+		} else {
+			this.session = new Module.ParseSession(this.transaction)
+		}
+		endPhase('Parsing cached ANSI/NIST-ITL file', start)
+
+		startDecoding(this.session, this.transaction)
+		cacheDecodedImages(this.digest,
+		    FrictionRidgeMetadataExplorerVars.decodedImages)
+		this.transaction.delete()
+		this.transaction = null
+
+		return (this.session)
+	}
+
+	delete()
+	{
+		if (this.session !== null)
+			this.session.delete()
+		if (this.transaction !== null)
+			this.transaction.delete()
+	}
+}
+
+/**
+ * @brief
+ * Copy what is needed to draw a record into plain objects.
+ *
+ * @param session
+ * Session holding the record, currently displayed.
+ * @param recordNumber
+ * The record in `session`.
+ *
+ * @return
+ * {hasImage, pointSets}, where pointSets holds every point set of the record,
+ * as {system, x, y, angle, type}.
+ *
+ * @note
+ * Point sets already converted for display are reused.
+ */
+function copyRecordForCache(session, recordNumber)
+{
+	return ({hasImage: session.getRecord(recordNumber).image.
+	    containsImage(), pointSets: getRecordPointSets(session,
+	    recordNumber).map((pointSet) => pointSet.values)})
+}
+
+/**
+ * @brief
+ * Store pixels in the transaction cache as the decode pool finishes them.
+ *
+ * @param digest
+ * SHA-256 digest of the transaction.
+ * @param decodedImages
+ * Promises of decoded pixels (or null), by record number.
+ */
+function cacheDecodedImages(digest, decodedImages)
+{
+	decodedImages.forEach((decoded, recordNumber) => {
+		if (decoded === null)
+			return
+		decoded.then((pixels) => storeCachedPixels(digest,
+		    recordNumber, pixels.maxDimension, pixels)).catch((e) =>
+		    console.debug("Could not cache record " +
+		    (recordNumber + 1) + ": " + e))
+	})
+}
+
+/**
+ * @brief
+ * Store what was derived from a transaction, so it is displayed without
+ * parsing or decoding when opened again.
+ *
+ * @param digest
+ * SHA-256 digest of the transaction, or null if it could not be hashed.
+ * @param file
+ * File the transaction was read from.
+ * @param session
+ * ParseSession or RecordStream holding every record of the transaction.
+ * @param streamed
+ * Whether `session` is a RecordStream.
+ *
+ * @note
+ * Call once `session` is displayed, so converting the point sets of every
+ * record doesn't delay drawing the first.
+ */
+function cacheTransaction(digest, file, session, streamed)
+{
+	// Another file was opened while displaying this one
+	if (digest === null ||
+	    session !== FrictionRidgeMetadataExplorerVars.session)
+		return
+
+	var records = []
+	for (let i = 0; i < session.getRecordCount(); ++i)
+		records.push(copyRecordForCache(session, i))
+
+	const decodedImages = FrictionRidgeMetadataExplorerVars.decodedImages
+	storeCachedTransaction(digest, file, {
+	    summary: session.getRecordSummary(), records: records,
+	    streamed: streamed}).then(() =>
+	    cacheDecodedImages(digest, decodedImages)).catch((e) =>
+	    console.debug("Could not cache transaction: " + e))
+}
+
+/**
+ * @brief
+ * Display a transaction from the transaction cache.
+ *
+ * @param digest
+ * SHA-256 digest of the transaction.
+ * @param cached
+ * Entry from loadCachedTransaction().
+ * @param transaction
+ * Module.TransactionBuffer holding the transaction, now owned by the
+ * session.
+ */
+async function displayCachedTransaction(digest, cached, transaction)
+{
+	const session = new CachedSession(digest, cached, transaction)
+	FrictionRidgeMetadataExplorerVars.session = session
+	console.debug("Displaying " + digest + " from cache")
+
+	showRecordSummary(session.getRecordSummary())
+	if (session.getRecordCount() > 0) {
+		removeImagePlaceholder()
+
+		const start = beginPhase('Updating display')
+		configureRecordNumberChooser()
+		configureZoomChooser()
+		await displayRecords(session,
+		    FrictionRidgeMetadataExplorerVars.currentRecordNumber)
+		endPhase('Updating display', start)
+	} else {
+		addImagePlaceholder()
+	}
+
+	showResults()
+	collectProfile()
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+/*******************************************************************************
+ * File upload
+*******************************************************************************/
+
+/** Bytes read from the file at a time */
+const READ_CHUNK_SIZE = 16 * 1024 * 1024;
+
+/**
+ * @brief
+ * Copy a file into WebAssembly memory.
+ *
+ * @param file
+ * File to read.
+ * @param onChunk
+ * Function called with the buffer and the number of bytes read so far after
+ * each chunk is copied, or null.
+ *
+ * @return
+ * Module.TransactionBuffer containing the contents of `file`. Caller must
+ * delete().
+ *
+ * @note
+ * Read in chunks, so the file is never held in full outside of WebAssembly.
+ */
+async function readTransactionBuffer(file, onChunk = null)
+{
+	const buffer = new Module.TransactionBuffer(file.size)
+	try {
+		for (let offset = 0; offset < file.size;
+		    offset += READ_CHUNK_SIZE) {
+			const chunk = new Uint8Array(await file.slice(offset,
+			    offset + READ_CHUNK_SIZE).arrayBuffer())
+			// Obtain a new view each time, in case memory grew
+			buffer.getView().set(chunk, offset)
+			if (onChunk !== null)
+				onChunk(buffer, offset + chunk.length)
+		}
+	} catch (e) {
+		buffer.delete()
+		throw e
+	}
+
+	return (buffer)
+}
+
+/**
+ * @brief
+ * Locate the image records in a transaction.
+ *
+ * @param transaction
+ * Module.TransactionBuffer.
+ *
+ * @return
+ * Map from "type:IDC" to AN2KIndexEntry for each image record, or null if
+ * the transaction could not be indexed.
+ */
+function indexTransaction(transaction)
+{
+	var index = null
+	try {
+		const start = beginPhase('Indexing ANSI/NIST-ITL file')
+		index = new Module.AN2KIndex(transaction)
+		endPhase('Indexing ANSI/NIST-ITL file', start)
+	} catch (e) {
+		// The parser is more forgiving than the index
+		console.debug("Could not index file: " +
+		    getExceptionMessageString(e))
+		return (null)
+	}
+
+	var entries = new Map()
+	for (var i = 0; i < index.getRecordCount(); ++i) {
+		const entry = index.getRecord(i)
+		if (entry.hasImage)
+			entries.set(entry.recordType + ":" + entry.idc, entry)
+	}
+	index.delete()
+
+	return (entries)
+}
+
+/**
+ * @brief
+ * Load a codec side module into this thread's module.
+ *
+ * @param name
+ * File name of the side module, from Module.getCodecModule().
+ *
+ * @return
+ * Promise resolved once the module's decoders can be called.
+ */
+function loadCodecModule(name)
+{
+	if (!codecModules.has(name)) {
+		console.debug("Loading codec module " + name)
+		codecModules.set(name, Module.loadDynamicLibrary(
+		    new URL(name, moduleScriptURL).href,
+		    {loadAsync: true, global: true, nodelete: true}))
+	}
+
+	return (codecModules.get(name))
+}
+
+/**
+ * @brief
+ * Load the codec side modules needed to decode a transaction's images on this
+ * thread, if the module was built with them split out.
+ *
+ * @param entries
+ * Array of AN2KIndexEntry for image records, or null to load every codec.
+ *
+ * @return
+ * Promise resolved once every needed codec is loaded.
+ */
+function loadCodecModules(entries)
+{
+	const algorithms = (entries === null) ?
+	    Object.values(Module.CompressionAlgorithm) :
+	    entries.map((e) => e.compressionAlgorithm)
+
+	var names = new Set()
+	for (const algorithm of algorithms) {
+		const name = Module.getCodecModule(algorithm)
+		if (name !== "")
+			names.add(name)
+	}
+
+	return (Promise.all(Array.from(names, loadCodecModule)))
+}
+
+/**
+ * @brief
+ * Start decoding an image in the decode pool.
+ *
+ * @param entry
+ * AN2KIndexEntry of the image's record.
+ * @param transaction
+ * Module.TransactionBuffer. Image data is copied out, so this may be deleted
+ * once this returns.
+ * @param recordNumber
+ * Position of the record in the session, for messages.
+ *
+ * @return
+ * Promise of decoded pixels, or null if the image must be decoded on the main
+ * thread instead.
+ */
+function decodeImageInBackground(entry, transaction, recordNumber)
+{
+	if (decodePool === null)
+		return (null)
+
+	const bytes = transaction.getView().slice(entry.imageOffset,
+	    entry.imageOffset + entry.imageLength)
+	const decoded = decodePool.decode(entry, bytes, getDisplayDimension())
+	decoded.catch((e) => console.debug("Worker could not decode record " +
+	    (recordNumber + 1) + ": " + e.message))
+
+	return (decoded)
+}
+
+/**
+ * @brief
+ * Start decoding a transaction's images in the decode pool.
+ *
+ * @param entries
+ * Image records, from indexTransaction(), or null.
+ * @param transaction
+ * Module.TransactionBuffer. Image data is copied out, so this may be deleted
+ * once this returns.
+ * @param identifiers
+ * Record type and IDC of each record, from
+ * Module.getFrictionRidgeImageIdentifiers().
+ *
+ * @return
+ * Array parallel to `identifiers` of Promises of decoded pixels, or null
+ * where the image must be decoded on the main thread instead.
+ */
+function decodeImagesInBackground(entries, transaction, identifiers)
+{
+	var decoded = new Array(identifiers.size()).fill(null)
+	if (decodePool === null || entries === null)
+		return (decoded)
+
+	for (let i = 0; i < identifiers.size(); ++i) {
+		const id = identifiers.get(i)
+		const entry = entries.get(id.recordType + ":" + id.idc)
+		if (entry !== undefined)
+			decoded[i] = decodeImageInBackground(entry,
+			    transaction, i)
+	}
+
+	return (decoded)
+}
+
+/**
+ * @brief
+ * Start decoding a parsed transaction's images.
+ *
+ * @param session
+ * ParseSession or RecordStream holding the transaction's records.
+ * @param transaction
+ * Module.TransactionBuffer the records were parsed from. Image data is copied
+ * out, so this may be deleted once this returns.
+ *
+ * @note
+ * Images are decoded in the decode pool where possible, and the codecs needed
+ * to decode any of them on this thread are loaded meanwhile.
+ */
+function startDecoding(session, transaction)
+{
+	const entries = indexTransaction(transaction)
+	const identifiers = session.getFrictionRidgeImageIdentifiers()
+	FrictionRidgeMetadataExplorerVars.decodedImages =
+	    decodeImagesInBackground(entries, transaction, identifiers)
+	identifiers.delete()
+
+	FrictionRidgeMetadataExplorerVars.codecsLoaded = loadCodecModules(
+	    (entries === null) ? null : Array.from(entries.values()))
+}
+
+/** On file upload, process and display the record */
+/** Triggered when files are chosen with the file selector */
+export function attachFileInput(fileInput)
+{
+	openFiles(Array.from(fileInput.files))
+}
+
+/**
+ * @brief
+ * Open one file for exploration, or summarize several.
+ *
+ * @param files
+ * Array of File.
+ */
+function openFiles(files)
+{
+	if (files.length == 0)
+		return
+
+	if (files.length == 1) {
+		resetBatch()
+		attachFile(files[0])
+	} else {
+		attachFiles(files)
+	}
+}
+
+/**
+ * @brief
+ * Show the summary of a file's contents.
+ *
+ * @param summary
+ * Module.RecordSummary of the file.
+ */
+function showRecordSummary(summary)
+{
+	var statusMessage = document.getElementById('status_message')
+	statusMessage.appendChild(generateSummaryText(summary))
+	statusMessage.appendChild(document.createElement("br"))
+	statusMessage.appendChild(generatePointSystemTypeTable(summary))
+
+	// Enable popovers (after adding table to the DOM)
+	const popoverTriggerList =
+	    document.querySelectorAll('[data-bs-toggle="popover"]')
+	const popoverList = [...popoverTriggerList].map(
+	    popoverTriggerEl => new bootstrap.Popover(popoverTriggerEl))
+	const tooltipTriggerList =
+	    document.querySelectorAll('[data-bs-toggle="tooltip"]')
+	const tooltipList = [...tooltipTriggerList].map(
+	    tooltipTriggerEl => new bootstrap.Tooltip(tooltipTriggerEl))
+}
+
+/** Reveal the summary and image display */
+function showResults()
+{
+	var resultsContainer = document.getElementById(
+	    "results_container")
+	while (resultsContainer.classList.contains("d-none"))
+		resultsContainer.classList.remove("d-none")
+}
+
+/**
+ * @brief
+ * Display whatever has been read of a file so far.
+ *
+ * @param stream
+ * Module.RecordStream reading the file.
+ * @param transaction
+ * Module.TransactionBuffer being filled, shared with `stream`.
+ * @param bytesRead
+ * Number of bytes of the file in `transaction`.
+ *
+ * @throw
+ * Bytes read are not the start of a transaction that can be streamed.
+ *
+ * @note
+ * The first image is displayed as soon as it has been read, and later images
+ * are added to the record chooser as they arrive. Minutiae and the summary
+ * follow once the Type-9 records have been read.
+ */
+function appendToRecordStream(stream, transaction, bytesRead)
+{
+	const previousCount = stream.getRecordCount()
+	const hadMinutiaeData = stream.hasMinutiaeData()
+	stream.append(bytesRead)
+	const recordCount = stream.getRecordCount()
+
+	// Decode new images off of the main thread as they arrive
+	var entries = []
+	for (let i = previousCount; i < recordCount; ++i) {
+		const entry = stream.getRecordEntry(i)
+		if (entry.hasImage)
+			entries.push(entry)
+		FrictionRidgeMetadataExplorerVars.decodedImages[i] =
+		    entry.hasImage ?
+		    decodeImageInBackground(entry, transaction, i) : null
+	}
+	if (entries.length > 0) {
+		FrictionRidgeMetadataExplorerVars.codecsLoaded = Promise.all([
+		    FrictionRidgeMetadataExplorerVars.codecsLoaded,
+		    loadCodecModules(entries)])
+	}
+
+	const isFirstRecord = (previousCount == 0 && recordCount > 0)
+	const isMinutiaeData = (!hadMinutiaeData && stream.hasMinutiaeData())
+	if (!isFirstRecord && !isMinutiaeData) {
+		if (recordCount > previousCount)
+			configureRecordNumberChooser()
+		return
+	}
+
+	FrictionRidgeMetadataExplorerVars.session = stream
+	if (isMinutiaeData)
+		showRecordSummary(stream.getRecordSummary())
+	showResults()
+	if (recordCount == 0)
+		return
+
+	if (isFirstRecord) {
+		console.debug("Displaying first record after reading " +
+		    bytesRead + " bytes")
+		removeImagePlaceholder()
+		configureZoomChooser()
+	}
+	configureRecordNumberChooser()
+
+	// Draw the first image, or draw the current one again with minutiae
+	displayRecords(stream,
+	    FrictionRidgeMetadataExplorerVars.currentRecordNumber)
+}
+
+/**
+ * @brief
+ * Parse a file and display its contents.
+ *
+ * @param file
+ * File containing an ANSI/NIST-ITL transaction.
+ *
+ * @note
+ * Records are displayed as the file is read when it can be indexed, and
+ * otherwise once it has been read and parsed. Files opened before are read in
+ * full and, if their content hasn't changed, displayed from the transaction
+ * cache instead.
+ */
+async function attachFile(file)
+{
+	resetInterface();
+	const fileInfo = {name: file.name, size: file.size}
+	FrictionRidgeMetadataExplorerVars.fileInfo = fileInfo
+
+	const knownDigest = await findCachedDigest(file).catch((e) => {
+		console.debug("Could not search transaction cache: " + e)
+		return (null)
+	})
+	// Another file was opened since
+	if (FrictionRidgeMetadataExplorerVars.fileInfo !== fileInfo)
+		return
+
+	// Hashed as read, to find the file in the transaction cache
+	const hash = new Module.ContentHash()
+	var hashed = 0
+
+	var stream = null
+	var streaming = (knownDigest === null)
+	const stopStreaming = (reason) => {
+		streaming = false
+		if (stream === null || stream.isDeleted())
+			return
+		console.debug("Not displaying file as it is read: " + reason)
+
+		// Anything displayed is replaced once the file is parsed
+		if (FrictionRidgeMetadataExplorerVars.session === stream) {
+			resetInterface()
+			FrictionRidgeMetadataExplorerVars.fileInfo = fileInfo
+		} else {
+			stream.delete()
+		}
+	}
+
+	var transaction = null
+	try {
+		const start = beginPhase('Reading ANSI/NIST-ITL file');
+		transaction = await readTransactionBuffer(file,
+		    (buffer, bytesRead) => {
+			// Another file was opened since
+			if (FrictionRidgeMetadataExplorerVars.fileInfo !==
+			    fileInfo)
+				return
+			try {
+				hash.update(buffer, hashed, bytesRead - hashed)
+				hashed = bytesRead
+			} catch (e) {
+				console.debug("Could not hash file: " +
+				    getExceptionMessageString(e))
+			}
+
+			if (!streaming)
+				return
+			try {
+				if (stream === null)
+					stream = new Module.RecordStream(buffer)
+				appendToRecordStream(stream, buffer, bytesRead)
+			} catch (e) {
+				stopStreaming(getExceptionMessageString(e))
+			}
+		})
+		endPhase('Reading ANSI/NIST-ITL file', start);
+	} catch (e) {
+		hash.delete()
+		stopStreaming("file could not be read")
+		alertException(e);
+		return;
+	}
+	const digest = (hashed == file.size) ? hash.getDigest() : null
+	hash.delete()
+	if (FrictionRidgeMetadataExplorerVars.fileInfo !== fileInfo) {
+		// resetInterface() already deleted the stream if it was shown
+		if (stream !== null && !stream.isDeleted())
+			stream.delete()
+		transaction.delete()
+		return
+	}
+
+	if (knownDigest !== null && digest !== null) {
+		const cached = await loadCachedTransaction(digest).catch(
+		    (e) => {
+			console.debug("Could not load cached transaction: " + e)
+			return (null)
+		})
+		if (FrictionRidgeMetadataExplorerVars.fileInfo !== fileInfo) {
+			transaction.delete()
+			return
+		}
+		if (cached !== null) {
+			displayCachedTransaction(digest, cached, transaction)
+			return
+		}
+
+		// Changed since cached, so display it as if new
+		try {
+			streaming = true
+			stream = new Module.RecordStream(transaction)
+			appendToRecordStream(stream, transaction, file.size)
+		} catch (e) {
+			stopStreaming(getExceptionMessageString(e))
+		}
+	}
+
+	if (streaming && stream !== null && stream.isComplete()) {
+		// Records share the transaction with the stream
+		transaction.delete()
+		logHeapStatistics("after reading file")
+
+		FrictionRidgeMetadataExplorerVars.session = stream
+		console.debug(stream.getRecordCount() + " elements")
+		if (stream.getRecordCount() == 0)
+			addImagePlaceholder();
+		showResults()
+		cacheTransaction(digest, file, stream, true)
+		collectProfile()
+		return
+	}
+	stopStreaming("file is incomplete")
+
+	// Check if it is ANSI/NIST-ITL
+	if (!Module.AN2K.isAN2K(transaction)) {
+		transaction.delete()
+		alert("This file does not appear to be formatted as " +
+		    "ANSI/NIST-ITL.");
+		return;
+	}
+
+	// Try to parse the file
+	var session = null
+	try {
+		const start = beginPhase('Parsing ANSI/NIST-ITL file');
+		session = new Module.ParseSession(transaction);
+		endPhase('Parsing ANSI/NIST-ITL file', start);
+	} catch (e) {
+		transaction.delete()
+		collectProfile()
+		alertException(e);
+		return;
+	}
+	FrictionRidgeMetadataExplorerVars.session = session
+
+	// Decode images off of the main thread while the rest is set up
+	startDecoding(session, transaction)
+
+	// Parsed records and decoders hold their own copies
+	transaction.delete()
+	logHeapStatistics("after parsing file")
+
+	showRecordSummary(session.getRecordSummary())
+
+	console.debug(session.getRecordCount() + " elements")
+
+	if (session.getRecordCount() > 0) {
+		removeImagePlaceholder()
+
+		const start = beginPhase('Updating display');
+		configureRecordNumberChooser()
+		configureZoomChooser()
+		await displayRecords(session,
+		    FrictionRidgeMetadataExplorerVars.currentRecordNumber);
+		endPhase('Updating display', start);
+	} else {
+		addImagePlaceholder();
+	}
 
+	showResults()
+	cacheTransaction(digest, file, session, false)
 
-		var resultsContainer = document.getElementById(
-		    "results_container")
-		while (resultsContainer.classList.contains("d-none"))
-			resultsContainer.classList.remove("d-none")
-	};
-	fr.readAsArrayBuffer(file);
+	collectProfile()
 }
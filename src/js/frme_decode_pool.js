@@ -0,0 +1,265 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+/** Script run by each worker */
+const DECODE_WORKER_SCRIPT = 'js/frme_decode_worker.min.js'
+
+/** Upper bound on workers, regardless of core count */
+const MAX_WORKERS = 8
+
+/**
+ * @brief
+ * Pool of Web Workers that decode images and summarize files off of the main
+ * thread.
+ *
+ * @details
+ * Each worker runs its own instance of the WebAssembly module and runs one
+ * job at a time, so images from a transaction decode in parallel on up to
+ * one core each while the page stays responsive. Images being viewed are
+ * decoded before queued files are summarized.
+ */
+export class DecodePool {
+	/**
+	 * @param moduleScript
+	 * URL of the WebAssembly module's JavaScript.
+	 * @param wasmModule
+	 * Promise of the compiled WebAssembly.Module, so workers need not
+	 * download and compile it themselves, or null.
+	 * @param size
+	 * Number of workers.
+	 */
+	constructor(moduleScript, wasmModule = null, size = Math.min(
+	    MAX_WORKERS, navigator.hardwareConcurrency || 2))
+	{
+		this.moduleScript = moduleScript
+		this.wasmModule = wasmModule
+		this.size = size
+		this.workers = []
+		this.idle = []
+		this.queue = []
+		this.summaryQueue = []
+		this.jobs = new Map()
+		// ID of the job each busy worker is running
+		this.running = new Map()
+		this.nextID = 0
+	}
+
+	/**
+	 * @brief
+	 * Decode an image.
+	 *
+	 * @param entry
+	 * AN2KIndexEntry describing the image's record.
+	 * @param bytes
+	 * Uint8Array of the record's image data. Transferred to a worker, so
+	 * it is unusable after this call.
+	 * @param maxDimension
+	 * Largest width or height the image will be displayed at. Only the
+	 * smallest pyramid level at least this large is returned.
+	 *
+	 * @return
+	 * Promise of {level, width, height, rgba, maxDimension}, where rgba is
+	 * a Uint8ClampedArray of 8-bit RGBA pixels of pyramid level `level`.
+	 */
+	decode(entry, bytes, maxDimension)
+	{
+		return new Promise((resolve, reject) => {
+			// Embind value_objects are plain objects, but copy only
+			// the fields the worker needs
+			const job = {id: this.nextID++, type: 'decode',
+			    bytes: bytes, maxDimension: maxDimension, entry: {
+			    recordType: entry.recordType,
+			    idc: entry.idc,
+			    offset: entry.offset,
+			    length: entry.length,
+			    hasImage: entry.hasImage,
+			    compressionAlgorithm:
+			        entry.compressionAlgorithm.value,
+			    width: entry.width,
+			    height: entry.height,
+			    ppi: entry.ppi,
+			    bitsPerPixel: entry.bitsPerPixel,
+			    imageOffset: 0,
+			    imageLength: entry.imageLength}}
+			this.jobs.set(job.id, {resolve: resolve,
+			    reject: reject, result: (data) => ({
+			    level: data.level, width: data.width,
+			    height: data.height, rgba: new Uint8ClampedArray(
+			    data.rgba.buffer), maxDimension: maxDimension})})
+			this.queue.push(job)
+			this.dispatch()
+		})
+	}
+
+	/**
+	 * @brief
+	 * Parse a file and summarize its contents.
+	 *
+	 * @param file
+	 * File (or Blob) containing an ANSI/NIST-ITL transaction. Only a
+	 * handle is queued; a worker reads the contents when it starts the
+	 * job, so memory is bounded by the number of workers, not files.
+	 *
+	 * @return
+	 * Promise of the file's RecordSummary.
+	 */
+	summarize(file)
+	{
+		return new Promise((resolve, reject) => {
+			const job = {id: this.nextID++, type: 'summarize',
+			    file: file}
+			this.jobs.set(job.id, {resolve: resolve,
+			    reject: reject, result: (data) => data.summary})
+			this.summaryQueue.push(job)
+			this.dispatch()
+		})
+	}
+
+	/** Reject every file queued by summarize() and not yet started */
+	cancelSummaries()
+	{
+		for (const job of this.summaryQueue) {
+			this.jobs.get(job.id).reject(new Error(
+			    "Summary cancelled"))
+			this.jobs.delete(job.id)
+		}
+		this.summaryQueue = []
+	}
+
+	/** Stop all workers, rejecting anything still queued */
+	terminate()
+	{
+		for (const worker of this.workers)
+			worker.terminate()
+		for (const job of this.jobs.values())
+			job.reject(new Error("Decode pool terminated"))
+
+		this.workers = []
+		this.idle = []
+		this.queue = []
+		this.summaryQueue = []
+		this.jobs.clear()
+		this.running.clear()
+	}
+
+	/**
+	 * @brief
+	 * Stop using a worker that failed, rejecting the job it was running.
+	 *
+	 * @param worker
+	 * Worker that failed.
+	 * @param message
+	 * Why it failed.
+	 *
+	 * @note
+	 * No replacement is started, since a worker that could not load the
+	 * module would likely fail again. Queued jobs are rejected once no
+	 * worker remains, so the caller can do the work itself.
+	 */
+	dropWorker(worker, message)
+	{
+		console.debug("Decode worker failed: " + message)
+		worker.terminate()
+		this.workers = this.workers.filter((w) => w !== worker)
+		this.idle = this.idle.filter((w) => w !== worker)
+		this.size = this.workers.length
+
+		const id = this.running.get(worker)
+		this.running.delete(worker)
+		const job = this.jobs.get(id)
+		if (job !== undefined) {
+			this.jobs.delete(id)
+			job.reject(new Error(message))
+		}
+		this.dispatch()
+	}
+
+	/** Hand queued jobs to idle workers, starting workers as needed */
+	dispatch()
+	{
+		if (this.size == 0) {
+			for (const job of this.queue.concat(
+			    this.summaryQueue)) {
+				this.jobs.get(job.id).reject(new Error(
+				    "No decode workers"))
+				this.jobs.delete(job.id)
+			}
+			this.queue = []
+			this.summaryQueue = []
+			return
+		}
+
+		while (this.queue.length + this.summaryQueue.length > 0) {
+			if (this.idle.length == 0 &&
+			    this.workers.length < this.size)
+				this.startWorker()
+			if (this.idle.length == 0)
+				return
+
+			const worker = this.idle.pop()
+			if (this.queue.length > 0) {
+				const job = this.queue.shift()
+				this.running.set(worker, job.id)
+				worker.postMessage(job, [job.bytes.buffer])
+			} else {
+				const job = this.summaryQueue.shift()
+				this.running.set(worker, job.id)
+				worker.postMessage(job)
+			}
+		}
+	}
+
+	/** Start another worker and add it to the idle list */
+	startWorker()
+	{
+		const worker = new Worker(DECODE_WORKER_SCRIPT)
+		worker.onmessage = (e) => {
+			if (e.data.loadError !== undefined) {
+				this.dropWorker(worker, e.data.loadError)
+				return
+			}
+
+			const job = this.jobs.get(e.data.id)
+			this.jobs.delete(e.data.id)
+			this.running.delete(worker)
+			this.idle.push(worker)
+
+			if (job !== undefined) {
+				if (e.data.error !== undefined)
+					job.reject(new Error(e.data.error))
+				else
+					job.resolve(job.result(e.data))
+			}
+			this.dispatch()
+		}
+		// Uncaught errors (e.g., the script failed to load) and results
+		// that could not be received
+		worker.onerror = (e) => {
+			e.preventDefault()
+			this.dropWorker(worker, e.message || "Worker error")
+		}
+		worker.onmessageerror = () => this.dropWorker(worker,
+		    "Could not receive result")
+		// Worker queues jobs until the module has loaded
+		const init = {moduleScript: this.moduleScript}
+		if (this.wasmModule === null) {
+			worker.postMessage(init)
+		} else {
+			// Otherwise, the worker downloads and compiles itself
+			this.wasmModule.then(
+			    (module) => worker.postMessage(Object.assign(
+			    {wasmModule: module}, init)),
+			    () => worker.postMessage(init))
+		}
+
+		this.workers.push(worker)
+		this.idle.push(worker)
+	}
+}
@@ -0,0 +1,208 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+/*
+ * Decodes images and summarizes files for DecodePool (frme_decode_pool.js). The
+ * first message names the WebAssembly module's script (and may carry the
+ * module already compiled); every later message is one job.
+ */
+
+/** Bytes read from a file at a time */
+const READ_CHUNK_SIZE = 16 * 1024 * 1024
+
+var Module = null
+var moduleScript = null
+var moduleLoaded = false
+var pendingJobs = []
+
+/** Promises of codec side modules loaded (or loading), by file name */
+var codecModules = new Map()
+
+/**
+ * @brief
+ * Load a codec side module, if not already loaded.
+ *
+ * @param name
+ * File name of the side module, from Module.getCodecModule().
+ *
+ * @return
+ * Promise resolved once the module's decoders can be called.
+ */
+function loadCodecModule(name)
+{
+	if (!codecModules.has(name))
+		codecModules.set(name, Module.loadDynamicLibrary(
+		    new URL(name, moduleScript).href,
+		    {loadAsync: true, global: true, nodelete: true}))
+
+	return (codecModules.get(name))
+}
+
+/** @return Message from an exception thrown by the module (or anything else) */
+function getExceptionMessageString(e)
+{
+	if ((e instanceof WebAssembly.Exception) &&
+	    (typeof getExceptionMessage === 'function'))
+		return (getExceptionMessage(e)[1])
+
+	return (String(e))
+}
+
+/**
+ * @brief
+ * Decode one image and post its pixels back.
+ *
+ * @param job
+ * {id, bytes, entry, maxDimension}, as posted by DecodePool.decode().
+ */
+async function decodeJob(job)
+{
+	var buffer = null
+	var image = null
+	try {
+		const entry = Object.assign({}, job.entry)
+		entry.compressionAlgorithm = Object.values(
+		    Module.CompressionAlgorithm).find(
+		    (c) => c.value === job.entry.compressionAlgorithm)
+
+		const codec = Module.getCodecModule(entry.compressionAlgorithm)
+		if (codec !== "")
+			await loadCodecModule(codec)
+
+		buffer = new Module.TransactionBuffer(job.bytes.length)
+		buffer.getView().set(job.bytes)
+		image = Module.decodeImage(buffer, entry)
+		buffer.delete()
+		buffer = null
+
+		// Only the pyramid level that will be displayed is sent back
+		const level = image.getPyramidLevelForSize(job.maxDimension)
+
+		// Copy out of WebAssembly memory so it can be transferred
+		const rgba = image.getRGBAPixels(level).slice()
+		postMessage({id: job.id, level: level,
+		    width: image.getPyramidLevelWidth(level),
+		    height: image.getPyramidLevelHeight(level), rgba: rgba},
+		    [rgba.buffer])
+	} catch (e) {
+		postMessage({id: job.id, error: getExceptionMessageString(e)})
+	} finally {
+		if (buffer !== null)
+			buffer.delete()
+		if (image !== null)
+			image.delete()
+	}
+}
+
+/**
+ * @brief
+ * Parse one file and post its RecordSummary back.
+ *
+ * @param job
+ * {id, file}, as posted by DecodePool.summarize().
+ *
+ * @note
+ * The file is read here, in chunks, so the page never holds its contents.
+ */
+async function summarizeJob(job)
+{
+	var buffer = null
+	var an2k = null
+	try {
+		buffer = new Module.TransactionBuffer(job.file.size)
+		for (let offset = 0; offset < job.file.size;
+		    offset += READ_CHUNK_SIZE) {
+			const chunk = new Uint8Array(await job.file.slice(
+			    offset, offset + READ_CHUNK_SIZE).arrayBuffer())
+			buffer.getView().set(chunk, offset)
+		}
+
+		if (!Module.AN2K.isAN2K(buffer))
+			throw new Error("Not formatted as ANSI/NIST-ITL")
+
+		an2k = new Module.AN2K(buffer)
+		buffer.delete()
+		buffer = null
+
+		const summary = Module.getRecordSummary(an2k)
+		postMessage({id: job.id, summary: summary})
+	} catch (e) {
+		postMessage({id: job.id, error: getExceptionMessageString(e)})
+	} finally {
+		if (buffer !== null)
+			buffer.delete()
+		if (an2k !== null)
+			an2k.delete()
+	}
+}
+
+/**
+ * @brief
+ * Report that the module could not be loaded, so DecodePool stops sending
+ * jobs here and rejects any already sent.
+ *
+ * @param e
+ * Why the module could not be loaded.
+ */
+function failToLoad(e)
+{
+	pendingJobs = []
+	postMessage({loadError: getExceptionMessageString(e)})
+}
+
+/** Start a job, as posted by DecodePool */
+function runJob(job)
+{
+	if (job.type === 'summarize')
+		summarizeJob(job)
+	else
+		decodeJob(job)
+}
+
+onmessage = function(e) {
+	if (e.data.moduleScript !== undefined) {
+		moduleScript = e.data.moduleScript
+		Module = {
+			// .wasm is beside the module's script, not this one
+			locateFile: function(path) {
+				return (new URL(path, moduleScript).href)
+			},
+			onRuntimeInitialized: function() {
+				moduleLoaded = true
+				for (const job of pendingJobs)
+					runJob(job)
+				pendingJobs = []
+			},
+			onAbort: failToLoad
+		}
+
+		// Instantiate the main thread's module instead of compiling
+		const wasmModule = e.data.wasmModule
+		if (wasmModule !== undefined) {
+			Module.instantiateWasm = function(imports, receive) {
+				WebAssembly.instantiate(wasmModule,
+				    imports).then((instance) =>
+				    receive(instance, wasmModule), failToLoad)
+				return ({})
+			}
+		}
+		try {
+			importScripts(moduleScript)
+		} catch (e) {
+			failToLoad(e)
+		}
+		return
+	}
+
+	if (moduleLoaded)
+		runJob(e.data)
+	else
+		pendingJobs.push(e.data)
+}
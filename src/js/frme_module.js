@@ -1,4 +1,36 @@
 import * as FRME from './frme_client.min.js';
+import { compileWasmModule, makeInstantiateWasm } from
+    './frme_wasm_cache.min.js';
+
+/*
+ * Precache the application so it starts without downloading anything and
+ * works without a network connection.
+ */
+if ('serviceWorker' in navigator) {
+	navigator.serviceWorker.register('sw.js').catch(function(e) {
+		console.debug("Service worker not registered: " + e)
+	})
+}
+
+/*
+ * Load the WebAssembly module, preferring the build using SIMD instructions.
+ * The test is the smallest module containing a SIMD instruction
+ * (i8x16.popcnt), which only validates in browsers supporting SIMD.
+ */
+const wasmSIMDTest = new Uint8Array([0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96,
+    0, 1, 123, 3, 2, 1, 0, 10, 10, 1, 8, 0, 65, 0, 253, 15, 253, 98, 11])
+var wasmScript = document.createElement('script')
+wasmScript.src = WebAssembly.validate(wasmSIMDTest) ?
+    'wasm/frme_wasm_simd.js' : 'wasm/frme_wasm.js'
+
+/*
+ * Compile the module once (or reuse the module compiled on a previous visit)
+ * and share it with the decode workers.
+ */
+const wasmModule = compileWasmModule(wasmScript.src.replace(/\.js$/, '.wasm'))
+window.Module = {instantiateWasm: makeInstantiateWasm(wasmModule)}
+document.head.appendChild(wasmScript)
+FRME.setModuleScript(wasmScript.src, wasmModule)
 
 /*
  * Bind listeners
@@ -17,3 +49,18 @@ document.getElementById('file_selector').addEventListener('change',
 
 document.getElementById('offlineCloseButton').addEventListener('click',
     FRME.offlineAlertClosed)
+
+document.getElementById('decoded_image').addEventListener('mousemove',
+    function(e) { FRME.hoverOverImage(e); })
+document.getElementById('decoded_image').addEventListener('mouseleave',
+    function(e) { FRME.leaveImage(e); })
+document.getElementById('decoded_image').addEventListener('mousedown',
+    function(e) { FRME.startSelection(e); })
+document.getElementById('decoded_image').addEventListener('mouseup',
+    function(e) { FRME.endSelection(e); })
+
+document.getElementById('downloadImage').addEventListener('click',
+    function(e) { FRME.downloadCurrentImage(e); })
+
+document.getElementById('copyDiagnostics').addEventListener('click',
+    function(e) { FRME.copyDiagnostics(e); })
@@ -0,0 +1,388 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+import { getCacheVersion, promiseRequest } from './frme_wasm_cache.min.js';
+
+/** IndexedDB database holding what was derived from transactions */
+const DATABASE_NAME = 'frme-transactions'
+
+/** Summary and point sets of each transaction, keyed by digest */
+const TRANSACTION_STORE = 'transactions'
+
+/** Decoded pixels, keyed by digest, record number, and display dimension */
+const PIXEL_STORE = 'pixels'
+
+/** Bytes stored and time of last use of each transaction, keyed by digest */
+const USAGE_STORE = 'usage'
+
+/** Digest of each file opened, keyed by name, size, and modification time */
+const FILE_STORE = 'files'
+
+/** Every object store in DATABASE_NAME */
+const ALL_STORES = [TRANSACTION_STORE, PIXEL_STORE, USAGE_STORE, FILE_STORE]
+
+/**
+ * Layout of entries in TRANSACTION_STORE (including the values of minutia
+ * types), raised when it changes
+ */
+const ENTRY_FORMAT = 2
+
+/** Bytes stored before least recently opened transactions are evicted */
+const CACHE_BUDGET = 256 * 1024 * 1024
+
+/** @return Whether or not anything can be cached */
+function canCache()
+{
+	return (getCacheVersion() !== null && typeof indexedDB !== 'undefined')
+}
+
+/** @return Promise of the IDBDatabase holding transactions. */
+function openDatabase()
+{
+	const request = indexedDB.open(DATABASE_NAME, 1)
+	request.onupgradeneeded = () => {
+		for (const name of ALL_STORES)
+			request.result.createObjectStore(name)
+	}
+
+	return (promiseRequest(request))
+}
+
+/**
+ * @brief
+ * Wrap the completion of an IndexedDB transaction in a Promise.
+ *
+ * @param transaction
+ * IDBTransaction.
+ *
+ * @return
+ * Promise resolved once `transaction` commits.
+ */
+function promiseTransaction(transaction)
+{
+	return new Promise((resolve, reject) => {
+		transaction.oncomplete = () => resolve()
+		transaction.onerror = () => reject(transaction.error)
+		transaction.onabort = () => reject(transaction.error)
+	})
+}
+
+/** @return Object stores of `transaction`, by name */
+function getStores(transaction)
+{
+	var stores = {}
+	for (const name of transaction.objectStoreNames)
+		stores[name] = transaction.objectStore(name)
+	return (stores)
+}
+
+/** @return Key of `file` in FILE_STORE */
+function getFileKey(file)
+{
+	return (file.name + ":" + file.size + ":" + file.lastModified)
+}
+
+/** @return Key of a record's pixels in PIXEL_STORE */
+function getPixelKey(digest, recordNumber, dimension)
+{
+	return (digest + ":" + recordNumber + ":" + dimension)
+}
+
+/** @return Approximate bytes needed to store a transaction's entry */
+function getEntrySize(entry)
+{
+	var size = 4096
+	for (const record of entry.records) {
+		size += 64
+		for (const pointSet of record.pointSets)
+			for (const values of [pointSet.x, pointSet.y,
+			    pointSet.angle, pointSet.type])
+				size += values.byteLength
+	}
+	return (size)
+}
+
+/**
+ * @brief
+ * Remove a transaction, its pixels, and the files that led to it.
+ *
+ * @param stores
+ * Object stores of a readwrite transaction over ALL_STORES.
+ * @param digest
+ * Digest of the transaction to remove.
+ */
+async function removeTransaction(stores, digest)
+{
+	const entry = await promiseRequest(stores[TRANSACTION_STORE].get(
+	    digest))
+	if (entry !== undefined) {
+		// A file may since have changed into another transaction
+		for (const fileKey of entry.fileKeys)
+			if (await promiseRequest(stores[FILE_STORE].get(
+			    fileKey)) === digest)
+				stores[FILE_STORE].delete(fileKey)
+	}
+
+	stores[TRANSACTION_STORE].delete(digest)
+	stores[USAGE_STORE].delete(digest)
+	stores[PIXEL_STORE].delete(IDBKeyRange.bound(digest + ":",
+	    digest + ";", false, true))
+}
+
+/**
+ * @brief
+ * Remove least recently opened transactions until the cache is within
+ * budget.
+ *
+ * @param stores
+ * Object stores of a readwrite transaction over ALL_STORES.
+ * @param keep
+ * Digest of a transaction not to remove.
+ */
+async function evict(stores, keep)
+{
+	const digests = await promiseRequest(stores[USAGE_STORE].getAllKeys())
+	const usages = await promiseRequest(stores[USAGE_STORE].getAll())
+
+	var total = 0
+	var byAge = []
+	for (let i = 0; i < digests.length; ++i) {
+		total += usages[i].bytes
+		byAge.push({digest: digests[i], usage: usages[i]})
+	}
+	byAge.sort((a, b) => a.usage.lastUsed - b.usage.lastUsed)
+
+	for (const {digest, usage} of byAge) {
+		if (total <= CACHE_BUDGET)
+			break
+		if (digest === keep)
+			continue
+
+		console.debug("Evicting transaction " + digest + " from cache")
+		await removeTransaction(stores, digest)
+		total -= usage.bytes
+	}
+}
+
+/**
+ * @brief
+ * Find the digest a file had when it was last opened.
+ *
+ * @param file
+ * File being opened.
+ *
+ * @return
+ * Promise of the digest, or null if the file has not been opened before.
+ * The file may have changed without changing name, size, or modification
+ * time, so the digest is a hint to be verified, not an identity.
+ */
+export async function findCachedDigest(file)
+{
+	if (!canCache())
+		return (null)
+
+	const db = await openDatabase()
+	try {
+		const store = db.transaction(FILE_STORE, 'readonly').
+		    objectStore(FILE_STORE)
+		const digest = await promiseRequest(store.get(getFileKey(file)))
+		return ((digest === undefined) ? null : digest)
+	} finally {
+		db.close()
+	}
+}
+
+/**
+ * @brief
+ * Obtain what was derived from a transaction, marking it recently used.
+ *
+ * @param digest
+ * SHA-256 digest of the transaction.
+ *
+ * @return
+ * Promise of the object passed to storeCachedTransaction(), or null if not
+ * cached by this version.
+ */
+export async function loadCachedTransaction(digest)
+{
+	if (!canCache())
+		return (null)
+
+	const db = await openDatabase()
+	try {
+		const transaction = db.transaction(ALL_STORES, 'readwrite')
+		const stores = getStores(transaction)
+
+		const entry = await promiseRequest(stores[TRANSACTION_STORE].
+		    get(digest))
+		if (entry === undefined)
+			return (null)
+		if (entry.version !== getCacheVersion() ||
+		    entry.format !== ENTRY_FORMAT) {
+			// Derived by other code; pixels may differ too
+			await removeTransaction(stores, digest)
+			return (null)
+		}
+
+		const usage = await promiseRequest(stores[USAGE_STORE].get(
+		    digest))
+		usage.lastUsed = Date.now()
+		stores[USAGE_STORE].put(usage, digest)
+		await promiseTransaction(transaction)
+
+		return (entry)
+	} finally {
+		db.close()
+	}
+}
+
+/**
+ * @brief
+ * Obtain a record's decoded pixels.
+ *
+ * @param digest
+ * SHA-256 digest of the transaction.
+ * @param recordNumber
+ * Index of the record within the transaction.
+ * @param dimension
+ * Largest width or height the image will be displayed at.
+ *
+ * @return
+ * Promise of {level, width, height, rgba}, as passed to storeCachedPixels(),
+ * or undefined if not cached.
+ */
+export async function loadCachedPixels(digest, recordNumber, dimension)
+{
+	if (!canCache())
+		return (undefined)
+
+	const db = await openDatabase()
+	try {
+		const store = db.transaction(PIXEL_STORE, 'readonly').
+		    objectStore(PIXEL_STORE)
+		return (await promiseRequest(store.get(getPixelKey(digest,
+		    recordNumber, dimension))))
+	} finally {
+		db.close()
+	}
+}
+
+/**
+ * @brief
+ * Persist what was derived from a transaction.
+ *
+ * @param digest
+ * SHA-256 digest of the transaction.
+ * @param file
+ * File the transaction was read from.
+ * @param data
+ * {summary, records, streamed}, where summary is the RecordSummary, records
+ * holds {hasImage, pointSets} for each record (pointSets being an Array of
+ * {system, x, y, angle, type} with typed arrays), and streamed is whether
+ * the transaction was read by a RecordStream.
+ *
+ * @note
+ * Least recently opened transactions are evicted when over budget.
+ */
+export async function storeCachedTransaction(digest, file, data)
+{
+	if (!canCache())
+		return
+
+	const db = await openDatabase()
+	try {
+		const transaction = db.transaction(ALL_STORES, 'readwrite')
+		const stores = getStores(transaction)
+
+		var entry = Object.assign({version: getCacheVersion(),
+		    format: ENTRY_FORMAT, fileKeys: []}, data)
+		const previous = await promiseRequest(stores[
+		    TRANSACTION_STORE].get(digest))
+		var usage = await promiseRequest(stores[USAGE_STORE].get(
+		    digest))
+		if (previous !== undefined &&
+		    previous.version === entry.version &&
+		    previous.format === entry.format) {
+			entry.fileKeys = previous.fileKeys
+			usage.bytes -= getEntrySize(previous)
+		} else {
+			if (previous !== undefined)
+				await removeTransaction(stores, digest)
+			usage = {bytes: 0}
+		}
+
+		const fileKey = getFileKey(file)
+		if (!entry.fileKeys.includes(fileKey))
+			entry.fileKeys.push(fileKey)
+		usage.bytes += getEntrySize(entry)
+		usage.lastUsed = Date.now()
+
+		stores[TRANSACTION_STORE].put(entry, digest)
+		stores[USAGE_STORE].put(usage, digest)
+		stores[FILE_STORE].put(digest, fileKey)
+		await evict(stores, digest)
+
+		await promiseTransaction(transaction)
+	} finally {
+		db.close()
+	}
+}
+
+/**
+ * @brief
+ * Persist a record's decoded pixels.
+ *
+ * @param digest
+ * SHA-256 digest of the transaction, already stored by
+ * storeCachedTransaction().
+ * @param recordNumber
+ * Index of the record within the transaction.
+ * @param dimension
+ * Largest width or height the pixels were decoded for.
+ * @param pixels
+ * {level, width, height, rgba}, from DecodePool.decode().
+ *
+ * @note
+ * Nothing is stored if the transaction was evicted, or if its pixels alone
+ * would exceed the budget.
+ */
+export async function storeCachedPixels(digest, recordNumber, dimension,
+    pixels)
+{
+	if (!canCache())
+		return
+
+	const db = await openDatabase()
+	try {
+		const transaction = db.transaction(ALL_STORES, 'readwrite')
+		const stores = getStores(transaction)
+
+		const key = getPixelKey(digest, recordNumber, dimension)
+		var usage = await promiseRequest(stores[USAGE_STORE].get(
+		    digest))
+		if (usage === undefined || usage.bytes +
+		    pixels.rgba.byteLength > CACHE_BUDGET)
+			return
+		if (await promiseRequest(stores[PIXEL_STORE].count(key)) != 0)
+			return
+
+		stores[PIXEL_STORE].put({level: pixels.level,
+		    width: pixels.width, height: pixels.height,
+		    rgba: pixels.rgba}, key)
+		usage.bytes += pixels.rgba.byteLength
+		usage.lastUsed = Date.now()
+		stores[USAGE_STORE].put(usage, digest)
+		await evict(stores, digest)
+
+		await promiseTransaction(transaction)
+	} finally {
+		db.close()
+	}
+}
@@ -0,0 +1,205 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+import { FrictionRidgeMetadataExplorerVersion } from './version.min.js';
+
+/** IndexedDB database holding compiled modules */
+const DATABASE_NAME = 'frme'
+
+/** Object store within DATABASE_NAME holding compiled modules */
+const MODULE_STORE = 'wasmModules'
+
+/**
+ * @return
+ * Version modules are cached under, or null if CMake didn't configure one
+ * (in which case nothing can tell a stale module from a current one).
+ */
+export function getCacheVersion()
+{
+	if (FrictionRidgeMetadataExplorerVersion == "" ||
+	    FrictionRidgeMetadataExplorerVersion.includes("@") ||
+	    FrictionRidgeMetadataExplorerVersion.includes("$"))
+		return (null)
+
+	return (FrictionRidgeMetadataExplorerVersion)
+}
+
+/**
+ * @brief
+ * Wrap an IndexedDB request in a Promise.
+ *
+ * @param request
+ * IDBRequest or IDBOpenDBRequest.
+ *
+ * @return
+ * Promise of the request's result.
+ */
+export function promiseRequest(request)
+{
+	return new Promise((resolve, reject) => {
+		request.onsuccess = () => resolve(request.result)
+		request.onerror = () => reject(request.error)
+	})
+}
+
+/** @return Promise of the IDBDatabase holding compiled modules. */
+function openDatabase()
+{
+	const request = indexedDB.open(DATABASE_NAME, 1)
+	request.onupgradeneeded = () => {
+		request.result.createObjectStore(MODULE_STORE)
+	}
+
+	return (promiseRequest(request))
+}
+
+/**
+ * @brief
+ * Obtain a previously compiled module.
+ *
+ * @param key
+ * Version and URL of the module.
+ *
+ * @return
+ * Promise of the WebAssembly.Module, or undefined if not cached.
+ */
+async function loadCachedModule(key)
+{
+	const db = await openDatabase()
+	try {
+		const store = db.transaction(MODULE_STORE, 'readonly').
+		    objectStore(MODULE_STORE)
+		const module = await promiseRequest(store.get(key))
+		return ((module instanceof WebAssembly.Module) ? module :
+		    undefined)
+	} finally {
+		db.close()
+	}
+}
+
+/**
+ * @brief
+ * Persist a compiled module, replacing modules from other versions.
+ *
+ * @param key
+ * Version and URL of the module.
+ * @param module
+ * Compiled WebAssembly.Module.
+ *
+ * @note
+ * Not every browser can store a WebAssembly.Module; those that can't throw
+ * a DataCloneError, and the module is compiled again on the next visit.
+ */
+async function storeCachedModule(key, module)
+{
+	const version = getCacheVersion()
+	const db = await openDatabase()
+	try {
+		const store = db.transaction(MODULE_STORE, 'readwrite').
+		    objectStore(MODULE_STORE)
+		for (const oldKey of await promiseRequest(store.getAllKeys()))
+			if (!oldKey.startsWith(version + ":"))
+				store.delete(oldKey)
+		await promiseRequest(store.put(module, key))
+	} finally {
+		db.close()
+	}
+}
+
+/**
+ * @brief
+ * Download and compile a module.
+ *
+ * @param url
+ * URL of the .wasm file.
+ *
+ * @return
+ * Promise of the compiled WebAssembly.Module.
+ */
+async function compileFromNetwork(url)
+{
+	const response = fetch(url, {credentials: 'same-origin'})
+	try {
+		// Compiles while downloading
+		return (await WebAssembly.compileStreaming(response))
+	} catch (e) {
+		// Servers that don't send application/wasm can't stream
+		console.debug("Streaming compilation failed (" + e + ")")
+		const bytes = await (await response).arrayBuffer()
+		return (await WebAssembly.compile(bytes))
+	}
+}
+
+/**
+ * @brief
+ * Obtain a compiled module, from IndexedDB if compiled on a previous visit,
+ * otherwise from the network, compiling while downloading.
+ *
+ * @param url
+ * URL of the .wasm file.
+ *
+ * @return
+ * Promise of the compiled WebAssembly.Module.
+ */
+export async function compileWasmModule(url)
+{
+	const version = getCacheVersion()
+	const key = version + ":" + url
+	const canCache = (version !== null) &&
+	    (typeof indexedDB !== 'undefined')
+
+	if (canCache) {
+		try {
+			const module = await loadCachedModule(key)
+			if (module !== undefined) {
+				console.debug("Using compiled module from " +
+				    "IndexedDB")
+				return (module)
+			}
+		} catch (e) {
+			console.debug("Could not read module cache: " + e)
+		}
+	}
+
+	const module = await compileFromNetwork(url)
+
+	if (canCache) {
+		storeCachedModule(key, module).catch((e) => {
+			console.debug("Could not cache compiled module: " + e)
+		})
+	}
+
+	return (module)
+}
+
+/**
+ * @brief
+ * Emscripten Module.instantiateWasm() hook instantiating an already compiled
+ * module.
+ *
+ * @param module
+ * Promise of the compiled WebAssembly.Module.
+ *
+ * @return
+ * Function to assign to Module.instantiateWasm.
+ */
+export function makeInstantiateWasm(module)
+{
+	return function(imports, receiveInstance) {
+		module.then((m) => WebAssembly.instantiate(m, imports).then(
+		    (instance) => receiveInstance(instance, m))).
+		    catch((e) => {
+			console.error("Could not instantiate module: " + e)
+		})
+
+		// Exports are provided asynchronously
+		return ({})
+	}
+}
@@ -0,0 +1,641 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+/*
+ * Microbenchmarks for each stage of turning an ANSI/NIST-ITL transaction into
+ * something the client can draw: parse -> records -> points -> PNG -> Base64.
+ *
+ * Runs over a synthetic corpus of finger and palm transactions at a range of
+ * sizes and minutiae counts, and optionally over files given on the command
+ * line. Reports time, bytes allocated, and allocations per operation, and the
+ * process's peak RSS after each stage.
+ */
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <be_data_interchange_an2k.h>
+#include <be_io_utility.h>
+#include <be_text.h>
+
+#include "an2k_index.h"
+#include "base64.h"
+#include "frme_an2k.h"
+#include "image_pyramid.h"
+#include "parse_session.h"
+#include "png_gray.h"
+#include "point_index.h"
+
+namespace BE = BiometricEvaluation;
+
+/*
+ * Allocation accounting. Counts everything that goes through the global
+ * operator new, which includes libbiomeval and the standard library.
+ */
+
+static std::atomic<uint64_t> allocationCount{0};
+static std::atomic<uint64_t> allocationBytes{0};
+
+void *
+operator new(
+    std::size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	allocationBytes.fetch_add(size, std::memory_order_relaxed);
+
+	if (void *p = std::malloc(size == 0 ? 1 : size))
+		return (p);
+	throw std::bad_alloc{};
+}
+
+void *
+operator new[](
+    std::size_t size)
+{
+	return (operator new(size));
+}
+
+void
+operator delete(
+    void *p)
+    noexcept
+{
+	std::free(p);
+}
+
+void
+operator delete[](
+    void *p)
+    noexcept
+{
+	std::free(p);
+}
+
+void
+operator delete(
+    void *p,
+    std::size_t)
+    noexcept
+{
+	std::free(p);
+}
+
+void
+operator delete[](
+    void *p,
+    std::size_t)
+    noexcept
+{
+	std::free(p);
+}
+
+/******************************************************************************/
+
+/* ANSI/NIST-ITL information separators */
+static const char FS{0x1C};
+static const char GS{0x1D};
+static const char RS{0x1E};
+static const char US{0x1F};
+
+/** Parameters for one synthetic transaction */
+struct SyntheticCase
+{
+	std::string name;
+	/** 14 (finger) or 15 (palm) */
+	unsigned int recordType;
+	uint32_t width;
+	uint32_t height;
+	uint16_t ppi;
+	unsigned int minutiaeCount;
+};
+
+static const std::vector<SyntheticCase> SyntheticCorpus{
+    {"finger-500ppi", 14, 800, 750, 500, 40},
+    {"finger-1000ppi", 14, 1600, 1500, 1000, 80},
+    {"palm-500ppi", 15, 2000, 2500, 500, 250},
+    {"palm-1000ppi", 15, 4000, 5000, 1000, 1500}};
+
+/**
+ * @brief
+ * Append a tagged-field logical record.
+ *
+ * @param out
+ * Transaction to append to.
+ * @param type
+ * Record type.
+ * @param fields
+ * Field number/value pairs, excluding LEN (x.001) and DATA (x.999).
+ * @param data
+ * Contents of x.999, or nullptr if there is no data field.
+ */
+static void
+appendTaggedRecord(
+    std::vector<uint8_t> &out,
+    const unsigned int type,
+    const std::vector<std::pair<unsigned int, std::string>> &fields,
+    const std::vector<uint8_t> *data = nullptr)
+{
+	const auto tag = [&](const unsigned int field) {
+		char buf[16]{};
+		std::snprintf(buf, sizeof(buf), "%u.%03u:", type, field);
+		return (std::string(buf));
+	};
+
+	std::string body{};
+	for (const auto &[field, value] : fields)
+		body += GS + tag(field) + value;
+	const std::string dataTag{data != nullptr ? GS + tag(999) : ""};
+	const size_t rest = body.size() + dataTag.size() +
+	    (data != nullptr ? data->size() : 0) + 1;
+
+	/* LEN counts its own digits, so iterate until it settles */
+	size_t length{tag(1).size() + rest};
+	for (size_t previous{}; previous != length; ) {
+		previous = length;
+		length = tag(1).size() + std::to_string(previous).size() +
+		    rest;
+	}
+
+	const std::string header{tag(1) + std::to_string(length)};
+	out.insert(out.end(), header.cbegin(), header.cend());
+	out.insert(out.end(), body.cbegin(), body.cend());
+	if (data != nullptr) {
+		out.insert(out.end(), dataTag.cbegin(), dataTag.cend());
+		out.insert(out.end(), data->cbegin(), data->cend());
+	}
+	out.push_back(FS);
+}
+
+/** @return Uncompressed 8-bit grayscale image resembling ridges */
+static std::vector<uint8_t>
+makeRidgePattern(
+    const uint32_t width,
+    const uint32_t height,
+    const uint16_t ppi)
+{
+	/* Ridges are roughly 0.5 mm apart */
+	const double period{ppi / 50.8};
+
+	std::vector<uint8_t> pixels(static_cast<size_t>(width) * height);
+	uint32_t noise{0x2545F491};
+	for (uint32_t y{}; y < height; ++y) {
+		for (uint32_t x{}; x < width; ++x) {
+			noise ^= noise << 13;
+			noise ^= noise >> 17;
+			noise ^= noise << 5;
+			const double r = std::hypot(x - width / 2.0,
+			    y - height / 2.0);
+			pixels[(static_cast<size_t>(y) * width) + x] =
+			    static_cast<uint8_t>(128 + (96 * std::sin(
+			    r / period)) + (noise % 17) - 8);
+		}
+	}
+
+	return (pixels);
+}
+
+/** @return Complete ANSI/NIST-ITL transaction described by `c` */
+static BE::Memory::uint8Array
+makeTransaction(
+    const SyntheticCase &c)
+{
+	const std::string ppi{std::to_string(c.ppi)};
+	const std::string imp{c.recordType == 15 ? "10" : "0"};
+	const std::string fgp{c.recordType == 15 ? "21" : "1"};
+
+	/* Type 1 */
+	std::vector<uint8_t> out{};
+	const std::string cnt{std::string("1") + US + "3" +
+	    RS + std::to_string(c.recordType) + US + "1" +
+	    RS + "9" + US + "1" +
+	    RS + "9" + US + "2"};
+	appendTaggedRecord(out, 1, {
+	    {2, "0500"},
+	    {3, cnt},
+	    {4, "CRM"},
+	    {5, "20240101"},
+	    {7, "DAI000000"},
+	    {8, "ORI000000"},
+	    {9, "FRMEBENCH"},
+	    {11, "00.00"},
+	    {12, "00.00"}});
+
+	/* Type 14/15 */
+	const auto pixels = makeRidgePattern(c.width, c.height, c.ppi);
+	appendTaggedRecord(out, c.recordType, {
+	    {2, "1"},
+	    {3, imp},
+	    {4, "FRMEBENCH"},
+	    {5, "20240101"},
+	    {6, std::to_string(c.width)},
+	    {7, std::to_string(c.height)},
+	    {8, "1"},
+	    {9, ppi},
+	    {10, ppi},
+	    {11, "NONE"},
+	    {12, "8"},
+	    {13, fgp}}, &pixels);
+
+	/* Type 9 with legacy and EFS minutiae, associated with the image */
+	const auto toTMU = [&](const uint32_t px) {
+		return (static_cast<uint32_t>((px * 2540.0) / c.ppi));
+	};
+	std::string mrc{}, mps{};
+	uint32_t seed{0x9E3779B9};
+	for (unsigned int i{}; i < c.minutiaeCount; ++i) {
+		seed = (seed * 1664525) + 1013904223;
+		const uint32_t x = toTMU((seed >> 8) % c.width);
+		seed = (seed * 1664525) + 1013904223;
+		const uint32_t y = toTMU((seed >> 8) % c.height);
+		const uint32_t theta = (seed >> 4) % 360;
+		const bool ending = (i % 2) == 0;
+
+		/* Legacy coordinates are limited to four digits */
+		char xyt[16]{};
+		std::snprintf(xyt, sizeof(xyt), "%04u%04u%03u",
+		    std::min(x, 9999u), std::min(y, 9999u), theta);
+		if (i != 0) {
+			mrc += RS;
+			mps += RS;
+		}
+		mrc += std::to_string(i + 1) + US + xyt + US + "0" + US +
+		    (ending ? "A" : "B");
+		mps += std::to_string(x) + US + std::to_string(y) + US +
+		    std::to_string(theta) + US + (ending ? "E" : "B");
+	}
+
+	const std::vector<std::pair<unsigned int, std::string>> type9{
+	    {2, "1"},
+	    {3, imp},
+	    {4, "S"},
+	    {5, std::string("FRMEBENCH") + US + "A"},
+	    {6, fgp},
+	    {7, std::string("T") + US + "UC"},
+	    {10, std::to_string(c.minutiaeCount)},
+	    {11, "0"},
+	    {12, mrc},
+	    {300, std::to_string(toTMU(c.width)) + US +
+	        std::to_string(toTMU(c.height))},
+	    {302, fgp},
+	    {331, mps}};
+	appendTaggedRecord(out, 9, type9);
+
+	/* Type 9 without an image */
+	auto unassociated = type9;
+	unassociated.front().second = "2";
+	appendTaggedRecord(out, 9, unassociated);
+
+	BE::Memory::uint8Array transaction(out.size());
+	transaction.copy(out.data(), out.size());
+	return (transaction);
+}
+
+/******************************************************************************/
+
+/** Results of timing a single stage */
+struct StageResult
+{
+	uint64_t iterations{};
+	double nsPerOp{};
+	double bytesPerOp{};
+	double allocationsPerOp{};
+	long peakRSSKiB{};
+};
+
+/** Prevent the compiler from discarding benchmarked work */
+static volatile size_t sink{};
+
+/** @return Peak resident set size of this process, in KiB */
+static long
+getPeakRSS()
+{
+	struct rusage usage{};
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return (0);
+	return (usage.ru_maxrss);
+}
+
+/**
+ * @brief
+ * Time `op` over at least `minIterations` and `minSeconds`.
+ *
+ * @param op
+ * Operation to time. Returns a value derived from its work.
+ */
+static StageResult
+measure(
+    const std::function<size_t()> &op,
+    const uint64_t minIterations,
+    const double minSeconds)
+{
+	using Clock = std::chrono::steady_clock;
+
+	/* Warm up once, outside of the measurement */
+	sink = sink + op();
+
+	StageResult result{};
+	const uint64_t startCount = allocationCount.load();
+	const uint64_t startBytes = allocationBytes.load();
+	const auto start = Clock::now();
+	std::chrono::duration<double> elapsed{};
+	do {
+		sink = sink + op();
+		++result.iterations;
+		elapsed = Clock::now() - start;
+	} while (result.iterations < minIterations ||
+	    elapsed.count() < minSeconds);
+
+	const double n = static_cast<double>(result.iterations);
+	result.nsPerOp = (elapsed.count() * 1e9) / n;
+	result.bytesPerOp = (allocationBytes.load() - startBytes) / n;
+	result.allocationsPerOp = (allocationCount.load() - startCount) / n;
+	result.peakRSSKiB = getPeakRSS();
+
+	return (result);
+}
+
+static void
+printHeader()
+{
+	std::cout << std::left << std::setw(24) << "case" <<
+	    std::setw(42) << "stage" << std::right <<
+	    std::setw(10) << "iters" <<
+	    std::setw(16) << "ns/op" <<
+	    std::setw(16) << "bytes/op" <<
+	    std::setw(12) << "allocs/op" <<
+	    std::setw(14) << "peak RSS KiB" << '\n';
+}
+
+static void
+printResult(
+    const std::string &caseName,
+    const std::string &stage,
+    const StageResult &r)
+{
+	std::cout << std::left << std::setw(24) << caseName <<
+	    std::setw(42) << stage << std::right << std::fixed <<
+	    std::setprecision(0) <<
+	    std::setw(10) << r.iterations <<
+	    std::setw(16) << r.nsPerOp <<
+	    std::setw(16) << r.bytesPerOp <<
+	    std::setw(12) << r.allocationsPerOp <<
+	    std::setw(14) << r.peakRSSKiB << '\n';
+}
+
+/** Run every stage against one transaction */
+static void
+benchmarkTransaction(
+    const std::string &caseName,
+    BE::Memory::uint8Array &transaction,
+    const uint64_t minIterations,
+    const double minSeconds)
+{
+	try {
+		const auto shared = std::make_shared<const BE::Memory::uint8Array>(
+		    transaction);
+		printResult(caseName, "AN2KIndex construction", measure([&]() {
+			const AN2KIndex index(shared);
+			return (index.getRecordCount());
+		}, minIterations, minSeconds));
+
+		/* As the client reads a file, in 16 MiB chunks */
+		printResult(caseName, "RecordStream, 16 MiB appends",
+		    measure([&]() {
+			static const size_t ChunkSize{16 * 1024 * 1024};
+			RecordStream stream(shared);
+			for (size_t read{}; read < shared->size();) {
+				read = std::min(read + ChunkSize,
+				    shared->size());
+				stream.append(read);
+			}
+			return (stream.getRecordCount());
+		}, minIterations, minSeconds));
+
+		printResult(caseName, "AN2KRecord construction", measure([&]() {
+			const BE::DataInterchange::AN2KRecord an2k(transaction);
+			return (an2k.getMinutiaeDataRecordSet().size());
+		}, minIterations, minSeconds));
+
+		printResult(caseName, "ParseSession construction",
+		    measure([&]() {
+			const ParseSession session(transaction);
+			return (session.getRecordCount());
+		}, minIterations, minSeconds));
+
+		const BE::DataInterchange::AN2KRecord an2k(transaction);
+
+		printResult(caseName, "getFrictionRidgeImagesWithMinutiaeData",
+		    measure([&]() {
+			return (getFrictionRidgeImagesWithMinutiaeData(an2k).
+			    size());
+		}, minIterations, minSeconds));
+
+		printResult(caseName, "getUnassociatedMinutiaeData",
+		    measure([&]() {
+			return (getUnassociatedMinutiaeData(an2k).size());
+		}, minIterations, minSeconds));
+
+		printResult(caseName, "getRecordSummary", measure([&]() {
+			return (getRecordSummary(an2k).pointSystems);
+		}, minIterations, minSeconds));
+
+		const auto records = getFrictionRidgeImagesWithMinutiaeData(
+		    an2k);
+		printResult(caseName, "getAllPoints", measure([&]() {
+			size_t count{};
+			for (const auto &[image, mdrs] : records)
+				for (const auto &[system, points] :
+				    getAllPoints(image, mdrs))
+					count += points.size();
+			return (count);
+		}, minIterations, minSeconds));
+
+		printResult(caseName, "getAllPointSets", measure([&]() {
+			size_t count{};
+			for (const auto &[image, mdrs] : records)
+				for (const auto &points :
+				    getAllPointSets(image, mdrs))
+					count += points.size();
+			return (count);
+		}, minIterations, minSeconds));
+
+		/* As the client hit-tests the cursor near each point */
+		std::vector<PointSet> pointSets{};
+		for (const auto &[image, mdrs] : records)
+			for (auto &points : getAllPointSets(image, mdrs))
+				pointSets.push_back(std::move(points));
+		printResult(caseName, "PointIndex, build and nearest per point",
+		    measure([&]() {
+			size_t found{};
+			for (const auto &points : pointSets) {
+				const PointIndex index(points);
+				for (size_t i{}; i < points.size(); ++i)
+					found += (index.nearest(points.x[i] + 3,
+					    points.y[i] + 3, 16) !=
+					    PointIndex::NoPoint);
+			}
+			return (found);
+		}, minIterations, minSeconds));
+
+		/* Decode once, so only the encode is timed */
+		std::vector<std::shared_ptr<BE::Image::Image>> images{};
+		for (const auto &v : an2k.getFingerCaptures())
+			images.push_back(v.getImage());
+		for (const auto &v : an2k.getPalmCaptures())
+			images.push_back(v.getImage());
+		for (const auto &v : an2k.getFingerFixedResolutionCaptures())
+			images.push_back(v.getImage());
+		for (const auto &v : an2k.getFingerLatents())
+			images.push_back(v.getImage());
+
+		printResult(caseName, "rawToPNG (display, " +
+		    getPNGFilterImplementation() + ")", measure([&]() {
+			size_t size{};
+			for (const auto &image : images)
+				size += rawToPNG(image).size();
+			return (size);
+		}, minIterations, minSeconds));
+
+		printResult(caseName, "rawToPNG (archival)", measure([&]() {
+			size_t size{};
+			for (const auto &image : images)
+				size += rawToPNG(image,
+				    PNGEncoding::forArchival()).size();
+			return (size);
+		}, minIterations, minSeconds));
+
+		std::vector<std::vector<uint8_t>> pngs{};
+		for (const auto &image : images)
+			pngs.push_back(rawToPNG(image));
+
+		printResult(caseName, "encodeBase64 (" +
+		    getBase64Implementation() + ")", measure([&]() {
+			size_t size{};
+			for (const auto &png : pngs)
+				size += encodeBase64(png.data(),
+				    png.size()).size();
+			return (size);
+		}, minIterations, minSeconds));
+
+		printResult(caseName, "BE::Text::encodeBase64", measure([&]() {
+			size_t size{};
+			for (const auto &png : pngs) {
+				BE::Memory::uint8Array aa(png.size());
+				aa.copy(png.data(), png.size());
+				size += BE::Text::encodeBase64(aa).size();
+			}
+			return (size);
+		}, minIterations, minSeconds));
+
+		/* Fresh ImageShims, since the encoding is cached */
+		printResult(caseName, "ImageShim::getBase64PNG (uncached)",
+		    measure([&]() {
+			size_t size{};
+			for (const auto &image : images)
+				size += ImageShim(image).getBase64PNG().size();
+			return (size);
+		}, minIterations, minSeconds));
+
+		printResult(caseName, "ImageShim::getRGBAPixels (uncached)",
+		    measure([&]() {
+			size_t size{};
+			for (const auto &image : images)
+				size += ImageShim(image).getRGBAPixels().size();
+			return (size);
+		}, minIterations, minSeconds));
+
+		/* Level closest to the client's 500-pixel display */
+		printResult(caseName, "ImageShim::getRGBAPixels (" +
+		    getDownsampleImplementation() + ")", measure([&]() {
+			size_t size{};
+			for (const auto &image : images) {
+				const ImageShim shim(image);
+				size += shim.getRGBAPixels(
+				    shim.getPyramidLevelForSize(500)).size();
+			}
+			return (size);
+		}, minIterations, minSeconds));
+	} catch (const std::exception &e) {
+		std::cout << std::left << std::setw(24) << caseName <<
+		    "error: " << e.what() << '\n';
+	}
+}
+
+static void
+usage(
+    const char *name)
+{
+	std::cerr << "Usage: " << name << " [-n iterations] [-t seconds] "
+	    "[file ...]\n"
+	    "\t-n:   minimum iterations per stage (default: 3)\n"
+	    "\t-t:   minimum seconds per stage (default: 0.5)\n"
+	    "\tfile: ANSI/NIST-ITL files to benchmark in addition to the "
+	    "synthetic corpus\n";
+}
+
+int
+main(
+    int argc,
+    char *argv[])
+{
+	uint64_t minIterations{3};
+	double minSeconds{0.5};
+	std::vector<std::string> files{};
+
+	for (int i{1}; i < argc; ++i) {
+		const std::string arg{argv[i]};
+		if ((arg == "-n" || arg == "-t") && (i + 1) < argc) {
+			if (arg == "-n")
+				minIterations = std::strtoull(argv[++i],
+				    nullptr, 10);
+			else
+				minSeconds = std::strtod(argv[++i], nullptr);
+		} else if (arg[0] == '-') {
+			usage(argv[0]);
+			return (arg == "-h" ? EXIT_SUCCESS : EXIT_FAILURE);
+		} else {
+			files.push_back(arg);
+		}
+	}
+
+	printHeader();
+	for (const auto &c : SyntheticCorpus) {
+		auto transaction = makeTransaction(c);
+		benchmarkTransaction(c.name + "/" +
+		    std::to_string(c.minutiaeCount) + "min", transaction,
+		    minIterations, minSeconds);
+	}
+
+	for (const auto &file : files) {
+		try {
+			auto transaction = BE::IO::Utility::readFile(file);
+			benchmarkTransaction(file, transaction, minIterations,
+			    minSeconds);
+		} catch (const std::exception &e) {
+			std::cerr << file << ": " << e.what() << '\n';
+		}
+	}
+
+	return (EXIT_SUCCESS);
+}
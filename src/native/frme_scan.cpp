@@ -0,0 +1,228 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+/*
+ * Native batch scanner. Walks files and directories given on the command line
+ * and writes one JSON object per line summarizing each ANSI/NIST-ITL file.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <be_data_interchange_an2k.h>
+
+#include "frme_an2k.h"
+
+namespace BE = BiometricEvaluation;
+
+/** Every PointSystem, in the order they are reported. */
+static const PointSystem AllPointSystems[] = {
+    PointSystem::Legacy,
+    PointSystem::IAFIS,
+    PointSystem::Cogent,
+    PointSystem::Motorola,
+    PointSystem::Sagem,
+    PointSystem::NEC,
+    PointSystem::Identix,
+    PointSystem::M1,
+    PointSystem::Other,
+    PointSystem::EFS};
+
+/** @return `s` as a quoted JSON string */
+static std::string
+toJSONString(
+    const std::string &s)
+{
+	std::string ret{"\""};
+	ret.reserve(s.size() + 2);
+
+	for (const char c : s) {
+		switch (c) {
+		case '"':
+			ret += "\\\"";
+			break;
+		case '\\':
+			ret += "\\\\";
+			break;
+		case '\n':
+			ret += "\\n";
+			break;
+		case '\r':
+			ret += "\\r";
+			break;
+		case '\t':
+			ret += "\\t";
+			break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20) {
+				char buf[7]{};
+				std::snprintf(buf, sizeof(buf), "\\u%04x",
+				    static_cast<unsigned int>(c));
+				ret += buf;
+			} else {
+				ret += c;
+			}
+		}
+	}
+
+	ret += "\"";
+	return (ret);
+}
+
+/** @return JSON-lines summary of the file at `path` (no trailing newline) */
+static std::string
+summarize(
+    const std::string &path)
+{
+	std::ostringstream json{};
+	json << "{\"path\":" << toJSONString(path);
+
+	try {
+		if (!BE::DataInterchange::AN2KRecord::isAN2KRecord(path)) {
+			json << ",\"an2k\":false}";
+			return (json.str());
+		}
+
+		const BE::DataInterchange::AN2KRecord an2k(path);
+		const auto summary = getRecordSummary(an2k);
+		json << ",\"an2k\":true";
+
+		json << ",\"pointSystems\":[";
+		bool first{true};
+		for (const auto ps : AllPointSystems) {
+			if ((summary.pointSystems &
+			    (1u << static_cast<uint32_t>(ps))) == 0)
+				continue;
+			if (!first)
+				json << ",";
+			json << toJSONString(getPointSystemName(ps));
+			first = false;
+		}
+		json << "]";
+
+		json << ",\"images\":{" <<
+		    "\"fingerFixedResolution\":" <<
+		    summary.fingerFixedResolutionCount <<
+		    ",\"fingerCapture\":" << summary.fingerCaptureCount <<
+		    ",\"palm\":" << summary.palmCount <<
+		    ",\"latent\":" << summary.latentCount << "}";
+
+		json << ",\"unassociatedMinutiae\":" <<
+		    summary.unassociatedMinutiaeDataRecordCount;
+	} catch (const std::exception &e) {
+		json << ",\"error\":" << toJSONString(e.what());
+	}
+
+	json << "}";
+	return (json.str());
+}
+
+/** @return Regular files at or below each of `paths` */
+static std::vector<std::string>
+collectFiles(
+    const std::vector<std::string> &paths)
+{
+	namespace fs = std::filesystem;
+
+	std::vector<std::string> files{};
+	for (const auto &path : paths) {
+		std::error_code ec{};
+		if (fs::is_directory(path, ec)) {
+			for (fs::recursive_directory_iterator it(path,
+			    fs::directory_options::skip_permission_denied, ec),
+			    end; !ec && it != end; it.increment(ec)) {
+				if (it->is_regular_file(ec))
+					files.push_back(it->path().string());
+			}
+		} else if (fs::is_regular_file(path, ec)) {
+			files.push_back(path);
+		}
+
+		if (ec)
+			std::cerr << path << ": " << ec.message() << '\n';
+	}
+
+	return (files);
+}
+
+static void
+usage(
+    const char *name)
+{
+	std::cerr << "Usage: " << name << " [-j threads] path [path ...]\n"
+	    "\tpath: ANSI/NIST-ITL file or directory to search recursively\n"
+	    "\t-j:   number of worker threads (default: number of cores)\n";
+}
+
+int
+main(
+    int argc,
+    char *argv[])
+{
+	unsigned int numThreads{std::thread::hardware_concurrency()};
+	std::vector<std::string> paths{};
+
+	for (int i{1}; i < argc; ++i) {
+		const std::string arg{argv[i]};
+		if (arg == "-j") {
+			if (++i == argc) {
+				usage(argv[0]);
+				return (EXIT_FAILURE);
+			}
+			numThreads = static_cast<unsigned int>(
+			    std::strtoul(argv[i], nullptr, 10));
+		} else if (arg == "-h" || arg == "--help") {
+			usage(argv[0]);
+			return (EXIT_SUCCESS);
+		} else {
+			paths.push_back(arg);
+		}
+	}
+	if (paths.empty()) {
+		usage(argv[0]);
+		return (EXIT_FAILURE);
+	}
+
+	const auto files = collectFiles(paths);
+	numThreads = std::max(1u, std::min(numThreads,
+	    static_cast<unsigned int>(files.size())));
+
+	/* Workers pull the next unclaimed file until none remain */
+	std::atomic<size_t> next{0};
+	std::mutex outputMutex{};
+	const auto worker = [&]() {
+		for (size_t i{next++}; i < files.size(); i = next++) {
+			const auto line = summarize(files[i]);
+
+			const std::lock_guard<std::mutex> lock(outputMutex);
+			std::cout << line << '\n';
+		}
+	};
+
+	std::vector<std::thread> pool{};
+	pool.reserve(numThreads);
+	for (unsigned int i{}; i < numThreads; ++i)
+		pool.emplace_back(worker);
+	for (auto &t : pool)
+		t.join();
+
+	std::cout.flush();
+	return (EXIT_SUCCESS);
+}
@@ -0,0 +1,581 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+/*
+ * End-to-end throughput of an installed WebAssembly module under Node.
+ *
+ * Loads frme_wasm.js (or frme_wasm_simd.js) as built, embind, memory growth,
+ * UBSan runtime and all, into a pool of worker threads, and makes the calls
+ * frme_client.js makes for each file of a corpus: parse, summarize, convert
+ * points, decode pixels for display, and encode PNG. Reports files per
+ * second, p50 and p99 latency of each phase, and growth of each worker's
+ * heap, and checks them against optional budgets so builds can be compared
+ * before they are deployed.
+ *
+ * Usage: node frme_harness.mjs -m /var/www/frme/wasm/frme_wasm.js corpus/
+ */
+
+import fs from 'node:fs';
+import os from 'node:os';
+import path from 'node:path';
+import vm from 'node:vm';
+import { createRequire } from 'node:module';
+import { performance } from 'node:perf_hooks';
+import { Worker, isMainThread, parentPort, workerData } from
+    'node:worker_threads';
+
+/** Largest width or height of an image at 100% zoom, as in frme_client.js */
+const DISPLAY_DIMENSION = 500
+
+/** Phases timed for each file, in the order they run */
+const PHASES = ['Copying', 'Parsing', 'Summarizing', 'Converting points',
+    'Decoding', 'Encoding PNG']
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+/******************************************************************************
+ * Worker
+ ******************************************************************************/
+
+var Module = null
+
+/** @return Message from an exception thrown by the module (or anything else) */
+function getExceptionMessageString(e)
+{
+	if ((e instanceof WebAssembly.Exception) &&
+	    (typeof globalThis.getExceptionMessage === 'function'))
+		return (globalThis.getExceptionMessage(e)[1])
+
+	return (String(e))
+}
+
+/**
+ * @brief
+ * Load the module's script into this thread.
+ *
+ * @param moduleScript
+ * Path of frme_wasm.js or frme_wasm_simd.js.
+ * @param wasmModule
+ * The script's WebAssembly.Module, compiled by the main thread.
+ *
+ * @return
+ * Promise of the initialized Module.
+ *
+ * @note
+ * The script is built for the page, where it runs as a classic script that
+ * reads the global Module, so it is run the same way here rather than
+ * imported as a CommonJS module.
+ */
+function loadModule(moduleScript, wasmModule)
+{
+	return new Promise((resolve, reject) => {
+		globalThis.Module = {
+			locateFile: function(file) {
+				return (path.join(path.dirname(moduleScript),
+				    file))
+			},
+			instantiateWasm: function(imports, receive) {
+				WebAssembly.instantiate(wasmModule,
+				    imports).then((instance) =>
+				    receive(instance, wasmModule), reject)
+				return ({})
+			},
+			onRuntimeInitialized: function() {
+				resolve(globalThis.Module)
+			},
+			onAbort: reject
+		}
+
+		globalThis.require = createRequire(moduleScript)
+		globalThis.__filename = moduleScript
+		globalThis.__dirname = path.dirname(moduleScript)
+		vm.runInThisContext(fs.readFileSync(moduleScript, 'utf8'),
+		    {filename: moduleScript})
+	})
+}
+
+/**
+ * @brief
+ * Load every codec side module, if the module was built with them split
+ * out, so that loading them isn't timed as decoding.
+ */
+async function loadCodecModules()
+{
+	if (typeof Module.getCodecModule !== 'function')
+		return
+
+	var names = new Set()
+	for (const algorithm of Object.values(Module.CompressionAlgorithm)) {
+		const name = Module.getCodecModule(algorithm)
+		if (name !== "")
+			names.add(name)
+	}
+	for (const name of names)
+		await Module.loadDynamicLibrary(Module.locateFile(name),
+		    {loadAsync: true, global: true, nodelete: true})
+}
+
+/**
+ * @brief
+ * Process one file the way the client does.
+ *
+ * @param file
+ * Path of an ANSI/NIST-ITL transaction.
+ *
+ * @return
+ * {file, bytes, records, times, heap}, where times holds the milliseconds
+ * spent in each phase and heap is Module.getHeapStatistics() after
+ * everything from the file was released, or {file, error}.
+ */
+function processFile(file)
+{
+	var times = {}
+	const time = (phase, f) => {
+		const start = performance.now()
+		const result = f()
+		times[phase] = (times[phase] ?? 0) + performance.now() - start
+		return (result)
+	}
+
+	var buffer = null
+	var session = null
+	try {
+		const bytes = fs.readFileSync(file)
+		buffer = time('Copying', () => {
+			const b = new Module.TransactionBuffer(bytes.length)
+			b.getView().set(bytes)
+			return (b)
+		})
+		if (!Module.AN2K.isAN2K(buffer))
+			throw new Error("Not formatted as ANSI/NIST-ITL")
+
+		// ParseSession construction: AN2KRecord parsing, the summary,
+		// and getFrictionRidgeImagesWithMinutiaeData() (not decoding)
+		session = time('Parsing', () => new Module.ParseSession(buffer))
+		buffer.delete()
+		buffer = null
+
+		time('Summarizing', () => session.getRecordSummary())
+
+		for (let i = 0; i < session.getRecordCount(); ++i) {
+			const record = session.getRecord(i)
+			time('Converting points', () => {
+				const sets = Module.getAllPointSets(
+				    record.image, record.minutiaeDataRecords)
+				for (let j = 0; j < sets.size(); ++j) {
+					const pointSet = sets.get(j)
+					pointSet.getX()
+					pointSet.getY()
+					pointSet.getAngle()
+					pointSet.getType()
+					pointSet.delete()
+				}
+				sets.delete()
+			})
+
+			if (record.image.containsImage()) {
+				time('Decoding', () =>
+				    record.image.getRGBAPixels(
+				    record.image.getPyramidLevelForSize(
+				    DISPLAY_DIMENSION)))
+				time('Encoding PNG', () =>
+				    record.image.getBase64PNG(true))
+			}
+			record.image.delete()
+			record.minutiaeDataRecords.delete()
+		}
+
+		const records = session.getRecordCount()
+		session.delete()
+		session = null
+
+		return ({file: file, bytes: bytes.length, records: records,
+		    times: times, heap: Module.getHeapStatistics()})
+	} catch (e) {
+		return ({file: file, error: getExceptionMessageString(e)})
+	} finally {
+		if (buffer !== null)
+			buffer.delete()
+		if (session !== null)
+			session.delete()
+	}
+}
+
+/** Load the module, then process each file posted until told to stop */
+async function runWorker()
+{
+	const start = performance.now()
+	Module = await loadModule(workerData.moduleScript,
+	    workerData.wasmModule)
+	await loadCodecModules()
+	parentPort.postMessage({ready: true,
+	    instantiation: performance.now() - start,
+	    heap: Module.getHeapStatistics()})
+
+	parentPort.on('message', (file) => {
+		if (file === null)
+			parentPort.close()
+		else
+			parentPort.postMessage(processFile(file))
+	})
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+/******************************************************************************
+ * Main thread
+ ******************************************************************************/
+
+/** Print usage */
+function usage()
+{
+	console.error("Usage: node frme_harness.mjs -m module.js " +
+	    "[-j workers] [-r repetitions]\n    [-b budgets.json] " +
+	    "[-o report.json] " +
+	    "path [path ...]\n" +
+	    "\tpath: ANSI/NIST-ITL file or directory to search recursively\n" +
+	    "\t-m:   installed frme_wasm.js or frme_wasm_simd.js\n" +
+	    "\t-j:   number of worker threads (default: number of cores)\n" +
+	    "\t-r:   times to process each file (default: 1)\n" +
+	    "\t-b:   budgets to check (exit status is 1 if any is exceeded)\n" +
+	    "\t-o:   where to write the report as JSON")
+}
+
+/** @return Regular files in `paths`, searching directories recursively */
+function collectFiles(paths)
+{
+	var files = []
+	for (const p of paths) {
+		try {
+			const stat = fs.statSync(p)
+			if (stat.isDirectory()) {
+				for (const entry of fs.readdirSync(p,
+				    {recursive: true, withFileTypes: true})) {
+					if (!entry.isFile())
+						continue
+					files.push(path.join(entry.parentPath ??
+					    entry.path, entry.name))
+				}
+			} else if (stat.isFile()) {
+				files.push(p)
+			}
+		} catch (e) {
+			console.error(p + ": " + e.message)
+		}
+	}
+
+	return (files)
+}
+
+/**
+ * @return
+ * Value at percentile `p` (0 to 100) of ascending `values`, by nearest rank,
+ * or 0 if there are none.
+ */
+function percentile(values, p)
+{
+	if (values.length == 0)
+		return (0)
+	const rank = Math.ceil((p / 100) * values.length)
+	return (values[Math.min(values.length, Math.max(1, rank)) - 1])
+}
+
+/** @return Human-readable size of `bytes` */
+function formatBytes(bytes)
+{
+	const units = ['B', 'KiB', 'MiB', 'GiB']
+	var unit = 0
+	var value = Math.abs(bytes)
+	while (value >= 1024 && unit < units.length - 1) {
+		value /= 1024
+		++unit
+	}
+	return ((bytes < 0 ? "-" : "") + value.toFixed(unit == 0 ? 0 : 1) +
+	    " " + units[unit])
+}
+
+/**
+ * @brief
+ * Process files in a pool of workers.
+ *
+ * @param options
+ * {moduleScript, workers, repetitions}.
+ * @param files
+ * Paths of transactions.
+ *
+ * @return
+ * Promise of {results, instantiations, initialHeaps, seconds}, where
+ * results holds processFile()'s result for every file processed, and
+ * initialHeaps and instantiations hold each worker's heap statistics and
+ * milliseconds spent loading the module.
+ */
+async function runPool(options, files)
+{
+	// Compiled once and shared, as the page shares with its workers
+	const wasmModule = await WebAssembly.compile(fs.readFileSync(
+	    options.moduleScript.replace(/\.js$/, '.wasm')))
+
+	var queue = []
+	for (let r = 0; r < options.repetitions; ++r)
+		queue.push(...files)
+	const total = queue.length
+
+	var results = []
+	var instantiations = []
+	var initialHeaps = []
+	var start = 0
+	var workers = []
+	const done = new Promise((resolve, reject) => {
+		var ready = 0
+		const next = (worker) => {
+			worker.postMessage(queue.length > 0 ? queue.shift() :
+			    null)
+		}
+
+		for (let i = 0; i < options.workers; ++i) {
+			const worker = new Worker(new URL(import.meta.url),
+			    {workerData: {moduleScript: options.moduleScript,
+			    wasmModule: wasmModule}})
+			worker.on('error', reject)
+			worker.on('message', (message) => {
+				if (message.ready) {
+					instantiations.push(
+					    message.instantiation)
+					initialHeaps.push(message.heap)
+					// Throughput excludes instantiation
+					if (++ready == workers.length) {
+						start = performance.now()
+						workers.forEach(next)
+					}
+					return
+				}
+
+				message.worker = i
+				results.push(message)
+				if (results.length == total)
+					resolve()
+				else
+					next(worker)
+			})
+			workers.push(worker)
+		}
+	})
+	try {
+		await done
+	} finally {
+		await Promise.all(workers.map((w) => w.terminate()))
+	}
+	const seconds = (performance.now() - start) / 1000
+
+	return ({results: results, instantiations: instantiations,
+	    initialHeaps: initialHeaps, seconds: seconds})
+}
+
+/**
+ * @brief
+ * Summarize a run.
+ *
+ * @param options
+ * {moduleScript, workers, repetitions}.
+ * @param run
+ * Result of runPool().
+ *
+ * @return
+ * Report object, also written as JSON by -o.
+ */
+function makeReport(options, run)
+{
+	const succeeded = run.results.filter((r) => r.error === undefined)
+	const bytes = succeeded.reduce((sum, r) => sum + r.bytes, 0)
+
+	var phases = {}
+	for (const phase of ['Instantiating', ...PHASES]) {
+		const times = (phase === 'Instantiating') ?
+		    run.instantiations.slice() :
+		    succeeded.filter((r) => r.times[phase] !== undefined).
+		    map((r) => r.times[phase])
+		times.sort((a, b) => a - b)
+		phases[phase] = {count: times.length,
+		    p50: percentile(times, 50), p99: percentile(times, 99),
+		    max: percentile(times, 100)}
+	}
+
+	// Heap after the last file each worker processed, against its start
+	var heap = {initialSize: 0, finalSize: 0, growth: 0, retained: 0,
+	    peakFootprint: 0}
+	run.initialHeaps.forEach((initial, i) => {
+		const last = succeeded.filter((r) => r.worker == i).pop()
+		const final = (last === undefined) ? initial : last.heap
+		heap.initialSize = Math.max(heap.initialSize, initial.heapSize)
+		heap.finalSize = Math.max(heap.finalSize, final.heapSize)
+		heap.growth = Math.max(heap.growth,
+		    final.heapSize - initial.heapSize)
+		heap.retained = Math.max(heap.retained,
+		    final.allocatedBytes - initial.allocatedBytes)
+		heap.peakFootprint = Math.max(heap.peakFootprint,
+		    final.peakFootprint)
+	})
+
+	return ({module: options.moduleScript, workers: options.workers,
+	    repetitions: options.repetitions, files: run.results.length,
+	    errors: run.results.filter((r) => r.error !== undefined).map(
+	    (r) => ({file: r.file, error: r.error})),
+	    bytes: bytes, seconds: run.seconds,
+	    filesPerSecond: run.results.length / run.seconds,
+	    bytesPerSecond: bytes / run.seconds,
+	    phases: phases, heap: heap})
+}
+
+/** Print a report */
+function printReport(report)
+{
+	console.log(path.basename(report.module) + ": " + report.files +
+	    " files (" + formatBytes(report.bytes) + ") in " +
+	    report.seconds.toFixed(2) + " s on " + report.workers +
+	    " workers: " + report.filesPerSecond.toFixed(2) + " files/s, " +
+	    formatBytes(report.bytesPerSecond) + "/s, " +
+	    report.errors.length + " errors")
+	for (const error of report.errors)
+		console.log("  " + error.file + ": " + error.error)
+
+	console.log("\n" + "Phase".padEnd(20) + "Count".padStart(8) +
+	    "p50 ms".padStart(12) + "p99 ms".padStart(12) +
+	    "max ms".padStart(12))
+	for (const [name, phase] of Object.entries(report.phases))
+		console.log(name.padEnd(20) + String(phase.count).padStart(8) +
+		    phase.p50.toFixed(2).padStart(12) +
+		    phase.p99.toFixed(2).padStart(12) +
+		    phase.max.toFixed(2).padStart(12))
+
+	console.log("\nHeap (largest of any worker): " +
+	    formatBytes(report.heap.initialSize) + " at start, " +
+	    formatBytes(report.heap.finalSize) + " at end (grew " +
+	    formatBytes(report.heap.growth) + "), " +
+	    formatBytes(report.heap.retained) + " still allocated after " +
+	    "releasing every file, " + formatBytes(report.heap.peakFootprint) +
+	    " peak footprint")
+}
+
+/**
+ * @brief
+ * Check a report against budgets.
+ *
+ * @param report
+ * Result of makeReport().
+ * @param budgets
+ * Any of {minFilesPerSecond, maxErrors, maxHeapGrowthBytes,
+ * maxRetainedBytes, phases: {name: {p50, p99}}}, milliseconds for phases.
+ *
+ * @return
+ * true if every budget is met.
+ */
+function checkBudgets(report, budgets)
+{
+	var checks = []
+	const check = (name, value, limit, isMinimum = false) => {
+		if (limit !== undefined)
+			checks.push({name: name, value: value, limit: limit,
+			    met: isMinimum ? (value >= limit) :
+			    (value <= limit)})
+	}
+
+	check("files/s", report.filesPerSecond, budgets.minFilesPerSecond,
+	    true)
+	check("errors", report.errors.length, budgets.maxErrors)
+	check("heap growth (bytes)", report.heap.growth,
+	    budgets.maxHeapGrowthBytes)
+	check("retained (bytes)", report.heap.retained,
+	    budgets.maxRetainedBytes)
+	for (const [name, limits] of Object.entries(budgets.phases ?? {})) {
+		const phase = report.phases[name]
+		if (phase === undefined) {
+			console.error("Budget for unknown phase \"" + name +
+			    "\"")
+			checks.push({name: name, met: false})
+			continue
+		}
+		check(name + " p50 (ms)", phase.p50, limits.p50)
+		check(name + " p99 (ms)", phase.p99, limits.p99)
+	}
+
+	console.log("\nBudgets:")
+	for (const c of checks)
+		console.log("  " + (c.met ? "PASS " : "FAIL ") + c.name +
+		    (c.value === undefined ? "" : ": " +
+		    Number(c.value.toFixed(2)) + " (limit " + c.limit + ")"))
+
+	return (checks.every((c) => c.met))
+}
+
+/** Parse arguments, run, and report */
+async function main(argv)
+{
+	var options = {moduleScript: null, workers: os.availableParallelism(),
+	    repetitions: 1}
+	var budgetsFile = null
+	var reportFile = null
+	var paths = []
+	for (let i = 0; i < argv.length; ++i) {
+		const arg = argv[i]
+		if (['-m', '-j', '-r', '-b', '-o'].includes(arg)) {
+			if (++i == argv.length) {
+				usage()
+				return (1)
+			}
+			if (arg == '-m')
+				options.moduleScript = path.resolve(argv[i])
+			else if (arg == '-j')
+				options.workers = parseInt(argv[i])
+			else if (arg == '-r')
+				options.repetitions = parseInt(argv[i])
+			else if (arg == '-b')
+				budgetsFile = argv[i]
+			else
+				reportFile = argv[i]
+		} else if (arg == '-h' || arg == '--help') {
+			usage()
+			return (0)
+		} else {
+			paths.push(arg)
+		}
+	}
+	if (options.moduleScript === null || paths.length == 0 ||
+	    !(options.workers > 0) || !(options.repetitions > 0)) {
+		usage()
+		return (1)
+	}
+
+	const files = collectFiles(paths)
+	if (files.length == 0) {
+		console.error("No files found")
+		return (1)
+	}
+	options.workers = Math.min(options.workers,
+	    files.length * options.repetitions)
+
+	const report = makeReport(options, await runPool(options, files))
+	printReport(report)
+	if (reportFile !== null)
+		fs.writeFileSync(reportFile, JSON.stringify(report, null, 2))
+
+	if (budgetsFile === null)
+		return (0)
+	const budgets = JSON.parse(fs.readFileSync(budgetsFile, 'utf8'))
+	return (checkBudgets(report, budgets) ? 0 : 1)
+}
+
+if (isMainThread)
+	process.exitCode = await main(process.argv.slice(2))
+else
+	await runWorker()
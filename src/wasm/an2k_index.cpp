@@ -0,0 +1,709 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include "an2k_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+#include <be_image_raw.h>
+#include <be_io_utility.h>
+
+namespace BE = BiometricEvaluation;
+
+/** ANSI/NIST-ITL separator characters */
+static const uint8_t FS{0x1C};
+static const uint8_t GS{0x1D};
+static const uint8_t RS{0x1E};
+static const uint8_t US{0x1F};
+
+/** Most bytes before the end of a tagged record's length field (x.001) */
+static const size_t MaxLengthFieldSize{32};
+
+/** Size of the fixed header of binary (Type-3 through Type-6) records */
+static const size_t BinaryImageHeaderLength{18};
+
+/** Location of one field's value within a tagged record */
+struct TaggedField
+{
+	uint16_t field{};
+	size_t offset{};
+	size_t length{};
+};
+
+/** @return Unsigned integer from ASCII digits in [begin, end) */
+static uint64_t
+parseUnsigned(
+    const uint8_t *begin,
+    const uint8_t *end)
+{
+	if (begin == end)
+		throw std::runtime_error{"Expected digits, found nothing"};
+
+	uint64_t value{};
+	for (const uint8_t *p = begin; p != end; ++p) {
+		if ((*p < '0') || (*p > '9'))
+			throw std::runtime_error{"Expected digits, found " +
+			    std::string(begin, end)};
+		value = (value * 10) + (*p - '0');
+	}
+
+	return (value);
+}
+
+/** @return Big-endian unsigned integer of `size` bytes at `p` */
+static uint32_t
+readBigEndian(
+    const uint8_t *p,
+    const size_t size)
+{
+	uint32_t value{};
+	for (size_t i{}; i < size; ++i)
+		value = (value << 8) | p[i];
+	return (value);
+}
+
+/** @return Whether or not `recordType` is a binary record */
+static bool
+isBinaryRecordType(
+    const uint16_t recordType)
+{
+	return ((recordType >= 3) && (recordType <= 8));
+}
+
+/**
+ * @brief
+ * Read the length of a tagged record (field x.001).
+ *
+ * @param data
+ * Start of the record.
+ * @param available
+ * Bytes available at `data`.
+ *
+ * @return
+ * Length of the record, in bytes, or 0 if the field does not end within
+ * `available` bytes.
+ *
+ * @throw std::runtime_error
+ * There is no length field at `data`.
+ */
+static size_t
+readTaggedRecordLength(
+    const uint8_t *data,
+    const size_t available)
+{
+	/* Don't search all of a large buffer that isn't a transaction */
+	const size_t limit{std::min(available, MaxLengthFieldSize)};
+
+	size_t colon{};
+	while ((colon < limit) && (data[colon] != ':'))
+		++colon;
+	size_t end{colon + 1};
+	while ((end < limit) && (data[end] != GS) && (data[end] != FS))
+		++end;
+	if (end >= limit) {
+		if (available >= MaxLengthFieldSize)
+			throw std::runtime_error{"Record does not begin with "
+			    "a length field"};
+		return (0);
+	}
+
+	return (parseUnsigned(data + colon + 1, data + end));
+}
+
+/**
+ * @brief
+ * Locate the fields of a tagged record.
+ *
+ * @param data
+ * Start of the transaction.
+ * @param offset
+ * Offset of the record within `data`.
+ * @param length
+ * Length of the record.
+ *
+ * @return
+ * Every field in the record, in order. Field x.999 (image data), if present,
+ * is located but not read.
+ */
+static std::vector<TaggedField>
+readTaggedFields(
+    const uint8_t *data,
+    const size_t offset,
+    const size_t length)
+{
+	std::vector<TaggedField> fields{};
+
+	const size_t end{offset + length};
+	size_t pos{offset};
+	while (pos < end) {
+		size_t dot{pos};
+		while ((dot < end) && (data[dot] != '.'))
+			++dot;
+		size_t colon{dot};
+		while ((colon < end) && (data[colon] != ':'))
+			++colon;
+		if (colon >= end)
+			throw std::runtime_error{"Malformed field tag at "
+			    "offset " + std::to_string(pos)};
+
+		TaggedField field{};
+		field.field = static_cast<uint16_t>(parseUnsigned(
+		    data + dot + 1, data + colon));
+		field.offset = colon + 1;
+
+		/* Image data is binary and runs to the end of the record */
+		if (field.field == 999) {
+			field.length = (end - 1) - field.offset;
+			fields.push_back(field);
+			break;
+		}
+
+		size_t valueEnd{field.offset};
+		while ((valueEnd < end) && (data[valueEnd] != GS) &&
+		    (data[valueEnd] != FS))
+			++valueEnd;
+		field.length = valueEnd - field.offset;
+		fields.push_back(field);
+
+		if ((valueEnd >= end) || (data[valueEnd] == FS))
+			break;
+		pos = valueEnd + 1;
+	}
+
+	return (fields);
+}
+
+/** @return Value of `field` in `fields`, or nullptr if not present */
+static const TaggedField*
+findField(
+    const std::vector<TaggedField> &fields,
+    const uint16_t field)
+{
+	for (const auto &f : fields)
+		if (f.field == field)
+			return (&f);
+	return (nullptr);
+}
+
+/** @return First information item of `field` as an unsigned integer */
+static uint64_t
+parseUnsignedField(
+    const uint8_t *data,
+    const TaggedField &field)
+{
+	size_t length{};
+	while ((length < field.length) && (data[field.offset + length] != US) &&
+	    (data[field.offset + length] != RS))
+		++length;
+	return (parseUnsigned(data + field.offset,
+	    data + field.offset + length));
+}
+
+/** @return Pixels per millimeter, as recorded in Type-1, in PPI */
+static uint16_t
+ppmmToPPI(
+    const uint8_t *data,
+    const TaggedField &field)
+{
+	const std::string ppmm(data + field.offset,
+	    data + field.offset + field.length);
+	return (static_cast<uint16_t>(std::round(std::strtod(ppmm.c_str(),
+	    nullptr) * 25.4)));
+}
+
+/**
+ * @brief
+ * Identify the compression algorithm named by a tagged record's CGA field.
+ *
+ * @param cga
+ * Contents of the CGA field.
+ * @param algorithm
+ * Set to the algorithm named by `cga`, if recognized.
+ *
+ * @return
+ * Whether or not `cga` names a recognized algorithm.
+ */
+static bool
+toCompressionAlgorithm(
+    const std::string &cga,
+    BE::Image::CompressionAlgorithm &algorithm)
+{
+	if (cga == "NONE")
+		algorithm = BE::Image::CompressionAlgorithm::None;
+	else if ((cga == "WSQ20") || (cga == "WSQ"))
+		algorithm = BE::Image::CompressionAlgorithm::WSQ20;
+	else if (cga == "JPEGB")
+		algorithm = BE::Image::CompressionAlgorithm::JPEGB;
+	else if (cga == "JPEGL")
+		algorithm = BE::Image::CompressionAlgorithm::JPEGL;
+	else if (cga == "JP2")
+		algorithm = BE::Image::CompressionAlgorithm::JP2;
+	else if (cga == "JP2L")
+		algorithm = BE::Image::CompressionAlgorithm::JP2L;
+	else if (cga == "PNG")
+		algorithm = BE::Image::CompressionAlgorithm::PNG;
+	else
+		return (false);
+
+	return (true);
+}
+
+/**
+ * @brief
+ * Identify the compression algorithm from a binary record's GCA/BCA byte.
+ *
+ * @param gca
+ * Value of the GCA/BCA byte.
+ * @param algorithm
+ * Set to the algorithm `gca` stands for, if recognized.
+ *
+ * @return
+ * Whether or not `gca` stands for a recognized algorithm.
+ */
+static bool
+toCompressionAlgorithm(
+    const uint8_t gca,
+    BE::Image::CompressionAlgorithm &algorithm)
+{
+	switch (gca) {
+	case 0:
+		algorithm = BE::Image::CompressionAlgorithm::None;
+		return (true);
+	case 1:
+		algorithm = BE::Image::CompressionAlgorithm::WSQ20;
+		return (true);
+	case 2:
+		algorithm = BE::Image::CompressionAlgorithm::JPEGB;
+		return (true);
+	case 3:
+		algorithm = BE::Image::CompressionAlgorithm::JPEGL;
+		return (true);
+	case 4:
+		algorithm = BE::Image::CompressionAlgorithm::JP2;
+		return (true);
+	case 5:
+		algorithm = BE::Image::CompressionAlgorithm::JP2L;
+		return (true);
+	case 6:
+		algorithm = BE::Image::CompressionAlgorithm::PNG;
+		return (true);
+	default:
+		return (false);
+	}
+}
+
+/**
+ * @brief
+ * Describe the image in a tagged image record (Type-13 through Type-15).
+ *
+ * @param data
+ * Start of the transaction.
+ * @param fields
+ * Fields of the record.
+ * @param entry
+ * Entry to update.
+ */
+static void
+indexTaggedImage(
+    const uint8_t *data,
+    const std::vector<TaggedField> &fields,
+    AN2KIndexEntry &entry)
+{
+	const auto *hll = findField(fields, 6);
+	const auto *vll = findField(fields, 7);
+	const auto *slc = findField(fields, 8);
+	const auto *thps = findField(fields, 9);
+	const auto *cga = findField(fields, 11);
+	const auto *bpx = findField(fields, 12);
+	const auto *image = findField(fields, 999);
+	if ((hll == nullptr) || (vll == nullptr) || (cga == nullptr) ||
+	    (image == nullptr))
+		return;
+
+	/* Left to the parser, without stopping the rest of the index */
+	if (!toCompressionAlgorithm(std::string(data + cga->offset,
+	    data + cga->offset + cga->length), entry.compressionAlgorithm)) {
+		entry.hasUnrecognizedImage = true;
+		return;
+	}
+
+	entry.hasImage = true;
+	entry.width = static_cast<uint32_t>(parseUnsignedField(data, *hll));
+	entry.height = static_cast<uint32_t>(parseUnsignedField(data, *vll));
+	entry.bitsPerPixel = (bpx == nullptr) ? 8 :
+	    static_cast<uint16_t>(parseUnsignedField(data, *bpx));
+	entry.imageOffset = image->offset;
+	entry.imageLength = image->length;
+
+	/* SLC: 1 is pixels per inch, 2 is pixels per centimeter */
+	if ((slc != nullptr) && (thps != nullptr)) {
+		const auto scale = parseUnsignedField(data, *slc);
+		const auto density = parseUnsignedField(data, *thps);
+		if (scale == 1)
+			entry.ppi = static_cast<uint16_t>(density);
+		else if (scale == 2)
+			entry.ppi = static_cast<uint16_t>(std::round(density *
+			    2.54));
+	}
+}
+
+AN2KIndex::AN2KIndex(
+    const std::string &path) :
+    AN2KIndex(std::make_shared<const BE::Memory::uint8Array>(
+    BE::IO::Utility::readFile(path)))
+{
+
+}
+
+AN2KIndex::AN2KIndex(
+    std::shared_ptr<const BE::Memory::uint8Array> transaction) :
+    AN2KIndex(transaction, (transaction ? transaction->size() : 0))
+{
+
+}
+
+AN2KIndex::AN2KIndex(
+    std::shared_ptr<const BE::Memory::uint8Array> transaction,
+    const size_t available) :
+    transaction_{transaction}
+{
+	if (!this->transaction_ || this->transaction_->empty())
+		throw std::runtime_error{"Transaction is empty"};
+
+	this->update(available);
+}
+
+bool
+AN2KIndex::indexType1(
+    const size_t available)
+{
+	const uint8_t *data = this->transaction_->data();
+	const size_t size = this->transaction_->size();
+
+	AN2KIndexEntry type1{};
+	type1.recordType = 1;
+	type1.length = readTaggedRecordLength(data, available);
+	if (type1.length == 0) {
+		if (available < size)
+			return (false);
+		throw std::runtime_error{"Truncated record length field"};
+	}
+	if (type1.length > size)
+		throw std::runtime_error{"Type-1 record is truncated"};
+	if (type1.length > available)
+		return (false);
+
+	const auto type1Fields = readTaggedFields(data, 0, type1.length);
+	const auto *cnt = findField(type1Fields, 3);
+	if (cnt == nullptr)
+		throw std::runtime_error{"Type-1 record has no CNT field"};
+
+	/* Resolution of binary image records, from NSR and NTR */
+	if (const auto *nsr = findField(type1Fields, 11); nsr != nullptr)
+		this->nativeScanningPPI_ = ppmmToPPI(data, *nsr);
+	if (const auto *ntr = findField(type1Fields, 12); ntr != nullptr)
+		this->nominalTransmittingPPI_ = ppmmToPPI(data, *ntr);
+	if (this->nominalTransmittingPPI_ == 0)
+		this->nominalTransmittingPPI_ = this->nativeScanningPPI_;
+
+	/*
+	 * CNT: first subfield is "1" and the record count, then one
+	 * subfield of record type and IDC per logical record.
+	 */
+	size_t subfield{cnt->offset};
+	const size_t cntEnd{cnt->offset + cnt->length};
+	while (subfield < cntEnd) {
+		size_t separator{subfield};
+		while ((separator < cntEnd) && (data[separator] != US))
+			++separator;
+		size_t subfieldEnd{separator};
+		while ((subfieldEnd < cntEnd) && (data[subfieldEnd] != RS))
+			++subfieldEnd;
+
+		if (subfield != cnt->offset) {
+			RecordIdentifier listed{};
+			listed.recordType = static_cast<uint16_t>(
+			    parseUnsigned(data + subfield, data + separator));
+			if (separator < subfieldEnd)
+				listed.idc = static_cast<uint16_t>(
+				    parseUnsigned(data + separator + 1,
+				    data + subfieldEnd));
+			this->listed_.push_back(listed);
+		}
+		subfield = subfieldEnd + 1;
+	}
+
+	this->records_.push_back(type1);
+	return (true);
+}
+
+size_t
+AN2KIndex::update(
+    const size_t available)
+{
+	const uint8_t *data = this->transaction_->data();
+	const size_t size = this->transaction_->size();
+	if (available > size)
+		throw std::out_of_range{std::to_string(available) + " bytes "
+		    "available in a transaction of " + std::to_string(size)};
+
+	const size_t previousCount{this->records_.size()};
+	if (this->records_.empty() && !this->indexType1(available))
+		return (0);
+
+	/*
+	 * Remaining records are contiguous, in CNT order.
+	 */
+	while (!this->isComplete()) {
+		const auto &previous = this->records_.back();
+		const size_t offset{previous.offset + previous.length};
+		const uint16_t recordType{
+		    this->listed_[this->records_.size() - 1].recordType};
+		if (offset >= size)
+			throw std::runtime_error{"Transaction is truncated "
+			    "before Type-" + std::to_string(recordType) +
+			    " record"};
+		/* Wait for the record's length to be read */
+		if (offset >= available)
+			break;
+
+		AN2KIndexEntry entry{};
+		entry.recordType = recordType;
+		entry.offset = offset;
+
+		if (isBinaryRecordType(recordType)) {
+			if ((size - offset) < 5)
+				throw std::runtime_error{"Truncated Type-" +
+				    std::to_string(recordType) + " record"};
+			if ((available - offset) < 5)
+				break;
+			entry.length = readBigEndian(data + offset, 4);
+			entry.idc = data[offset + 4];
+		} else {
+			entry.length = readTaggedRecordLength(data + offset,
+			    available - offset);
+			if ((entry.length == 0) && (available < size))
+				break;
+		}
+		if ((entry.length == 0) || (entry.length > (size - offset)))
+			throw std::runtime_error{"Type-" +
+			    std::to_string(recordType) + " record at offset " +
+			    std::to_string(offset) + " is truncated"};
+		/* Wait for the rest of the record to be read */
+		if (entry.length > (available - offset))
+			break;
+
+		if (isBinaryRecordType(recordType) && (recordType != 7) &&
+		    (recordType != 8) &&
+		    (entry.length > BinaryImageHeaderLength)) {
+			/* LEN IDC IMP FGP(6) ISR HLL(2) VLL(2) GCA DATA */
+			const uint8_t *header = data + offset;
+			if (toCompressionAlgorithm(header[17],
+			    entry.compressionAlgorithm)) {
+				entry.hasImage = true;
+				entry.ppi = (header[12] == 0) ?
+				    this->nativeScanningPPI_ :
+				    this->nominalTransmittingPPI_;
+				entry.width = readBigEndian(header + 13, 2);
+				entry.height = readBigEndian(header + 15, 2);
+				entry.bitsPerPixel = ((recordType == 5) ||
+				    (recordType == 6)) ? 1 : 8;
+				entry.imageOffset = offset +
+				    BinaryImageHeaderLength;
+				entry.imageLength = entry.length -
+				    BinaryImageHeaderLength;
+			} else {
+				entry.hasUnrecognizedImage = true;
+			}
+		} else if (!isBinaryRecordType(recordType)) {
+			/* Only image records need more than the IDC */
+			const bool isImageRecord = (recordType >= 13) &&
+			    (recordType <= 15);
+			const auto fields = readTaggedFields(data, offset,
+			    entry.length);
+			if (const auto *idc = findField(fields, 2);
+			    idc != nullptr)
+				entry.idc = static_cast<uint16_t>(
+				    parseUnsignedField(data, *idc));
+			if (isImageRecord)
+				indexTaggedImage(data, fields, entry);
+		}
+
+		this->records_.push_back(entry);
+	}
+
+	return (this->records_.size() - previousCount);
+}
+
+bool
+AN2KIndex::isComplete()
+    const
+{
+	return (!this->records_.empty() &&
+	    (this->records_.size() == (this->listed_.size() + 1)));
+}
+
+const std::vector<RecordIdentifier>&
+AN2KIndex::getListedRecords()
+    const
+{
+	return (this->listed_);
+}
+
+size_t
+AN2KIndex::getRecordCount()
+    const
+{
+	return (this->records_.size());
+}
+
+const AN2KIndexEntry&
+AN2KIndex::getRecord(
+    size_t index)
+    const
+{
+	return (this->records_.at(index));
+}
+
+const std::vector<AN2KIndexEntry>&
+AN2KIndex::getRecords()
+    const
+{
+	return (this->records_);
+}
+
+ImageShim
+AN2KIndex::getImage(
+    size_t index)
+    const
+{
+	const auto entry = this->records_.at(index);
+	if (!entry.hasImage)
+		throw std::runtime_error{"Type-" +
+		    std::to_string(entry.recordType) + " record " +
+		    std::to_string(index) + " does not contain an image"};
+
+	/* Keep the transaction alive until (and only until) decoding */
+	const auto transaction = this->transaction_;
+	return (ImageShim([transaction, entry]() {
+		return (decodeImage(transaction->data() + entry.imageOffset,
+		    entry.imageLength, entry));
+	    }, entry.width, entry.height, entry.ppi));
+}
+
+BE::Memory::uint8Array
+AN2KIndex::extractRecords(
+    const std::vector<size_t> &indices)
+    const
+{
+	const uint8_t *data = this->transaction_->data();
+	const auto &type1 = this->records_.at(0);
+
+	/* CNT lists only the records being copied */
+	std::string cnt{"1" + std::string(1, US) +
+	    std::to_string(indices.size())};
+	size_t length{type1.length};
+	for (const auto index : indices) {
+		if (index == 0)
+			throw std::out_of_range{"Type-1 is always copied"};
+		const auto &record = this->records_.at(index);
+		const auto idc = std::to_string(record.idc);
+		cnt += std::string(1, RS) + std::to_string(record.recordType) +
+		    std::string(1, US) + ((idc.size() < 2) ? "0" : "") + idc;
+		length += record.length;
+	}
+
+	const auto fields = readTaggedFields(data, 0, type1.length);
+	const auto *len = findField(fields, 1);
+	const auto *oldCNT = findField(fields, 3);
+
+	/* LEN counts its own digits */
+	const size_t type1Length{type1.length - len->length - oldCNT->length +
+	    cnt.size()};
+	size_t lenDigits{std::to_string(type1Length + 1).size()};
+	if (std::to_string(type1Length + lenDigits).size() != lenDigits)
+		++lenDigits;
+	const std::string newLEN{std::to_string(type1Length + lenDigits)};
+	length = length - type1.length + type1Length + lenDigits;
+
+	BE::Memory::uint8Array extracted(length);
+	uint8_t *out = extracted.data();
+	const auto append = [&out](const uint8_t *begin, const size_t size) {
+		std::copy(begin, begin + size, out);
+		out += size;
+	};
+	append(data, len->offset);
+	append(reinterpret_cast<const uint8_t*>(newLEN.data()),
+	    newLEN.size());
+	append(data + len->offset + len->length,
+	    oldCNT->offset - (len->offset + len->length));
+	append(reinterpret_cast<const uint8_t*>(cnt.data()), cnt.size());
+	append(data + oldCNT->offset + oldCNT->length,
+	    type1.length - (oldCNT->offset + oldCNT->length));
+	for (const auto index : indices) {
+		const auto &record = this->records_[index];
+		append(data + record.offset, record.length);
+	}
+
+	return (extracted);
+}
+
+std::shared_ptr<BE::Image::Image>
+decodeImage(
+    const uint8_t *imageData,
+    const size_t imageDataSize,
+    const AN2KIndexEntry &entry)
+{
+	if (!entry.hasImage)
+		throw std::runtime_error{"Type-" +
+		    std::to_string(entry.recordType) + " record does not "
+		    "contain an image"};
+	if ((imageData == nullptr) || (imageDataSize < entry.imageLength))
+		throw std::runtime_error{"Image data is truncated"};
+
+	if (entry.compressionAlgorithm !=
+	    BE::Image::CompressionAlgorithm::None) {
+		BE::Memory::uint8Array encoded{};
+		encoded.copy(imageData, entry.imageLength);
+		return (BE::Image::Image::openImage(encoded));
+	}
+
+	const uint16_t bitDepth = (entry.bitsPerPixel == 16) ? 16 :
+	    ((entry.bitsPerPixel == 1) ? 1 : 8);
+	return (std::make_shared<BE::Image::Raw>(imageData, entry.imageLength,
+	    BE::Image::Size(entry.width, entry.height), entry.bitsPerPixel,
+	    bitDepth, BE::Image::Resolution(entry.ppi, entry.ppi,
+	    BE::Image::Resolution::Units::PPI)));
+}
+
+std::string
+getCodecModule(
+    const BE::Image::CompressionAlgorithm compressionAlgorithm)
+{
+#if defined(FRME_SPLIT_CODECS)
+	switch (compressionAlgorithm) {
+	case BE::Image::CompressionAlgorithm::JP2:
+		[[fallthrough]];
+	case BE::Image::CompressionAlgorithm::JP2L:
+		return ("frme_codec_jp2.wasm");
+	case BE::Image::CompressionAlgorithm::TIFF:
+		return ("frme_codec_tiff.wasm");
+	default:
+		return ("");
+	}
+#else
+	static_cast<void>(compressionAlgorithm);
+	return ("");
+#endif
+}
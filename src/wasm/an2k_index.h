@@ -0,0 +1,306 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef AN2K_INDEX_H_
+#define AN2K_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <be_image_image.h>
+#include <be_memory_autoarray.h>
+
+#include "image_shim.h"
+
+/** Identifies a logical record within a transaction */
+struct RecordIdentifier
+{
+	/** Record type (e.g., 14 for Type-14) */
+	uint16_t recordType{};
+	/** Information designation character */
+	uint16_t idc{};
+};
+
+/** Location and description of one logical record in a transaction */
+struct AN2KIndexEntry
+{
+	/** Record type (e.g., 14 for Type-14) */
+	uint16_t recordType{};
+	/** Information designation character, or 0 for Type-1 */
+	uint16_t idc{};
+	/** Offset of the record from the start of the transaction */
+	size_t offset{};
+	/** Length of the record, in bytes */
+	size_t length{};
+
+	/** Whether or not the record carries image data that can be decoded */
+	bool hasImage{false};
+	/**
+	 * Whether or not the record carries image data compressed by an
+	 * algorithm not recognized here, leaving hasImage false. Such images
+	 * are decoded from a parsed record instead.
+	 */
+	bool hasUnrecognizedImage{false};
+	/** Compression of image data */
+	BiometricEvaluation::Image::CompressionAlgorithm compressionAlgorithm{
+	    BiometricEvaluation::Image::CompressionAlgorithm::None};
+	/** Width of image, in pixels, as recorded in the record */
+	uint32_t width{};
+	/** Height of image, in pixels, as recorded in the record */
+	uint32_t height{};
+	/** Resolution of image, in PPI, or 0 if not recorded */
+	uint16_t ppi{};
+	/** Bits per pixel of uncompressed image data */
+	uint16_t bitsPerPixel{};
+	/** Offset of image data from the start of the transaction */
+	size_t imageOffset{};
+	/** Length of image data, in bytes */
+	size_t imageLength{};
+};
+
+/**
+ * @brief
+ * Index of the logical records in an ANSI/NIST-ITL transaction.
+ *
+ * @details
+ * Built from the Type-1 CNT field and each record's length, reading only the
+ * header fields of image records. Nothing is decoded until an image is
+ * requested with getImage(), so indexing takes time proportional to the
+ * number of records, not the number of pixels.
+ *
+ * A transaction may also be indexed while it is being read, with records
+ * added by update() as their last byte arrives.
+ */
+class AN2KIndex
+{
+public:
+	/**
+	 * @brief
+	 * Index a transaction on disk.
+	 *
+	 * @param path
+	 * Path to ANSI/NIST-ITL transaction.
+	 *
+	 * @throw std::runtime_error
+	 * File could not be read or is not a well-formed transaction.
+	 */
+	AN2KIndex(
+	    const std::string &path);
+
+	/**
+	 * @brief
+	 * Index a transaction in memory.
+	 *
+	 * @param transaction
+	 * ANSI/NIST-ITL transaction. Retained for later decoding.
+	 *
+	 * @throw std::runtime_error
+	 * `transaction` is not a well-formed transaction.
+	 */
+	AN2KIndex(
+	    std::shared_ptr<const BiometricEvaluation::Memory::uint8Array>
+	    transaction);
+
+	/**
+	 * @brief
+	 * Index the part of a transaction read so far.
+	 *
+	 * @param transaction
+	 * Buffer the size of the entire ANSI/NIST-ITL transaction, filled from
+	 * the start. Retained for later decoding.
+	 * @param available
+	 * Number of bytes at the start of `transaction` that have been read.
+	 *
+	 * @throw std::runtime_error
+	 * The bytes available are not the start of a well-formed transaction.
+	 *
+	 * @see update()
+	 */
+	AN2KIndex(
+	    std::shared_ptr<const BiometricEvaluation::Memory::uint8Array>
+	    transaction,
+	    const size_t available);
+
+	/**
+	 * @brief
+	 * Index records read since construction or the last update.
+	 *
+	 * @param available
+	 * Number of bytes at the start of the transaction that have been read.
+	 *
+	 * @return
+	 * Number of records added to the index.
+	 *
+	 * @throw std::runtime_error
+	 * The bytes available are not the start of a well-formed transaction,
+	 * or all bytes are available and the transaction is truncated.
+	 * @throw std::out_of_range
+	 * `available` is larger than the transaction.
+	 */
+	size_t
+	update(
+	    const size_t available);
+
+	/** @return Whether or not every logical record has been indexed */
+	bool
+	isComplete()
+	    const;
+
+	/**
+	 * @return
+	 * Record type and IDC of each logical record after Type-1, as listed
+	 * by the Type-1 CNT field. Empty until Type-1 has been indexed.
+	 */
+	const std::vector<RecordIdentifier>&
+	getListedRecords()
+	    const;
+
+	/** @return Number of logical records indexed, including Type-1 */
+	size_t
+	getRecordCount()
+	    const;
+
+	/**
+	 * @return
+	 * Description of the logical record at `index`, in transaction order.
+	 *
+	 * @throw std::out_of_range
+	 * `index` is out of range.
+	 */
+	const AN2KIndexEntry&
+	getRecord(
+	    size_t index)
+	    const;
+
+	/** @return Logical records indexed, in transaction order */
+	const std::vector<AN2KIndexEntry>&
+	getRecords()
+	    const;
+
+	/**
+	 * @brief
+	 * Obtain the image from a logical record.
+	 *
+	 * @param index
+	 * Index of logical record containing an image.
+	 *
+	 * @return
+	 * ImageShim that decodes the image the first time pixels are needed.
+	 *
+	 * @throw std::out_of_range
+	 * `index` is out of range.
+	 * @throw std::runtime_error
+	 * Record at `index` does not contain an image.
+	 */
+	ImageShim
+	getImage(
+	    size_t index)
+	    const;
+
+	/**
+	 * @brief
+	 * Copy logical records into a new transaction.
+	 *
+	 * @param indices
+	 * Indices of indexed records to copy, other than Type-1, in increasing
+	 * order.
+	 *
+	 * @return
+	 * Transaction of the Type-1 record, with its LEN and CNT fields
+	 * rewritten, followed by the records at `indices`.
+	 *
+	 * @throw std::out_of_range
+	 * An index is 0 or is out of range.
+	 *
+	 * @note
+	 * Lets a parser that needs a complete transaction read a few small
+	 * records (e.g., Type-9) without copying the images around them.
+	 */
+	BiometricEvaluation::Memory::uint8Array
+	extractRecords(
+	    const std::vector<size_t> &indices)
+	    const;
+
+private:
+	/**
+	 * @brief
+	 * Index the Type-1 record.
+	 *
+	 * @param available
+	 * Number of bytes at the start of the transaction that have been read.
+	 *
+	 * @return
+	 * Whether or not the Type-1 record was indexed.
+	 */
+	bool
+	indexType1(
+	    const size_t available);
+
+	/** Transaction bytes, shared with any undecoded ImageShims */
+	std::shared_ptr<const BiometricEvaluation::Memory::uint8Array>
+	    transaction_{};
+	/** Logical records indexed so far, in transaction order */
+	std::vector<AN2KIndexEntry> records_{};
+	/** Records after Type-1, as listed by CNT */
+	std::vector<RecordIdentifier> listed_{};
+	/** Resolution of binary image records, from NSR */
+	uint16_t nativeScanningPPI_{};
+	/** Resolution of binary image records, from NTR (or NSR) */
+	uint16_t nominalTransmittingPPI_{};
+};
+
+/**
+ * @brief
+ * Decode the image from an image record.
+ *
+ * @param imageData
+ * Image data from the record (e.g., field x.999), which need not be part of
+ * a complete transaction.
+ * @param imageDataSize
+ * Number of bytes at `imageData`.
+ * @param entry
+ * Description of the record, as produced by AN2KIndex.
+ *
+ * @return
+ * Decoded image.
+ *
+ * @throw std::runtime_error
+ * `entry` does not describe an image, or `imageData` could not be decoded.
+ */
+std::shared_ptr<BiometricEvaluation::Image::Image>
+decodeImage(
+    const uint8_t *imageData,
+    const size_t imageDataSize,
+    const AN2KIndexEntry &entry);
+
+/**
+ * @brief
+ * Obtain the side module needed to decode an image.
+ *
+ * @param compressionAlgorithm
+ * Compression algorithm of the image.
+ *
+ * @return
+ * File name of the side module that must be loaded before decoding an image
+ * compressed with `compressionAlgorithm`, or an empty string if the decoder
+ * is part of this module.
+ *
+ * @note
+ * Always empty unless built with FRME_SPLIT_CODECS.
+ */
+std::string
+getCodecModule(
+    const BiometricEvaluation::Image::CompressionAlgorithm
+    compressionAlgorithm);
+
+#endif /* AN2K_INDEX_H_ */
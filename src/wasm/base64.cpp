@@ -0,0 +1,288 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+/*
+ * Vector implementations follow Wojciech Muła and Daniel Lemire, "Faster
+ * Base64 Encoding and Decoding Using AVX2 Instructions" (2018), on 128-bit
+ * registers: each step reads 12 bytes and writes 16 characters.
+ *
+ * 1. Shuffle each 3-byte group [a b c] into a 32-bit lane as [b a c b].
+ * 2. Extract the four 6-bit indices from each lane into separate bytes.
+ * 3. Map indices to ASCII by adding an offset looked up by index range.
+ */
+
+#include "base64.h"
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define FRME_BASE64_WASM_SIMD128
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FRME_BASE64_NEON
+#elif (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define FRME_BASE64_SSSE3
+#endif
+
+/** Base64 alphabet (RFC 4648, Table 1) */
+static const char Alphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/**
+ * @brief
+ * Encode bytes one 3-byte group at a time.
+ *
+ * @param in
+ * Bytes to encode.
+ * @param size
+ * Number of bytes at `in`.
+ * @param out
+ * Where to write 4 * ceil(size / 3) characters.
+ */
+static void
+encodeScalar(
+    const uint8_t *in,
+    const size_t size,
+    char *out)
+{
+	size_t i{};
+	for (; (i + 2) < size; i += 3) {
+		const uint32_t group = (static_cast<uint32_t>(in[i]) << 16) |
+		    (static_cast<uint32_t>(in[i + 1]) << 8) | in[i + 2];
+		*out++ = Alphabet[(group >> 18) & 0x3F];
+		*out++ = Alphabet[(group >> 12) & 0x3F];
+		*out++ = Alphabet[(group >> 6) & 0x3F];
+		*out++ = Alphabet[group & 0x3F];
+	}
+
+	const size_t remaining = size - i;
+	if (remaining == 0)
+		return;
+
+	const uint32_t group = (static_cast<uint32_t>(in[i]) << 16) |
+	    ((remaining == 2) ? (static_cast<uint32_t>(in[i + 1]) << 8) : 0);
+	*out++ = Alphabet[(group >> 18) & 0x3F];
+	*out++ = Alphabet[(group >> 12) & 0x3F];
+	*out++ = (remaining == 2) ? Alphabet[(group >> 6) & 0x3F] : '=';
+	*out++ = '=';
+}
+
+#if defined(FRME_BASE64_WASM_SIMD128)
+
+/**
+ * @brief
+ * Encode 12-byte blocks with WebAssembly SIMD.
+ *
+ * @return
+ * Number of bytes of `in` that were encoded (a multiple of 3).
+ */
+static size_t
+encodeVector(
+    const uint8_t *in,
+    const size_t size,
+    char *out)
+{
+	/* Offsets to ASCII, selected by reduced index (see step 3) */
+	const v128_t lut = wasm_i8x16_make('a' - 26, '0' - 52, '0' - 52,
+	    '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+	    '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+
+	size_t i{};
+	/* Loads are 16 bytes wide, though only 12 are consumed */
+	for (; (i + 16) <= size; i += 12, out += 16) {
+		const v128_t bytes = wasm_v128_load(in + i);
+		const v128_t lanes = wasm_i8x16_shuffle(bytes, bytes,
+		    1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+
+		/* No per-lane multiplies, so shift masked halves instead */
+		const v128_t hi = wasm_v128_or(
+		    wasm_u16x8_shr(wasm_v128_and(lanes,
+		    wasm_i32x4_splat(0x0000FC00)), 10),
+		    wasm_u16x8_shr(wasm_v128_and(lanes,
+		    wasm_i32x4_splat(0x0FC00000)), 6));
+		const v128_t lo = wasm_v128_or(
+		    wasm_i16x8_shl(wasm_v128_and(lanes,
+		    wasm_i32x4_splat(0x000003F0)), 4),
+		    wasm_i16x8_shl(wasm_v128_and(lanes,
+		    wasm_i32x4_splat(0x003F0000)), 8));
+		const v128_t indices = wasm_v128_or(hi, lo);
+
+		v128_t reduced = wasm_u8x16_sub_sat(indices,
+		    wasm_i8x16_splat(51));
+		reduced = wasm_v128_or(reduced, wasm_v128_and(
+		    wasm_i8x16_lt(indices, wasm_i8x16_splat(26)),
+		    wasm_i8x16_splat(13)));
+		wasm_v128_store(out, wasm_i8x16_add(indices,
+		    wasm_i8x16_swizzle(lut, reduced)));
+	}
+
+	return (i);
+}
+
+static const char VectorImplementation[] = "WebAssembly SIMD";
+static bool
+hasVectorSupport()
+{
+	return (true);
+}
+
+#elif defined(FRME_BASE64_NEON)
+
+/**
+ * @brief
+ * Encode 12-byte blocks with NEON.
+ *
+ * @return
+ * Number of bytes of `in` that were encoded (a multiple of 3).
+ */
+static size_t
+encodeVector(
+    const uint8_t *in,
+    const size_t size,
+    char *out)
+{
+	static const uint8_t shuffle[16] = {1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8,
+	    7, 10, 9, 11, 10};
+	/* Offsets to ASCII, selected by reduced index (see step 3) */
+	static const int8_t offsets[16] = {'a' - 26, '0' - 52, '0' - 52,
+	    '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+	    '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0};
+	const uint8x16_t shuffleMask = vld1q_u8(shuffle);
+	const uint8x16_t lut = vreinterpretq_u8_s8(vld1q_s8(offsets));
+
+	size_t i{};
+	/* Loads are 16 bytes wide, though only 12 are consumed */
+	for (; (i + 16) <= size; i += 12, out += 16) {
+		const uint16x8_t lanes = vreinterpretq_u16_u8(vqtbl1q_u8(
+		    vld1q_u8(in + i), shuffleMask));
+
+		const uint16x8_t hi = vorrq_u16(
+		    vshrq_n_u16(vandq_u16(lanes, vreinterpretq_u16_u32(
+		    vdupq_n_u32(0x0000FC00))), 10),
+		    vshrq_n_u16(vandq_u16(lanes, vreinterpretq_u16_u32(
+		    vdupq_n_u32(0x0FC00000))), 6));
+		const uint16x8_t lo = vorrq_u16(
+		    vshlq_n_u16(vandq_u16(lanes, vreinterpretq_u16_u32(
+		    vdupq_n_u32(0x000003F0))), 4),
+		    vshlq_n_u16(vandq_u16(lanes, vreinterpretq_u16_u32(
+		    vdupq_n_u32(0x003F0000))), 8));
+		const uint8x16_t indices = vreinterpretq_u8_u16(
+		    vorrq_u16(hi, lo));
+
+		uint8x16_t reduced = vqsubq_u8(indices, vdupq_n_u8(51));
+		reduced = vorrq_u8(reduced, vandq_u8(vcltq_u8(indices,
+		    vdupq_n_u8(26)), vdupq_n_u8(13)));
+		vst1q_u8(reinterpret_cast<uint8_t *>(out), vaddq_u8(indices,
+		    vqtbl1q_u8(lut, reduced)));
+	}
+
+	return (i);
+}
+
+static const char VectorImplementation[] = "NEON";
+static bool
+hasVectorSupport()
+{
+	return (true);
+}
+
+#elif defined(FRME_BASE64_SSSE3)
+
+/**
+ * @brief
+ * Encode 12-byte blocks with SSSE3.
+ *
+ * @return
+ * Number of bytes of `in` that were encoded (a multiple of 3).
+ */
+__attribute__((target("ssse3")))
+static size_t
+encodeVector(
+    const uint8_t *in,
+    const size_t size,
+    char *out)
+{
+	const __m128i shuffleMask = _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7,
+	    6, 8, 7, 10, 9, 11, 10);
+	/* Offsets to ASCII, selected by reduced index (see step 3) */
+	const __m128i lut = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52,
+	    '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+	    '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+
+	size_t i{};
+	/* Loads are 16 bytes wide, though only 12 are consumed */
+	for (; (i + 16) <= size; i += 12, out += 16) {
+		const __m128i lanes = _mm_shuffle_epi8(_mm_loadu_si128(
+		    reinterpret_cast<const __m128i *>(in + i)), shuffleMask);
+
+		/* Per-lane multiplies act as per-lane shifts */
+		const __m128i hi = _mm_mulhi_epu16(_mm_and_si128(lanes,
+		    _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+		const __m128i lo = _mm_mullo_epi16(_mm_and_si128(lanes,
+		    _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+		const __m128i indices = _mm_or_si128(hi, lo);
+
+		__m128i reduced = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+		reduced = _mm_or_si128(reduced, _mm_and_si128(_mm_cmpgt_epi8(
+		    _mm_set1_epi8(26), indices), _mm_set1_epi8(13)));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out),
+		    _mm_add_epi8(indices, _mm_shuffle_epi8(lut, reduced)));
+	}
+
+	return (i);
+}
+
+static const char VectorImplementation[] = "SSSE3";
+static bool
+hasVectorSupport()
+{
+#if defined(__SSSE3__)
+	return (true);
+#else
+	static const bool supported = __builtin_cpu_supports("ssse3");
+	return (supported);
+#endif
+}
+
+#endif
+
+std::string
+encodeBase64(
+    const uint8_t *data,
+    const size_t size)
+{
+	std::string encoded(((size + 2) / 3) * 4, '\0');
+	if (size == 0)
+		return (encoded);
+
+	size_t consumed{};
+	char *out = &encoded[0];
+#if defined(FRME_BASE64_WASM_SIMD128) || defined(FRME_BASE64_NEON) || \
+    defined(FRME_BASE64_SSSE3)
+	if (hasVectorSupport()) {
+		consumed = encodeVector(data, size, out);
+		out += (consumed / 3) * 4;
+	}
+#endif
+	encodeScalar(data + consumed, size - consumed, out);
+
+	return (encoded);
+}
+
+std::string
+getBase64Implementation()
+{
+#if defined(FRME_BASE64_WASM_SIMD128) || defined(FRME_BASE64_NEON) || \
+    defined(FRME_BASE64_SSSE3)
+	if (hasVectorSupport())
+		return (VectorImplementation);
+#endif
+	return ("scalar");
+}
@@ -0,0 +1,43 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef BASE64_H_
+#define BASE64_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief
+ * Encode bytes as Base64 (RFC 4648, with padding).
+ *
+ * @param data
+ * Bytes to encode.
+ * @param size
+ * Number of bytes at `data`.
+ *
+ * @return
+ * Base64 representation of `data`.
+ *
+ * @note
+ * Vectorized with WebAssembly SIMD (when built with -msimd128), NEON
+ * (AArch64), or SSSE3 (x86, checked at runtime), with a scalar fallback.
+ */
+std::string
+encodeBase64(
+    const uint8_t *data,
+    const size_t size);
+
+/** @return Name of the Base64 implementation encodeBase64() will use. */
+std::string
+getBase64Implementation();
+
+#endif /* BASE64_H_ */
@@ -0,0 +1,62 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include "content_hash.h"
+
+#include <stdexcept>
+
+#include <openssl/evp.h>
+
+#include "profile.h"
+
+ContentHash::ContentHash() :
+    context_{EVP_MD_CTX_new(), EVP_MD_CTX_free}
+{
+	if (!this->context_ || (EVP_DigestInit_ex(this->context_.get(),
+	    EVP_sha256(), nullptr) != 1))
+		throw std::runtime_error{"Could not begin SHA-256 digest"};
+}
+
+void
+ContentHash::update(
+    const uint8_t *data,
+    const size_t size)
+{
+	if (!this->context_)
+		throw std::runtime_error{"SHA-256 digest is already final"};
+
+	ScopedSpan span("SHA-256");
+	span.setBytes(size);
+	if (EVP_DigestUpdate(this->context_.get(), data, size) != 1)
+		throw std::runtime_error{"Could not update SHA-256 digest"};
+}
+
+std::string
+ContentHash::getDigest()
+{
+	if (!this->context_)
+		return (this->digest_);
+
+	unsigned char digest[EVP_MAX_MD_SIZE];
+	unsigned int digestSize{};
+	if (EVP_DigestFinal_ex(this->context_.get(), digest,
+	    &digestSize) != 1)
+		throw std::runtime_error{"Could not finish SHA-256 digest"};
+	this->context_.reset();
+
+	static const char Hex[] = "0123456789abcdef";
+	this->digest_.reserve(2 * digestSize);
+	for (unsigned int i{}; i < digestSize; ++i) {
+		this->digest_.push_back(Hex[digest[i] >> 4]);
+		this->digest_.push_back(Hex[digest[i] & 0x0F]);
+	}
+
+	return (this->digest_);
+}
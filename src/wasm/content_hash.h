@@ -0,0 +1,78 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef CONTENT_HASH_H_
+#define CONTENT_HASH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/* From <openssl/evp.h>, so that including this header doesn't need OpenSSL */
+struct evp_md_ctx_st;
+
+/**
+ * @brief
+ * SHA-256 digest of data supplied in pieces.
+ *
+ * @details
+ * Lets the client hash a file chunk by chunk as it is copied into
+ * WebAssembly memory, rather than reading it all again afterward. Computed
+ * with libcrypto.
+ */
+class ContentHash
+{
+public:
+	/**
+	 * @brief
+	 * Begin a digest.
+	 *
+	 * @throw std::runtime_error
+	 * libcrypto could not begin a SHA-256 digest.
+	 */
+	ContentHash();
+
+	/**
+	 * @brief
+	 * Add bytes to the digest.
+	 *
+	 * @param data
+	 * Bytes to add.
+	 * @param size
+	 * Number of bytes at `data`.
+	 *
+	 * @throw std::runtime_error
+	 * getDigest() has already been called, or libcrypto failed.
+	 */
+	void
+	update(
+	    const uint8_t *data,
+	    const size_t size);
+
+	/**
+	 * @return
+	 * SHA-256 digest of every byte added, as 64 lowercase hexadecimal
+	 * digits. Nothing more may be added once called.
+	 *
+	 * @throw std::runtime_error
+	 * libcrypto failed.
+	 */
+	std::string
+	getDigest();
+
+private:
+	/** libcrypto digest context, released once the digest is final */
+	std::unique_ptr<evp_md_ctx_st, void(*)(evp_md_ctx_st*)> context_;
+	/** Digest, once final */
+	std::string digest_{};
+};
+
+#endif /* CONTENT_HASH_H_ */
@@ -8,8 +8,11 @@
  * about its quality, reliability, or any other characteristic.
  */
 
-#include <emscripten.h>
-#include <emscripten/bind.h>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <type_traits>
+#include <utility>
 
 #include <be_data_interchange_an2k.h>
 #include <be_image_image.h>
@@ -17,56 +20,50 @@
 #include <be_text.h>
 
 #include "frme_an2k.h"
+#include "profile.h"
 
 namespace BE = BiometricEvaluation;
 
-static std::vector<BE::Finger::AN2KMinutiaeDataRecord>
+ImageRecordIndex::ImageRecordIndex(
+    const BE::DataInterchange::AN2KRecord &an2k) :
+    ImageRecordIndex(getFrictionRidgeImageIdentifiers(an2k))
+{
+
+}
+
+ImageRecordIndex::ImageRecordIndex(
+    const std::vector<RecordIdentifier> &identifiers)
+{
+	this->idcs_.reserve(identifiers.size());
+	for (const auto &id : identifiers)
+		this->idcs_.insert(id.idc);
+}
+
+bool
+ImageRecordIndex::contains(
+    const uint32_t idc)
+    const
+{
+	return (this->idcs_.find(idc) != this->idcs_.cend());
+}
+
+std::vector<BE::Finger::AN2KMinutiaeDataRecord>
 getUnassociatedMinutiaeData(
     const BE::DataInterchange::AN2KRecord &an2k)
 {
-	std::vector<BE::Finger::AN2KMinutiaeDataRecord> ret{};
-
-	for (const auto &m : an2k.getMinutiaeDataRecordSet()) {
-		bool foundAssociatedImage{false};
-		for (const auto &i : an2k.getFingerFixedResolutionCaptures()) {
-			if (m.getIDC() == i.getIDC()) {
-				foundAssociatedImage = true;
-				break;
-			}
+	return (getUnassociatedMinutiaeData(an2k, ImageRecordIndex(an2k)));
+}
 
-		}
-		if (foundAssociatedImage)
-			continue;
-
-		for (const auto &i : an2k.getFingerCaptures()) {
-			if (m.getIDC() == i.getIDC()) {
-				foundAssociatedImage = true;
-				break;
-			}
-		}
-		if (foundAssociatedImage)
-			continue;
-
-		for (const auto &i : an2k.getPalmCaptures()) {
-			if (m.getIDC() == i.getIDC()) {
-				foundAssociatedImage = true;
-				break;
-			}
-		}
-		if (foundAssociatedImage)
-			continue;
-
-		for (const auto &i : an2k.getFingerLatents()) {
-			if (m.getIDC() == i.getIDC()) {
-				foundAssociatedImage = true;
-				break;
-			}
-		}
-		if (foundAssociatedImage)
-			continue;
+std::vector<BE::Finger::AN2KMinutiaeDataRecord>
+getUnassociatedMinutiaeData(
+    const BE::DataInterchange::AN2KRecord &an2k,
+    const ImageRecordIndex &images)
+{
+	std::vector<BE::Finger::AN2KMinutiaeDataRecord> ret{};
 
-		ret.push_back(m);
-	}
+	for (auto &m : an2k.getMinutiaeDataRecordSet())
+		if (!images.contains(m.getIDC()))
+			ret.push_back(std::move(m));
 
 	return (ret);
 }
@@ -132,30 +129,196 @@ hasMinutiaeDataFormat(
 	}
 }
 
+/**
+ * @brief
+ * Wrap an image view without decoding it.
+ *
+ * @param view
+ * AN2K view whose image should be decoded only when first needed.
+ *
+ * @return
+ * ImageShim reporting `view`'s recorded dimensions and resolution until it is
+ * decoded.
+ */
+template<typename View>
+static ImageShim
+makeLazyImageShim(
+    View &&view)
+{
+	const auto v = std::make_shared<const std::decay_t<View>>(
+	    std::forward<View>(view));
+	const auto size = v->getImageSize();
+	const auto resolution = v->getImageResolution().toUnits(
+	    BE::Image::Resolution::Units::PPI);
+
+	return (ImageShim([v]() { return (v->getImage()); },
+	    size.xSize, size.ySize, static_cast<uint16_t>(std::round(
+	    resolution.xRes))));
+}
+
 std::vector<std::pair<ImageShim,
     std::vector<BE::Finger::AN2KMinutiaeDataRecord>>>
 getFrictionRidgeImagesWithMinutiaeData(
     const BE::DataInterchange::AN2KRecord &an2k)
 {
+	ScopedSpan span("records");
+
 	std::vector<std::pair<ImageShim,
 	    std::vector<BE::Finger::AN2KMinutiaeDataRecord>>> ret{};
 
-	for (const auto &i : an2k.getFingerFixedResolutionCaptures()) {
-		ret.emplace_back(i.getImage(), i.getMinutiaeDataRecordSet());
+	/* Images are decoded when the client first asks for pixels */
+	for (auto &i : an2k.getFingerFixedResolutionCaptures()) {
+		auto mdrs = i.getMinutiaeDataRecordSet();
+		ret.emplace_back(makeLazyImageShim(std::move(i)),
+		    std::move(mdrs));
 	}
-	for (const auto &i : an2k.getFingerCaptures()) {
-		ret.emplace_back(i.getImage(), i.getMinutiaeDataRecordSet());
+	for (auto &i : an2k.getFingerCaptures()) {
+		auto mdrs = i.getMinutiaeDataRecordSet();
+		ret.emplace_back(makeLazyImageShim(std::move(i)),
+		    std::move(mdrs));
 	}
-	for (const auto &i : an2k.getPalmCaptures()) {
-		ret.emplace_back(i.getImage(), i.getMinutiaeDataRecordSet());
+	for (auto &i : an2k.getPalmCaptures()) {
+		auto mdrs = i.getMinutiaeDataRecordSet();
+		ret.emplace_back(makeLazyImageShim(std::move(i)),
+		    std::move(mdrs));
 	}
-	for (const auto &i : an2k.getFingerLatents()) {
-		ret.emplace_back(i.getImage(), i.getMinutiaeDataRecordSet());
+	for (auto &i : an2k.getFingerLatents()) {
+		auto mdrs = i.getMinutiaeDataRecordSet();
+		ret.emplace_back(makeLazyImageShim(std::move(i)),
+		    std::move(mdrs));
 	}
 
 	return (ret);
 }
 
+/**
+ * @brief
+ * Parse an image record whose compression the index does not recognize.
+ *
+ * @param index
+ * Index of the transaction holding the record.
+ * @param position
+ * Position of the record in `index`.
+ *
+ * @return
+ * ImageShim that decodes the record's image the first time pixels are
+ * needed, or an empty ImageShim if the parsed record has no image.
+ *
+ * @note
+ * Only Type-1 and this record are parsed, so the rest of the transaction
+ * can still be indexed as it is read.
+ */
+static ImageShim
+parseUnrecognizedImage(
+    const AN2KIndex &index,
+    const size_t position)
+{
+	ScopedSpan span("parse image record");
+
+	auto transaction = index.extractRecords({position});
+	span.setBytes(transaction.size());
+	const BE::DataInterchange::AN2KRecord an2k(transaction);
+	const auto images = getFrictionRidgeImagesWithMinutiaeData(an2k);
+	if (images.empty())
+		return (ImageShim());
+
+	return (images.front().first);
+}
+
+std::vector<RecordIdentifier>
+getFrictionRidgeImageIdentifiers(
+    const BE::DataInterchange::AN2KRecord &an2k)
+{
+	std::vector<RecordIdentifier> ret{};
+
+	for (const auto &i : an2k.getFingerFixedResolutionCaptures())
+		ret.push_back({static_cast<uint16_t>(i.getRecordType()),
+		    static_cast<uint16_t>(i.getIDC())});
+	for (const auto &i : an2k.getFingerCaptures())
+		ret.push_back({static_cast<uint16_t>(i.getRecordType()),
+		    static_cast<uint16_t>(i.getIDC())});
+	for (const auto &i : an2k.getPalmCaptures())
+		ret.push_back({static_cast<uint16_t>(i.getRecordType()),
+		    static_cast<uint16_t>(i.getIDC())});
+	for (const auto &i : an2k.getFingerLatents())
+		ret.push_back({static_cast<uint16_t>(i.getRecordType()),
+		    static_cast<uint16_t>(i.getIDC())});
+
+	return (ret);
+}
+
+RecordSummary
+getRecordSummary(
+    const BE::DataInterchange::AN2KRecord &an2k)
+{
+	ScopedSpan span("summary");
+
+	return (getRecordSummary(getFrictionRidgeImageIdentifiers(an2k),
+	    an2k.getMinutiaeDataRecordSet()));
+}
+
+RecordSummary
+getRecordSummary(
+    const std::vector<RecordIdentifier> &images,
+    const std::vector<BE::Finger::AN2KMinutiaeDataRecord> &mdrs)
+{
+	/* Point systems stored as registered vendor blocks */
+	static const PointSystem VendorPointSystems[] = {
+	    PointSystem::IAFIS,
+	    PointSystem::Cogent,
+	    PointSystem::Motorola,
+	    PointSystem::Sagem,
+	    PointSystem::NEC,
+	    PointSystem::Identix,
+	    PointSystem::Other,
+	    PointSystem::M1};
+
+	RecordSummary summary{};
+
+	for (const auto &id : images) {
+		switch (id.recordType) {
+		case 13:
+			++summary.latentCount;
+			break;
+		case 14:
+			++summary.fingerCaptureCount;
+			break;
+		case 15:
+			++summary.palmCount;
+			break;
+		default:
+			++summary.fingerFixedResolutionCount;
+			break;
+		}
+	}
+	summary.hasFrictionRidgeImagery = !images.empty();
+
+	const auto found = [&summary](const PointSystem pointSystem) {
+		const auto value = static_cast<size_t>(pointSystem);
+		summary.pointSystems |= (1u << value);
+		++summary.pointSystemCounts[value];
+	};
+
+	const ImageRecordIndex imageIndex(images);
+	for (const auto &mdr : mdrs) {
+		++summary.minutiaeDataRecordCount;
+		if (!imageIndex.contains(mdr.getIDC()))
+			++summary.unassociatedMinutiaeDataRecordCount;
+
+		if (mdr.getAN2K7Minutiae() != nullptr)
+			found(PointSystem::Legacy);
+		if (mdr.getAN2K11EFS() != nullptr)
+			found(PointSystem::EFS);
+		for (const auto pointSystem : VendorPointSystems)
+			if (!mdr.getRegisteredVendorBlock(
+			    static_cast<BE::Feature::MinutiaeFormat>(
+			    pointSystem)).empty())
+				found(pointSystem);
+	}
+
+	return (summary);
+}
+
 std::vector<std::pair<ImageShim,
     std::vector<BE::Finger::AN2KMinutiaeDataRecord>>>
 getAllRecords(
@@ -163,24 +326,217 @@ getAllRecords(
 {
 	auto ret = getFrictionRidgeImagesWithMinutiaeData(an2k);
 
-	const auto minOnly = getUnassociatedMinutiaeData(an2k);
-	for (const auto &m : minOnly) {
+	const ImageRecordIndex images(an2k);
+	auto minOnly = getUnassociatedMinutiaeData(an2k, images);
+	for (auto &m : minOnly) {
 		ret.emplace_back(ImageShim(),
-		    std::vector<BE::Finger::AN2KMinutiaeDataRecord>{m});
+		    std::vector<BE::Finger::AN2KMinutiaeDataRecord>{
+		    std::move(m)});
 	}
 
 	return (ret);
 }
 
-std::vector<std::pair<PointSystem, std::vector<PointShim>>>
-getAllPoints(
+/** @return Whether or not `recordType` holds a friction ridge image */
+static bool
+isFrictionRidgeImageRecordType(
+    const uint16_t recordType)
+{
+	return (((recordType >= 3) && (recordType <= 6)) ||
+	    ((recordType >= 13) && (recordType <= 15)));
+}
+
+RecordStream::RecordStream(
+    std::shared_ptr<const BE::Memory::uint8Array> transaction) :
+    index_{transaction, 0}
+{
+
+}
+
+size_t
+RecordStream::append(
+    const size_t available)
+{
+	ScopedSpan span("append");
+
+	const size_t previousRecordCount{this->records_.size()};
+	const size_t previousIndexCount{this->index_.getRecordCount()};
+	this->index_.update(available);
+	if (this->index_.getRecordCount() == 0)
+		return (0);
+
+	/* Type-1 lists every record to come */
+	if (previousIndexCount == 0) {
+		for (const auto &listed : this->index_.getListedRecords()) {
+			if (isFrictionRidgeImageRecordType(listed.recordType))
+				this->identifiers_.push_back(listed);
+			else if (listed.recordType == 9)
+				++this->expectedMinutiaeDataRecordCount_;
+		}
+		this->summary_ = ::getRecordSummary(this->identifiers_, {});
+		this->summary_.minutiaeDataRecordCount = static_cast<uint32_t>(
+		    this->expectedMinutiaeDataRecordCount_);
+	}
+
+	for (size_t i{std::max<size_t>(previousIndexCount, 1)};
+	    i < this->index_.getRecordCount(); ++i) {
+		const auto &entry = this->index_.getRecord(i);
+		if (isFrictionRidgeImageRecordType(entry.recordType)) {
+			const auto mdrs = this->minutiae_.find(entry.idc);
+			ImageShim image{};
+			if (entry.hasImage)
+				image = this->index_.getImage(i);
+			else if (entry.hasUnrecognizedImage)
+				image = parseUnrecognizedImage(this->index_, i);
+
+			this->recordPositions_.push_back(i);
+			this->records_.emplace_back(image,
+			    (mdrs == this->minutiae_.cend()) ?
+			    std::vector<BE::Finger::AN2KMinutiaeDataRecord>{} :
+			    mdrs->second);
+		} else if (entry.recordType == 9) {
+			this->minutiaeDataRecordPositions_.push_back(i);
+		}
+	}
+
+	if (!this->hasMinutiaeData_ &&
+	    (this->minutiaeDataRecordPositions_.size() ==
+	    this->expectedMinutiaeDataRecordCount_))
+		this->parseMinutiaeData();
+
+	return (this->records_.size() - previousRecordCount);
+}
+
+void
+RecordStream::parseMinutiaeData()
+{
+	ScopedSpan span("parse Type-9");
+
+	/* Parse a transaction of only Type-1 and the Type-9 records */
+	std::vector<BE::Finger::AN2KMinutiaeDataRecord> mdrs{};
+	if (!this->minutiaeDataRecordPositions_.empty()) {
+		auto transaction = this->index_.extractRecords(
+		    this->minutiaeDataRecordPositions_);
+		span.setBytes(transaction.size());
+		const BE::DataInterchange::AN2KRecord an2k(transaction);
+		mdrs = an2k.getMinutiaeDataRecordSet();
+	}
+	this->summary_ = ::getRecordSummary(this->identifiers_, mdrs);
+
+	for (auto &mdr : mdrs)
+		this->minutiae_[mdr.getIDC()].push_back(std::move(mdr));
+	for (size_t i{}; i < this->records_.size(); ++i) {
+		const auto found = this->minutiae_.find(this->index_.getRecord(
+		    this->recordPositions_[i]).idc);
+		if (found != this->minutiae_.cend())
+			this->records_[i].second = found->second;
+	}
+
+	this->hasMinutiaeData_ = true;
+}
+
+bool
+RecordStream::isComplete()
+    const
+{
+	return (this->index_.isComplete() && this->hasMinutiaeData_);
+}
+
+size_t
+RecordStream::getExpectedRecordCount()
+    const
+{
+	return (this->identifiers_.size());
+}
+
+size_t
+RecordStream::getRecordCount()
+    const
+{
+	return (this->records_.size());
+}
+
+const RecordStream::Record&
+RecordStream::getRecord(
+    const size_t i)
+    const
+{
+	return (this->records_.at(i));
+}
+
+const AN2KIndexEntry&
+RecordStream::getRecordEntry(
+    const size_t i)
+    const
+{
+	return (this->index_.getRecord(this->recordPositions_.at(i)));
+}
+
+bool
+RecordStream::hasMinutiaeData()
+    const
+{
+	return (this->hasMinutiaeData_);
+}
+
+const RecordSummary&
+RecordStream::getRecordSummary()
+    const
+{
+	return (this->summary_);
+}
+
+const std::vector<RecordIdentifier>&
+RecordStream::getFrictionRidgeImageIdentifiers()
+    const
+{
+	return (this->identifiers_);
+}
+
+/**
+ * @brief
+ * Gather points into a PointSet and convert them to pixels.
+ *
+ * @param minutiae
+ * BiometricEvaluation::Feature::MinutiaPointSet or similar.
+ * @param context
+ * Properties of the image the points describe.
+ *
+ * @return
+ * `minutiae`, converted from `System` to pixels.
+ */
+template<PointSystem System, typename Minutiae>
+static PointSet
+toPixelPointSet(
+    const Minutiae &minutiae,
+    const PointConversionContext &context)
+{
+	PointSet points{};
+	points.system = System;
+	points.reserve(minutiae.size());
+	for (const auto &point : minutiae)
+		points.push_back(point.coordinate.x, point.coordinate.y,
+		    point.theta, point.has_type ?
+		    PointShim::convertType(point.type) :
+		    PointShim::Type::Other);
+
+	convertPoints<System>(points, context);
+	return (points);
+}
+
+std::vector<PointSet>
+getAllPointSets(
     const ImageShim &image,
     const std::vector<BE::Finger::AN2KMinutiaeDataRecord> &mdrs)
 {
 	if (!image)
 		return {};
 
-	std::vector<std::pair<PointSystem, std::vector<PointShim>>> pointSets{};
+	ScopedSpan span("points");
+	std::vector<PointSet> pointSets{};
+
+	/* Image properties are constant for every point */
+	const PointConversionContext context(image);
 
 	for (const auto &mdr : mdrs) {
 		/*
@@ -188,21 +544,10 @@ getAllPoints(
 		 */
 		const auto minLegacy = mdr.getAN2K7Minutiae();
 		if (minLegacy != nullptr) {
-			std::vector<PointShim> points{};
-			for (const auto &point :
-			    minLegacy->getMinutiaPoints()) {
-				points.emplace_back(point.coordinate.x,
-				    point.coordinate.y, point.theta,
-				    point.has_type ?
-				    PointShim::convertType(point.type) :
-				    PointShim::Type::Other);
-				points.back().convertFromSystemRepresentation(
-				    PointSystem::Legacy, image);
-
-			}
+			auto points = toPixelPointSet<PointSystem::Legacy>(
+			    minLegacy->getMinutiaPoints(), context);
 			if (!points.empty())
-				pointSets.emplace_back(PointSystem::Legacy,
-				    points);
+				pointSets.push_back(std::move(points));
 		}
 
 		/*
@@ -210,128 +555,29 @@ getAllPoints(
 		 */
 		const auto efs = mdr.getAN2K11EFS();
 		if (efs != nullptr) {
-			std::vector<PointShim> points{};
-			for (const auto &point : efs->getMPS()) {
-				points.emplace_back(point.coordinate.x,
-				    point.coordinate.y, point.theta,
-				    point.has_type ?
-				    PointShim::convertType(point.type) :
-				    PointShim::Type::Other);
-				points.back().convertFromSystemRepresentation(
-				    PointSystem::EFS, image);
-
-			}
+			auto points = toPixelPointSet<PointSystem::EFS>(
+			    efs->getMPS(), context);
 			if (!points.empty())
-				pointSets.emplace_back(PointSystem::EFS,
-				    points);
+				pointSets.push_back(std::move(points));
 		}
 	}
 
+	size_t count{};
+	for (const auto &points : pointSets)
+		count += points.size();
+	span.setBytes(count * ((3 * sizeof(uint32_t)) + sizeof(uint8_t)));
+
 	return (pointSets);
 }
 
-/******************************************************************************/
-
-EMSCRIPTEN_BINDINGS(frme)
+std::vector<std::pair<PointSystem, std::vector<PointShim>>>
+getAllPoints(
+    const ImageShim &image,
+    const std::vector<BE::Finger::AN2KMinutiaeDataRecord> &mdrs)
 {
-	/*
-	 * Bindings for functions.
-	 */
-	emscripten::function("hasFrictionRidgeImagery",
-	    &hasFrictionRidgeImagery);
-	emscripten::function("getAllPoints", &getAllPoints);
-	emscripten::function("getAllRecords", &getAllRecords);
-	emscripten::function("hasMinutiaeDataFormat", &hasMinutiaeDataFormat);
-	emscripten::function("getFrictionRidgeImagesWithMinutiaeData",
-	    &getFrictionRidgeImagesWithMinutiaeData);
-
-	/*
-	 * Bindings for DataInterchange::AN2KRecord.
-	 */
-	emscripten::class_<BE::DataInterchange::AN2KRecord>("AN2K")
-	    .constructor<std::string>()
-	    .class_function("isAN2K", emscripten::select_overload<
-	        bool(const std::string&)>(
-	        &BE::DataInterchange::AN2KRecord::isAN2KRecord));
-
-	/*
-	 * Bindings for AN2KMinutiaeDataRecord.
-	 */
-	emscripten::class_<BE::Finger::AN2KMinutiaeDataRecord>(
-	    "AN2KMinutiaeDataRecord");
-	emscripten::register_vector<BE::Finger::AN2KMinutiaeDataRecord>(
-	    "VectorAN2KMinutiaeDataRecord");
-
-
-	/*
-	 * Bindings for PointSystem.
-	 */
-	emscripten::value_object<std::pair<PointSystem,
-	        std::vector<PointShim>>>("PointSystemVectorPointShimPair")
-	    .field("system", &std::pair<PointSystem,
-	        std::vector<PointShim>>::first)
-	    .field("points", &std::pair<PointSystem,
-	        std::vector<PointShim>>::second);
-
-	/*
-	 * Combinations/Collections.
-	 */
-	emscripten::value_object<std::pair<ImageShim,
-	        std::vector<BE::Finger::AN2KMinutiaeDataRecord>>>(
-	        "ImageShimMinutiaeDataPair")
-	    .field("image", &std::pair<ImageShim,
-	        std::vector<BE::Finger::AN2KMinutiaeDataRecord>>::first)
-	    .field("minutiaeDataRecords", &std::pair<ImageShim,
-	        std::vector<BE::Finger::AN2KMinutiaeDataRecord>>::second);
-
-	emscripten::register_vector<std::pair<FrictionRidgeImage,
-	    std::vector<BE::Finger::AN2KMinutiaeDataRecord>>>(
-	    "VectorImageMinutiaeDataPair");
-	emscripten::register_vector<std::pair<ImageShim,
-	    std::vector<BE::Finger::AN2KMinutiaeDataRecord>>>(
-	    "VectorImageShimMinutiaeDataPair");
-
-	emscripten::register_vector<std::pair<PointSystem,
-	    std::vector<PointShim>>>("VectorPointSystemVectorPointShimPair");
-}
-
-/*
- * Unused bindings.
- */
+	std::vector<std::pair<PointSystem, std::vector<PointShim>>> pointSets{};
+	for (const auto &points : getAllPointSets(image, mdrs))
+		pointSets.emplace_back(points.system, points.toPointShims());
 
-#if 0
-EMSCRIPTEN_BINDINGS(unused)
-{
-	/*
-	 * Bindings for uint8Array.
-	 */
-	emscripten::register_vector<uint8_t>("VectorUInt8T");
-	emscripten::class_<BE::Memory::uint8Array>("BE_uint8Array")
-	    .function("to_vector", &BE::Memory::uint8Array::to_vector);
-
-	/*
-	 * Bindings for Image::Image.
-	 */
-	emscripten::class_<BE::Image::Image>("BEImageImage")
-	    .smart_ptr<std::shared_ptr<BE::Image::Image>>("BEImageImage");
-
-	/*
-	 * Bindings for Finger::AN2KViewFixedResolution.
-	 */
-	emscripten::class_<BE::Finger::AN2KViewFixedResolution>(
-	    "Finger_AN2KViewFixedResolution");
-
-	/*
-	 * Bindings for FrictionRidgeImage (variant).
-	 */
-	emscripten::class_<FrictionRidgeImage>("FrictionRidgeImage");
-	emscripten::register_vector<FrictionRidgeImage>(
-	    "VectorFrictionRidgeImage");
-
-	/*
-	 * Combinations/Collections.
-	 */
-	emscripten::class_<std::pair<FrictionRidgeImage, std::vector<
-	    BE::Finger::AN2KMinutiaeDataRecord>>>("ImageMinutiaeDataPair");
+	return (pointSets);
 }
-#endif
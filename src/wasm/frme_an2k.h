@@ -11,17 +11,21 @@
 #ifndef FRME_WASM_H_
 #define FRME_WASM_H_
 
+#include <array>
+#include <cstddef>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <variant>
+#include <vector>
 
 #include <be_data_interchange_an2k.h>
 
+#include "an2k_index.h"
 #include "image_shim.h"
 #include "point_shim.h"
 
-/** Where WebAssembly writes files */
-static const std::string UPLOADED_FILE_NAME{"/UPLOAD"};
-
 /** All supported BiometricEvaluation friction ridge types */
 using FrictionRidgeImage = std::variant<
     BiometricEvaluation::Finger::AN2KViewFixedResolution,
@@ -35,6 +39,271 @@ std::vector<std::pair<ImageShim,
 getFrictionRidgeImagesWithMinutiaeData(
     const BiometricEvaluation::DataInterchange::AN2KRecord &an2k);
 
+/**
+ * @return
+ * Record type and IDC of each image returned by
+ * getFrictionRidgeImagesWithMinutiaeData(), in the same order.
+ */
+std::vector<RecordIdentifier>
+getFrictionRidgeImageIdentifiers(
+    const BiometricEvaluation::DataInterchange::AN2KRecord &an2k);
+
+/**
+ * @brief
+ * Image records of a transaction, by IDC.
+ *
+ * @details
+ * Built once per transaction so that associating Type-9 records with images
+ * takes constant time per lookup instead of a scan of every image view.
+ * getAllRecords() builds one and shares it with
+ * getUnassociatedMinutiaeData().
+ */
+class ImageRecordIndex
+{
+public:
+	/** Index the images of `an2k` */
+	explicit ImageRecordIndex(
+	    const BiometricEvaluation::DataInterchange::AN2KRecord &an2k);
+
+	/**
+	 * @brief
+	 * Index images by identifier.
+	 *
+	 * @param identifiers
+	 * Identifiers of images, as from getFrictionRidgeImageIdentifiers().
+	 */
+	explicit ImageRecordIndex(
+	    const std::vector<RecordIdentifier> &identifiers);
+
+	/** @return true if any image record has `idc` */
+	bool
+	contains(
+	    const uint32_t idc)
+	    const;
+
+private:
+	std::unordered_set<uint32_t> idcs_{};
+};
+
+/** @return Type-9 records whose IDC does not match any image record */
+std::vector<BiometricEvaluation::Finger::AN2KMinutiaeDataRecord>
+getUnassociatedMinutiaeData(
+    const BiometricEvaluation::DataInterchange::AN2KRecord &an2k);
+
+/**
+ * @return
+ * Type-9 records whose IDC is not in `images`, an index of `an2k`'s images.
+ */
+std::vector<BiometricEvaluation::Finger::AN2KMinutiaeDataRecord>
+getUnassociatedMinutiaeData(
+    const BiometricEvaluation::DataInterchange::AN2KRecord &an2k,
+    const ImageRecordIndex &images);
+
+/**
+ * @return
+ * Collection of fingerprint/minutiae object pairs, followed by pairs of empty
+ * images and any unassociated minutiae.
+ */
+std::vector<std::pair<ImageShim,
+    std::vector<BiometricEvaluation::Finger::AN2KMinutiaeDataRecord>>>
+getAllRecords(
+    const BiometricEvaluation::DataInterchange::AN2KRecord &an2k);
+
+/** Contents of a transaction, as needed to summarize it */
+struct RecordSummary
+{
+	/** Bit (1 << PointSystem) set for each point system present */
+	uint32_t pointSystems{};
+	/** Number of Type-9 records containing each PointSystem, by value */
+	std::array<uint32_t, PointSystemCount> pointSystemCounts{};
+
+	/** Number of Type-3 through Type-6 records */
+	uint32_t fingerFixedResolutionCount{};
+	/** Number of Type-14 records */
+	uint32_t fingerCaptureCount{};
+	/** Number of Type-15 records */
+	uint32_t palmCount{};
+	/** Number of Type-13 records */
+	uint32_t latentCount{};
+	/** Whether or not there are any friction ridge images */
+	bool hasFrictionRidgeImagery{false};
+
+	/** Number of Type-9 records */
+	uint32_t minutiaeDataRecordCount{};
+	/** Number of Type-9 records whose IDC matches no image record */
+	uint32_t unassociatedMinutiaeDataRecordCount{};
+};
+
+/**
+ * @return
+ * Summary of `an2k`, gathered in a single pass over its records.
+ */
+RecordSummary
+getRecordSummary(
+    const BiometricEvaluation::DataInterchange::AN2KRecord &an2k);
+
+/**
+ * @brief
+ * Summarize a transaction from its parts.
+ *
+ * @param images
+ * Record type and IDC of each friction ridge image record.
+ * @param mdrs
+ * Every Type-9 record in the transaction.
+ *
+ * @return
+ * Summary of the transaction.
+ */
+RecordSummary
+getRecordSummary(
+    const std::vector<RecordIdentifier> &images,
+    const std::vector<BiometricEvaluation::Finger::AN2KMinutiaeDataRecord>
+    &mdrs);
+
+/**
+ * @brief
+ * Friction ridge image records of a transaction, available as it is read.
+ *
+ * @details
+ * The client copies the transaction into a buffer in chunks, calling
+ * append() after each. Image records are indexed, not parsed, so each is
+ * available from getRecord() as soon as its last byte is read, in
+ * transaction order, and is decoded only when its pixels are first needed.
+ * Once the last Type-9 record is read, the Type-9 records alone are parsed,
+ * and the summary and every record's minutiae become available. The first
+ * image can therefore be displayed long before a large transaction has been
+ * read, and the images are never copied out of the transaction.
+ */
+class RecordStream
+{
+public:
+	/** (image, minutiae data records) pair, as displayed by the client */
+	using Record = std::pair<ImageShim,
+	    std::vector<BiometricEvaluation::Finger::AN2KMinutiaeDataRecord>>;
+
+	/**
+	 * @brief
+	 * Prepare to read a transaction.
+	 *
+	 * @param transaction
+	 * Buffer the size of the entire ANSI/NIST-ITL transaction, to be filled
+	 * from the start. Shared with the stream's records.
+	 */
+	explicit RecordStream(
+	    std::shared_ptr<const BiometricEvaluation::Memory::uint8Array>
+	    transaction);
+
+	/**
+	 * @brief
+	 * Process the bytes read since the last call.
+	 *
+	 * @param available
+	 * Number of bytes at the start of the transaction that have been read.
+	 *
+	 * @return
+	 * Number of records newly available from getRecord().
+	 *
+	 * @throw std::runtime_error
+	 * The bytes available are not the start of a well-formed transaction.
+	 * @throw BiometricEvaluation::Error::Exception
+	 * Type-9 records could not be parsed.
+	 */
+	size_t
+	append(
+	    const size_t available);
+
+	/** @return Whether or not every record has been read and parsed */
+	bool
+	isComplete()
+	    const;
+
+	/**
+	 * @return
+	 * Number of friction ridge image records in the transaction, or 0 until
+	 * the Type-1 record has been read.
+	 */
+	size_t
+	getExpectedRecordCount()
+	    const;
+
+	/** @return Number of friction ridge image records available so far */
+	size_t
+	getRecordCount()
+	    const;
+
+	/**
+	 * @return
+	 * Friction ridge image record `i`, in transaction order. Its minutiae
+	 * data records are empty until hasMinutiaeData().
+	 *
+	 * @throw std::out_of_range
+	 * `i` is not less than getRecordCount().
+	 */
+	const Record&
+	getRecord(
+	    const size_t i)
+	    const;
+
+	/**
+	 * @return
+	 * Location of record `i` within the transaction, so that its image may
+	 * be decoded elsewhere.
+	 *
+	 * @throw std::out_of_range
+	 * `i` is not less than getRecordCount().
+	 */
+	const AN2KIndexEntry&
+	getRecordEntry(
+	    const size_t i)
+	    const;
+
+	/** @return Whether or not the Type-9 records have been parsed */
+	bool
+	hasMinutiaeData()
+	    const;
+
+	/**
+	 * @return
+	 * Summary of the transaction. Only record counts are known until
+	 * hasMinutiaeData().
+	 */
+	const RecordSummary&
+	getRecordSummary()
+	    const;
+
+	/**
+	 * @return
+	 * Record type and IDC of each friction ridge image record, in
+	 * transaction order, including those not yet available.
+	 */
+	const std::vector<RecordIdentifier>&
+	getFrictionRidgeImageIdentifiers()
+	    const;
+
+private:
+	/** Parse the Type-9 records and associate them with images */
+	void
+	parseMinutiaeData();
+
+	/** Records of the transaction, indexed as they are read */
+	AN2KIndex index_;
+	/** Number of Type-9 records listed by Type-1 */
+	size_t expectedMinutiaeDataRecordCount_{};
+	/** Positions in index_ of the Type-9 records read so far */
+	std::vector<size_t> minutiaeDataRecordPositions_{};
+	/** Parsed Type-9 records, by IDC */
+	std::unordered_map<uint32_t, std::vector<
+	    BiometricEvaluation::Finger::AN2KMinutiaeDataRecord>> minutiae_{};
+	/** Whether or not minutiae_ has been populated */
+	bool hasMinutiaeData_{false};
+
+	/** Positions in index_ of records_ */
+	std::vector<size_t> recordPositions_{};
+	std::vector<Record> records_{};
+	std::vector<RecordIdentifier> identifiers_{};
+	RecordSummary summary_{};
+};
+
 /** @return true if record contains any friction ridge images */
 bool
 hasFrictionRidgeImagery(
@@ -46,6 +315,18 @@ hasMinutiaeDataFormat(
     const BiometricEvaluation::DataInterchange::AN2KRecord &an2k,
     const PointSystem pointSystem);
 
+/**
+ * @return
+ * All minutiae sets found in a record for an image, converted to pixels.
+ * @note
+ * `image` required strictly to obtain PPI to convert EFS coordinates to pixels.
+ */
+std::vector<PointSet>
+getAllPointSets(
+    const ImageShim &image,
+    const std::vector<BiometricEvaluation::Finger::AN2KMinutiaeDataRecord>
+    &mdrs);
+
 /**
  * @return
  * Collection of all minutiae sets found in a record for an image
@@ -0,0 +1,503 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+/*
+ * JavaScript bindings for the WebAssembly build. Everything else in this
+ * directory is plain C++ and is also compiled natively.
+ */
+
+#include <memory>
+#include <stdexcept>
+
+#include <emscripten.h>
+#include <emscripten/bind.h>
+#include <emscripten/val.h>
+
+#include <be_data_interchange_an2k.h>
+#include <be_image_image.h>
+#include <be_memory_autoarray.h>
+
+#include "an2k_index.h"
+#include "content_hash.h"
+#include "frme_an2k.h"
+#include "image_cache.h"
+#include "image_shim.h"
+#include "parse_session.h"
+#include "point_index.h"
+#include "point_shim.h"
+
+namespace BE = BiometricEvaluation;
+
+EMSCRIPTEN_BINDINGS(easyimage) {
+	emscripten::enum_<PNGFilter>("PNGFilter")
+	    .value("None", PNGFilter::None)
+	    .value("Sub", PNGFilter::Sub)
+	    .value("Up", PNGFilter::Up)
+	    .value("Average", PNGFilter::Average)
+	    .value("Paeth", PNGFilter::Paeth)
+	    .value("Adaptive", PNGFilter::Adaptive)
+	    ;
+
+	emscripten::enum_<DeflateStrategy>("DeflateStrategy")
+	    .value("Default", DeflateStrategy::Default)
+	    .value("Filtered", DeflateStrategy::Filtered)
+	    .value("HuffmanOnly", DeflateStrategy::HuffmanOnly)
+	    .value("RLE", DeflateStrategy::RLE)
+	    ;
+
+	emscripten::value_object<PNGEncoding>("PNGEncoding")
+	    .field("compressionLevel", &PNGEncoding::compressionLevel)
+	    .field("filter", &PNGEncoding::filter)
+	    .field("strategy", &PNGEncoding::strategy)
+	    ;
+	emscripten::function("getPNGEncodingForDisplay",
+	    &PNGEncoding::forDisplay);
+	emscripten::function("getPNGEncodingForArchival",
+	    &PNGEncoding::forArchival);
+
+	emscripten::class_<ImageShim>("ImageShim")
+	    .function("getBase64PNG", &ImageShim::getBase64PNG)
+	    /* Returns a Uint8Array owned by JavaScript */
+	    .function("getPNG", emscripten::optional_override(
+	        [](const ImageShim &i, const PNGEncoding &encoding) {
+	        	const auto png = i.getPNG(encoding);
+	        	return (emscripten::val(emscripten::typed_memory_view(
+	        	    png.size(), png.data())).call<emscripten::val>(
+	        	    "slice"));
+	        }))
+	    .function("containsImage", emscripten::optional_override(
+	        [](const ImageShim &i) { return static_cast<bool>(i); }))
+	    .function("getWidth", &ImageShim::getWidth)
+	    .function("getHeight", &ImageShim::getHeight)
+	    .function("getPPI", &ImageShim::getPPI)
+	    /*
+	     * Views of WebAssembly memory. Views are invalidated if memory
+	     * grows, so copy out (e.g., putImageData()) before calling back
+	     * into WebAssembly.
+	     */
+	    .function("getGrayscalePixels", emscripten::optional_override(
+	        [](const ImageShim &i) {
+	        	const auto &p = i.getGrayscalePixels();
+	        	return (emscripten::val(emscripten::typed_memory_view(
+	        	    p.size(), p.data())));
+	        }))
+	    .function("getRGBAPixels", emscripten::optional_override(
+	        [](const ImageShim &i, const uint32_t level) {
+	        	const auto &p = i.getRGBAPixels(level);
+	        	return (emscripten::val(emscripten::typed_memory_view(
+	        	    p.size(), p.data())));
+	        }))
+	    .function("getPyramidLevelCount", &ImageShim::getPyramidLevelCount)
+	    .function("getPyramidLevelForSize",
+	        &ImageShim::getPyramidLevelForSize)
+	    .function("getPyramidLevelWidth", &ImageShim::getPyramidLevelWidth)
+	    .function("getPyramidLevelHeight",
+	        &ImageShim::getPyramidLevelHeight)
+	    ;
+
+	emscripten::value_object<ImageCacheStatistics>("ImageCacheStatistics")
+	    .field("hits", &ImageCacheStatistics::hits)
+	    .field("misses", &ImageCacheStatistics::misses)
+	    .field("evictions", &ImageCacheStatistics::evictions)
+	    .field("bytes", &ImageCacheStatistics::bytes)
+	    .field("peakBytes", &ImageCacheStatistics::peakBytes)
+	    .field("budget", &ImageCacheStatistics::budget)
+	    .field("entries", &ImageCacheStatistics::entries)
+	    ;
+	emscripten::function("getImageCacheStatistics",
+	    emscripten::optional_override([]() {
+	        return (ImageCache::getInstance().getStatistics()); }));
+	emscripten::function("setImageCacheBudget",
+	    emscripten::optional_override([](const size_t budget) {
+	        ImageCache::getInstance().setBudget(budget); }));
+	emscripten::function("resetImageCacheStatistics",
+	    emscripten::optional_override([]() {
+	        ImageCache::getInstance().resetStatistics(); }));
+}
+
+EMSCRIPTEN_BINDINGS(point_shim)
+{
+	emscripten::enum_<PointShim::Type>("MinutiaeType")
+	    .value("RidgeEnding", PointShim::Type::RidgeEnding)
+	    .value("Bifurcation", PointShim::Type::Bifurcation)
+	    .value("Core", PointShim::Type::Core)
+	    .value("Delta", PointShim::Type::Delta)
+	    .value("Other", PointShim::Type::Other)
+	    ;
+
+	emscripten::enum_<PointSystem>("PointSystem")
+	    .value("Legacy", PointSystem::Legacy)
+	    .value("IAFIS", PointSystem::IAFIS)
+	    .value("Cogent", PointSystem::Cogent)
+	    .value("Motorola", PointSystem::Motorola)
+	    .value("Sagem", PointSystem::Sagem)
+	    .value("NEC", PointSystem::NEC)
+	    .value("Identix", PointSystem::Identix)
+	    .value("M1", PointSystem::M1)
+	    .value("Other", PointSystem::Other)
+	    .value("EFS", PointSystem::EFS)
+	    ;
+
+	emscripten::class_<PointShim>("PointShim")
+	    .property("x", &PointShim::x_)
+	    .property("y", &PointShim::y_)
+	    .property("angle", &PointShim::angle_)
+	    .property("type", &PointShim::type_)
+	    ;
+
+	emscripten::register_vector<PointShim>("VectorPointShim");
+
+	/*
+	 * Views of WebAssembly memory, valid until memory grows. Read them
+	 * (e.g., draw) before calling back into WebAssembly.
+	 */
+	emscripten::class_<PointSet>("PointSet")
+	    .property("system", &PointSet::system)
+	    .function("size", &PointSet::size)
+	    .function("getX", emscripten::optional_override(
+	        [](const PointSet &p) {
+	        	return (emscripten::val(emscripten::typed_memory_view(
+	        	    p.x.size(), p.x.data())));
+	        }))
+	    .function("getY", emscripten::optional_override(
+	        [](const PointSet &p) {
+	        	return (emscripten::val(emscripten::typed_memory_view(
+	        	    p.y.size(), p.y.data())));
+	        }))
+	    .function("getAngle", emscripten::optional_override(
+	        [](const PointSet &p) {
+	        	return (emscripten::val(emscripten::typed_memory_view(
+	        	    p.angle.size(), p.angle.data())));
+	        }))
+	    .function("getType", emscripten::optional_override(
+	        [](const PointSet &p) {
+	        	return (emscripten::val(emscripten::typed_memory_view(
+	        	    p.type.size(), p.type.data())));
+	        }))
+	    ;
+	emscripten::register_vector<PointSet>("VectorPointSet");
+
+	/*
+	 * Grid over a PointSet, for finding the minutia under the cursor.
+	 * nearest() returns -1 (PointIndex::NoPoint) if none is close enough.
+	 */
+	emscripten::class_<PointIndex>("PointIndex")
+	    .constructor<const PointSet&>()
+	    /* From Uint32Arrays (e.g., copies of a PointSet's getX()/getY()) */
+	    .class_function("fromCoordinates", emscripten::optional_override(
+	        [](const emscripten::val &x, const emscripten::val &y) {
+	        	using emscripten::convertJSArrayToNumberVector;
+	        	return (PointIndex(
+	        	    convertJSArrayToNumberVector<uint32_t>(x),
+	        	    convertJSArrayToNumberVector<uint32_t>(y)));
+	        }))
+	    .function("size", &PointIndex::size)
+	    .function("nearest", &PointIndex::nearest)
+	    /* Returns a Uint32Array owned by JavaScript */
+	    .function("query", emscripten::optional_override(
+	        [](const PointIndex &p, const uint32_t left, const uint32_t top,
+	        const uint32_t right, const uint32_t bottom) {
+	        	const auto found = p.query(left, top, right, bottom);
+	        	return (emscripten::val(emscripten::typed_memory_view(
+	        	    found.size(), found.data())).call<emscripten::val>(
+	        	    "slice"));
+	        }))
+	    ;
+
+	emscripten::function("getPointSystemName", &getPointSystemName);
+}
+
+EMSCRIPTEN_BINDINGS(frme)
+{
+	/*
+	 * Bindings for functions.
+	 */
+	emscripten::function("hasFrictionRidgeImagery",
+	    &hasFrictionRidgeImagery);
+	emscripten::function("getAllPoints", &getAllPoints);
+	emscripten::function("getAllPointSets", &getAllPointSets);
+	emscripten::function("getAllRecords", &getAllRecords);
+	emscripten::function("hasMinutiaeDataFormat", &hasMinutiaeDataFormat);
+	emscripten::function("getRecordSummary", emscripten::select_overload<
+	    RecordSummary(const BE::DataInterchange::AN2KRecord&)>(
+	    &getRecordSummary));
+	emscripten::function("getFrictionRidgeImagesWithMinutiaeData",
+	    &getFrictionRidgeImagesWithMinutiaeData);
+	emscripten::function("getFrictionRidgeImageIdentifiers",
+	    &getFrictionRidgeImageIdentifiers);
+
+	emscripten::value_object<RecordIdentifier>("RecordIdentifier")
+	    .field("recordType", &RecordIdentifier::recordType)
+	    .field("idc", &RecordIdentifier::idc)
+	    ;
+	emscripten::register_vector<RecordIdentifier>("VectorRecordIdentifier");
+
+	/*
+	 * Bindings for RecordSummary.
+	 */
+	emscripten::value_array<std::array<uint32_t, PointSystemCount>>(
+	        "PointSystemCounts")
+	    .element(emscripten::index<0>())
+	    .element(emscripten::index<1>())
+	    .element(emscripten::index<2>())
+	    .element(emscripten::index<3>())
+	    .element(emscripten::index<4>())
+	    .element(emscripten::index<5>())
+	    .element(emscripten::index<6>())
+	    .element(emscripten::index<7>())
+	    .element(emscripten::index<8>())
+	    .element(emscripten::index<9>())
+	    ;
+	static_assert(PointSystemCount == 10, "Update PointSystemCounts");
+
+	emscripten::value_object<RecordSummary>("RecordSummary")
+	    .field("pointSystems", &RecordSummary::pointSystems)
+	    .field("pointSystemCounts", &RecordSummary::pointSystemCounts)
+	    .field("fingerFixedResolutionCount",
+	        &RecordSummary::fingerFixedResolutionCount)
+	    .field("fingerCaptureCount", &RecordSummary::fingerCaptureCount)
+	    .field("palmCount", &RecordSummary::palmCount)
+	    .field("latentCount", &RecordSummary::latentCount)
+	    .field("hasFrictionRidgeImagery",
+	        &RecordSummary::hasFrictionRidgeImagery)
+	    .field("minutiaeDataRecordCount",
+	        &RecordSummary::minutiaeDataRecordCount)
+	    .field("unassociatedMinutiaeDataRecordCount",
+	        &RecordSummary::unassociatedMinutiaeDataRecordCount)
+	    ;
+
+	/*
+	 * Bindings for transaction bytes. The client fills the buffer through
+	 * a view of WebAssembly memory, so no filesystem is needed.
+	 */
+	emscripten::class_<BE::Memory::uint8Array>("TransactionBuffer")
+	    .smart_ptr_constructor("TransactionBuffer",
+	        emscripten::optional_override([](size_t size) {
+	        	return (std::make_shared<BE::Memory::uint8Array>(size));
+	        }))
+	    .function("size", emscripten::optional_override(
+	        [](const BE::Memory::uint8Array &b) { return (b.size()); }))
+	    /* Invalidated if memory grows, so obtain before each write */
+	    .function("getView", emscripten::optional_override(
+	        [](BE::Memory::uint8Array &b) {
+	        	return (emscripten::val(emscripten::typed_memory_view(
+	        	    b.size(), b.data())));
+	        }))
+	    ;
+
+	/*
+	 * Bindings for ContentHash, which hashes a TransactionBuffer as it is
+	 * filled, to key the client's cache of transactions.
+	 */
+	emscripten::class_<ContentHash>("ContentHash")
+	    .constructor<>()
+	    .function("update", emscripten::optional_override(
+	        [](ContentHash &h, const BE::Memory::uint8Array &b,
+	        const size_t offset, const size_t length) {
+	        	if ((offset > b.size()) || (length > (b.size() - offset)))
+	        		throw std::out_of_range{"Range to hash is "
+	        		    "outside of buffer"};
+	        	h.update(b.data() + offset, length);
+	        }))
+	    .function("getDigest", &ContentHash::getDigest)
+	    ;
+
+	/*
+	 * Bindings for DataInterchange::AN2KRecord.
+	 */
+	emscripten::class_<BE::DataInterchange::AN2KRecord>("AN2K")
+	    .constructor<BE::Memory::uint8Array&>()
+	    .class_function("isAN2K", emscripten::select_overload<
+	        bool(BE::Memory::uint8Array&)>(
+	        &BE::DataInterchange::AN2KRecord::isAN2KRecord));
+
+	/*
+	 * Bindings for ParseSession, which owns everything parsed from one
+	 * transaction. Delete it to release all of it.
+	 */
+	emscripten::class_<ParseSession>("ParseSession")
+	    .constructor<BE::Memory::uint8Array&>()
+	    .function("getRecordSummary", &ParseSession::getRecordSummary)
+	    .function("getFrictionRidgeImageIdentifiers",
+	        &ParseSession::getFrictionRidgeImageIdentifiers)
+	    .function("getRecordCount", &ParseSession::getRecordCount)
+	    /* Copies of the record's ImageShim share its decoded data */
+	    .function("getRecord", &ParseSession::getRecord)
+	    ;
+
+	/*
+	 * Bindings for RecordStream, which makes records available as the
+	 * TransactionBuffer it shares is filled. Delete it to release all of it.
+	 */
+	emscripten::class_<RecordStream>("RecordStream")
+	    .constructor(emscripten::optional_override(
+	        [](std::shared_ptr<BE::Memory::uint8Array> transaction) {
+	        	return (new RecordStream(transaction));
+	        }))
+	    .function("append", &RecordStream::append)
+	    .function("isComplete", &RecordStream::isComplete)
+	    .function("getExpectedRecordCount",
+	        &RecordStream::getExpectedRecordCount)
+	    .function("getRecordCount", &RecordStream::getRecordCount)
+	    .function("getRecord", &RecordStream::getRecord)
+	    .function("getRecordEntry", &RecordStream::getRecordEntry)
+	    .function("hasMinutiaeData", &RecordStream::hasMinutiaeData)
+	    .function("getRecordSummary", &RecordStream::getRecordSummary)
+	    .function("getFrictionRidgeImageIdentifiers",
+	        &RecordStream::getFrictionRidgeImageIdentifiers)
+	    ;
+
+	emscripten::value_object<HeapStatistics>("HeapStatistics")
+	    .field("available", &HeapStatistics::available)
+	    .field("heapSize", &HeapStatistics::heapSize)
+	    .field("footprint", &HeapStatistics::footprint)
+	    .field("peakFootprint", &HeapStatistics::peakFootprint)
+	    .field("allocatedBytes", &HeapStatistics::allocatedBytes)
+	    .field("freeBytes", &HeapStatistics::freeBytes)
+	    ;
+	emscripten::function("getHeapStatistics", &getHeapStatistics);
+
+	/*
+	 * Bindings for AN2KIndex, which locates records without decoding them.
+	 */
+	emscripten::enum_<BE::Image::CompressionAlgorithm>(
+	    "CompressionAlgorithm")
+	    .value("None", BE::Image::CompressionAlgorithm::None)
+	    .value("Facsimile", BE::Image::CompressionAlgorithm::Facsimile)
+	    .value("WSQ20", BE::Image::CompressionAlgorithm::WSQ20)
+	    .value("JPEGB", BE::Image::CompressionAlgorithm::JPEGB)
+	    .value("JPEGL", BE::Image::CompressionAlgorithm::JPEGL)
+	    .value("JP2", BE::Image::CompressionAlgorithm::JP2)
+	    .value("JP2L", BE::Image::CompressionAlgorithm::JP2L)
+	    .value("NetPBM", BE::Image::CompressionAlgorithm::NetPBM)
+	    .value("PNG", BE::Image::CompressionAlgorithm::PNG)
+	    .value("BMP", BE::Image::CompressionAlgorithm::BMP)
+	    .value("TIFF", BE::Image::CompressionAlgorithm::TIFF)
+	    ;
+
+	emscripten::value_object<AN2KIndexEntry>("AN2KIndexEntry")
+	    .field("recordType", &AN2KIndexEntry::recordType)
+	    .field("idc", &AN2KIndexEntry::idc)
+	    .field("offset", &AN2KIndexEntry::offset)
+	    .field("length", &AN2KIndexEntry::length)
+	    .field("hasImage", &AN2KIndexEntry::hasImage)
+	    .field("hasUnrecognizedImage",
+	        &AN2KIndexEntry::hasUnrecognizedImage)
+	    .field("compressionAlgorithm",
+	        &AN2KIndexEntry::compressionAlgorithm)
+	    .field("width", &AN2KIndexEntry::width)
+	    .field("height", &AN2KIndexEntry::height)
+	    .field("ppi", &AN2KIndexEntry::ppi)
+	    .field("bitsPerPixel", &AN2KIndexEntry::bitsPerPixel)
+	    .field("imageOffset", &AN2KIndexEntry::imageOffset)
+	    .field("imageLength", &AN2KIndexEntry::imageLength)
+	    ;
+
+	emscripten::class_<AN2KIndex>("AN2KIndex")
+	    /* Shares the TransactionBuffer rather than copying it */
+	    .constructor(emscripten::optional_override(
+	        [](std::shared_ptr<BE::Memory::uint8Array> transaction) {
+	        	return (new AN2KIndex(transaction));
+	        }))
+	    .function("getRecordCount", &AN2KIndex::getRecordCount)
+	    .function("getRecord", &AN2KIndex::getRecord)
+	    .function("getImage", &AN2KIndex::getImage)
+	    ;
+
+	/* Decodes image data copied out of a transaction (e.g., in a worker) */
+	emscripten::function("decodeImage", emscripten::optional_override(
+	    [](const BE::Memory::uint8Array &imageData,
+	    const AN2KIndexEntry &entry) {
+	    	return (ImageShim(decodeImage(imageData.data(),
+	    	    imageData.size(), entry)));
+	    }));
+	emscripten::function("getCodecModule", &getCodecModule);
+
+	/*
+	 * Bindings for AN2KMinutiaeDataRecord.
+	 */
+	emscripten::class_<BE::Finger::AN2KMinutiaeDataRecord>(
+	    "AN2KMinutiaeDataRecord");
+	emscripten::register_vector<BE::Finger::AN2KMinutiaeDataRecord>(
+	    "VectorAN2KMinutiaeDataRecord");
+
+
+	/*
+	 * Bindings for PointSystem.
+	 */
+	emscripten::value_object<std::pair<PointSystem,
+	        std::vector<PointShim>>>("PointSystemVectorPointShimPair")
+	    .field("system", &std::pair<PointSystem,
+	        std::vector<PointShim>>::first)
+	    .field("points", &std::pair<PointSystem,
+	        std::vector<PointShim>>::second);
+
+	/*
+	 * Combinations/Collections.
+	 */
+	emscripten::value_object<std::pair<ImageShim,
+	        std::vector<BE::Finger::AN2KMinutiaeDataRecord>>>(
+	        "ImageShimMinutiaeDataPair")
+	    .field("image", &std::pair<ImageShim,
+	        std::vector<BE::Finger::AN2KMinutiaeDataRecord>>::first)
+	    .field("minutiaeDataRecords", &std::pair<ImageShim,
+	        std::vector<BE::Finger::AN2KMinutiaeDataRecord>>::second);
+
+	emscripten::register_vector<std::pair<FrictionRidgeImage,
+	    std::vector<BE::Finger::AN2KMinutiaeDataRecord>>>(
+	    "VectorImageMinutiaeDataPair");
+	emscripten::register_vector<std::pair<ImageShim,
+	    std::vector<BE::Finger::AN2KMinutiaeDataRecord>>>(
+	    "VectorImageShimMinutiaeDataPair");
+
+	emscripten::register_vector<std::pair<PointSystem,
+	    std::vector<PointShim>>>("VectorPointSystemVectorPointShimPair");
+}
+
+/*
+ * Unused bindings.
+ */
+
+#if 0
+EMSCRIPTEN_BINDINGS(unused)
+{
+	/*
+	 * Bindings for uint8Array.
+	 */
+	emscripten::register_vector<uint8_t>("VectorUInt8T");
+	emscripten::class_<BE::Memory::uint8Array>("BE_uint8Array")
+	    .function("to_vector", &BE::Memory::uint8Array::to_vector);
+
+	/*
+	 * Bindings for Image::Image.
+	 */
+	emscripten::class_<BE::Image::Image>("BEImageImage")
+	    .smart_ptr<std::shared_ptr<BE::Image::Image>>("BEImageImage");
+
+	/*
+	 * Bindings for Finger::AN2KViewFixedResolution.
+	 */
+	emscripten::class_<BE::Finger::AN2KViewFixedResolution>(
+	    "Finger_AN2KViewFixedResolution");
+
+	/*
+	 * Bindings for FrictionRidgeImage (variant).
+	 */
+	emscripten::class_<FrictionRidgeImage>("FrictionRidgeImage");
+	emscripten::register_vector<FrictionRidgeImage>(
+	    "VectorFrictionRidgeImage");
+
+	/*
+	 * Combinations/Collections.
+	 */
+	emscripten::class_<std::pair<FrictionRidgeImage, std::vector<
+	    BE::Finger::AN2KMinutiaeDataRecord>>>("ImageMinutiaeDataPair");
+}
+#endif
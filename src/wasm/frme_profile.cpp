@@ -0,0 +1,103 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <cstdlib>
+#include <new>
+
+#include <emscripten.h>
+#include <emscripten/bind.h>
+
+#include "profile.h"
+
+/*
+ * Allocation accounting for profile spans. Counts everything that goes
+ * through the global operator new, which includes libbiomeval and the
+ * standard library. The module is single-threaded.
+ */
+
+static uint64_t allocationCount{0};
+
+static uint64_t
+getAllocationCount()
+{
+	return (allocationCount);
+}
+
+/* Registered before any span can be created */
+static const bool allocationCounterSet = (setAllocationCounter(
+    &getAllocationCount), true);
+
+void *
+operator new(
+    std::size_t size)
+{
+	++allocationCount;
+
+	if (void *p = std::malloc(size == 0 ? 1 : size))
+		return (p);
+	throw std::bad_alloc{};
+}
+
+void *
+operator new[](
+    std::size_t size)
+{
+	return (operator new(size));
+}
+
+void
+operator delete(
+    void *p)
+    noexcept
+{
+	std::free(p);
+}
+
+void
+operator delete[](
+    void *p)
+    noexcept
+{
+	std::free(p);
+}
+
+void
+operator delete(
+    void *p,
+    std::size_t)
+    noexcept
+{
+	std::free(p);
+}
+
+void
+operator delete[](
+    void *p,
+    std::size_t)
+    noexcept
+{
+	std::free(p);
+}
+
+EMSCRIPTEN_BINDINGS(profile)
+{
+	emscripten::value_object<ProfileSpan>("ProfileSpan")
+	    .field("name", &ProfileSpan::name)
+	    .field("depth", &ProfileSpan::depth)
+	    .field("start", &ProfileSpan::start)
+	    .field("duration", &ProfileSpan::duration)
+	    .field("bytes", &ProfileSpan::bytes)
+	    .field("allocations", &ProfileSpan::allocations)
+	    ;
+	emscripten::register_vector<ProfileSpan>("VectorProfileSpan");
+
+	emscripten::function("getProfile", &getProfile);
+	emscripten::function("clearProfile", &clearProfile);
+}
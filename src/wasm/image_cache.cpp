@@ -0,0 +1,119 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include "image_cache.h"
+
+#include <algorithm>
+
+ImageCache&
+ImageCache::getInstance()
+{
+	static ImageCache instance{};
+	return (instance);
+}
+
+void
+ImageCache::touch(
+    Evictable *entry)
+{
+	if (entry == nullptr)
+		return;
+
+	const size_t bytes = entry->getEvictableSize();
+
+	const auto it = this->positions_.find(entry);
+	if (it != this->positions_.end()) {
+		this->statistics_.bytes -= it->second->bytes;
+		this->lru_.erase(it->second);
+		this->positions_.erase(it);
+	}
+
+	/* Nothing held, so nothing to evict later */
+	if (bytes > 0) {
+		this->lru_.push_front({entry, bytes});
+		this->positions_[entry] = this->lru_.begin();
+		this->statistics_.bytes += bytes;
+		this->statistics_.peakBytes = std::max(
+		    this->statistics_.peakBytes, this->statistics_.bytes);
+	}
+
+	this->enforceBudget(entry);
+	this->statistics_.entries = this->lru_.size();
+}
+
+void
+ImageCache::remove(
+    Evictable *entry)
+{
+	const auto it = this->positions_.find(entry);
+	if (it == this->positions_.end())
+		return;
+
+	this->statistics_.bytes -= it->second->bytes;
+	this->lru_.erase(it->second);
+	this->positions_.erase(it);
+	this->statistics_.entries = this->lru_.size();
+}
+
+void
+ImageCache::recordHit()
+{
+	++this->statistics_.hits;
+}
+
+void
+ImageCache::recordMiss()
+{
+	++this->statistics_.misses;
+}
+
+void
+ImageCache::setBudget(
+    const size_t budget)
+{
+	this->statistics_.budget = budget;
+	this->enforceBudget(nullptr);
+	this->statistics_.entries = this->lru_.size();
+}
+
+ImageCacheStatistics
+ImageCache::getStatistics()
+    const
+{
+	return (this->statistics_);
+}
+
+void
+ImageCache::resetStatistics()
+{
+	this->statistics_.hits = 0;
+	this->statistics_.misses = 0;
+	this->statistics_.evictions = 0;
+	this->statistics_.peakBytes = this->statistics_.bytes;
+}
+
+void
+ImageCache::enforceBudget(
+    const Evictable *keep)
+{
+	while ((this->statistics_.bytes > this->statistics_.budget) &&
+	    !this->lru_.empty()) {
+		const Entry victim = this->lru_.back();
+		if (victim.entry == keep)
+			break;
+
+		this->lru_.pop_back();
+		this->positions_.erase(victim.entry);
+		this->statistics_.bytes -= victim.bytes;
+		++this->statistics_.evictions;
+
+		victim.entry->evict();
+	}
+}
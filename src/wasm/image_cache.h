@@ -0,0 +1,150 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef IMAGE_CACHE_H_
+#define IMAGE_CACHE_H_
+
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+
+/** Data that can be released and recreated later on demand. */
+class Evictable
+{
+public:
+	virtual ~Evictable() = default;
+
+	/** @return Bytes currently held that evict() would release */
+	virtual size_t
+	getEvictableSize()
+	    const = 0;
+
+	/** Release everything that can be recreated */
+	virtual void
+	evict() = 0;
+};
+
+/** Counters describing ImageCache's behavior. */
+struct ImageCacheStatistics
+{
+	/** Requests served from data already held */
+	size_t hits{};
+	/** Requests that had to decode or encode */
+	size_t misses{};
+	/** Times an entry's data was released to stay within budget */
+	size_t evictions{};
+
+	/** Bytes currently held by all entries */
+	size_t bytes{};
+	/** Most bytes held at once */
+	size_t peakBytes{};
+	/** Bytes allowed to be held */
+	size_t budget{};
+	/** Number of entries currently holding data */
+	size_t entries{};
+};
+
+/**
+ * @brief
+ * Least-recently-used accounting of decoded and encoded image data.
+ *
+ * @details
+ * Each ImageShim's derived data (decoded pixels, PNG/Base64 encodings,
+ * pyramid levels) is an entry. When the total exceeds the budget, data of the
+ * least-recently-used entries is released, to be decoded again if needed.
+ * The entry being used is never evicted, even if it alone exceeds the budget.
+ *
+ * @note
+ * Not thread-safe. ImageShims sharing a cache must be used from one thread.
+ */
+class ImageCache
+{
+public:
+	/** Default byte budget */
+	static constexpr size_t DefaultBudget{128 * 1024 * 1024};
+
+	/** @return The cache shared by all ImageShims */
+	static ImageCache&
+	getInstance();
+
+	/**
+	 * @brief
+	 * Record that `entry` was just used.
+	 *
+	 * @param entry
+	 * Entry that was used. Its size is read again, since it may have
+	 * grown.
+	 *
+	 * @note
+	 * May evict other entries.
+	 */
+	void
+	touch(
+	    Evictable *entry);
+
+	/** Stop tracking `entry`, e.g., when it is destroyed */
+	void
+	remove(
+	    Evictable *entry);
+
+	/** Count a request served from data already held */
+	void
+	recordHit();
+
+	/** Count a request that had to decode or encode */
+	void
+	recordMiss();
+
+	/**
+	 * @brief
+	 * Change the byte budget.
+	 *
+	 * @param budget
+	 * Bytes allowed to be held. Entries are evicted immediately to meet
+	 * it.
+	 */
+	void
+	setBudget(
+	    const size_t budget);
+
+	/** @return Current counters */
+	ImageCacheStatistics
+	getStatistics()
+	    const;
+
+	/** Zero hit, miss, and eviction counters */
+	void
+	resetStatistics();
+
+private:
+	ImageCache() = default;
+
+	/** Evict least-recently-used entries other than `keep` */
+	void
+	enforceBudget(
+	    const Evictable *keep);
+
+	struct Entry
+	{
+		Evictable *entry{};
+		/** Size when last touched */
+		size_t bytes{};
+	};
+
+	/** Entries, most-recently-used first */
+	std::list<Entry> lru_{};
+	/** Position of each entry in `lru_` */
+	std::unordered_map<const Evictable*, std::list<Entry>::iterator>
+	    positions_{};
+
+	ImageCacheStatistics statistics_{0, 0, 0, 0, 0, DefaultBudget, 0};
+};
+
+#endif /* IMAGE_CACHE_H_ */
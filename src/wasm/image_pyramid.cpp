@@ -0,0 +1,273 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+/*
+ * Vector implementations read 32 pixels from each of two rows, sum adjacent
+ * pairs into 16-bit lanes, add the two rows, and round and narrow back to 16
+ * output pixels. Results are identical to the scalar implementation.
+ */
+
+#include "image_pyramid.h"
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define FRME_PYRAMID_WASM_SIMD128
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FRME_PYRAMID_NEON
+#elif (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#include <emmintrin.h>
+#define FRME_PYRAMID_SSE2
+#endif
+
+/**
+ * @brief
+ * Average 2x2 blocks of two rows, one output pixel at a time.
+ *
+ * @param row0
+ * First of the two input rows.
+ * @param row1
+ * Second of the two input rows.
+ * @param outWidth
+ * Number of pixels to write to `out`.
+ * @param out
+ * Output row.
+ */
+static void
+downsampleRowScalar(
+    const uint8_t *row0,
+    const uint8_t *row1,
+    const uint32_t outWidth,
+    uint8_t *out)
+{
+	for (uint32_t x{}; x < outWidth; ++x) {
+		const uint32_t sum = row0[2 * x] + row0[(2 * x) + 1] +
+		    row1[2 * x] + row1[(2 * x) + 1];
+		out[x] = static_cast<uint8_t>((sum + 2) >> 2);
+	}
+}
+
+#if defined(FRME_PYRAMID_WASM_SIMD128)
+
+/**
+ * @brief
+ * Average 2x2 blocks of two rows with WebAssembly SIMD.
+ *
+ * @return
+ * Number of output pixels written (a multiple of 16).
+ */
+static uint32_t
+downsampleRowVector(
+    const uint8_t *row0,
+    const uint8_t *row1,
+    const uint32_t outWidth,
+    uint8_t *out)
+{
+	const v128_t two = wasm_i16x8_splat(2);
+
+	uint32_t x{};
+	for (; (x + 16) <= outWidth; x += 16) {
+		const uint8_t *a = row0 + (2 * x);
+		const uint8_t *b = row1 + (2 * x);
+
+		const v128_t lo = wasm_u16x8_shr(wasm_i16x8_add(wasm_i16x8_add(
+		    wasm_u16x8_extadd_pairwise_u8x16(wasm_v128_load(a)),
+		    wasm_u16x8_extadd_pairwise_u8x16(wasm_v128_load(b))),
+		    two), 2);
+		const v128_t hi = wasm_u16x8_shr(wasm_i16x8_add(wasm_i16x8_add(
+		    wasm_u16x8_extadd_pairwise_u8x16(wasm_v128_load(a + 16)),
+		    wasm_u16x8_extadd_pairwise_u8x16(wasm_v128_load(b + 16))),
+		    two), 2);
+		wasm_v128_store(out + x, wasm_u8x16_narrow_i16x8(lo, hi));
+	}
+
+	return (x);
+}
+
+static const char VectorImplementation[] = "WebAssembly SIMD";
+
+#elif defined(FRME_PYRAMID_NEON)
+
+/**
+ * @brief
+ * Average 2x2 blocks of two rows with NEON.
+ *
+ * @return
+ * Number of output pixels written (a multiple of 16).
+ */
+static uint32_t
+downsampleRowVector(
+    const uint8_t *row0,
+    const uint8_t *row1,
+    const uint32_t outWidth,
+    uint8_t *out)
+{
+	uint32_t x{};
+	for (; (x + 16) <= outWidth; x += 16) {
+		const uint8_t *a = row0 + (2 * x);
+		const uint8_t *b = row1 + (2 * x);
+
+		/* vrshrn_n_u16() rounds, i.e., (sum + 2) >> 2 */
+		const uint8x8_t lo = vrshrn_n_u16(vaddq_u16(
+		    vpaddlq_u8(vld1q_u8(a)), vpaddlq_u8(vld1q_u8(b))), 2);
+		const uint8x8_t hi = vrshrn_n_u16(vaddq_u16(
+		    vpaddlq_u8(vld1q_u8(a + 16)),
+		    vpaddlq_u8(vld1q_u8(b + 16))), 2);
+		vst1q_u8(out + x, vcombine_u8(lo, hi));
+	}
+
+	return (x);
+}
+
+static const char VectorImplementation[] = "NEON";
+
+#elif defined(FRME_PYRAMID_SSE2)
+
+/** @return Sums of adjacent pairs of bytes in `v`, as 16-bit lanes */
+static __m128i
+addPairs(
+    const __m128i v)
+{
+	return (_mm_add_epi16(_mm_and_si128(v, _mm_set1_epi16(0x00FF)),
+	    _mm_srli_epi16(v, 8)));
+}
+
+/**
+ * @brief
+ * Average 2x2 blocks of two rows with SSE2.
+ *
+ * @return
+ * Number of output pixels written (a multiple of 16).
+ */
+static uint32_t
+downsampleRowVector(
+    const uint8_t *row0,
+    const uint8_t *row1,
+    const uint32_t outWidth,
+    uint8_t *out)
+{
+	const __m128i two = _mm_set1_epi16(2);
+
+	uint32_t x{};
+	for (; (x + 16) <= outWidth; x += 16) {
+		const __m128i *a = reinterpret_cast<const __m128i *>(
+		    row0 + (2 * x));
+		const __m128i *b = reinterpret_cast<const __m128i *>(
+		    row1 + (2 * x));
+
+		const __m128i lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(
+		    addPairs(_mm_loadu_si128(a)), addPairs(_mm_loadu_si128(b))),
+		    two), 2);
+		const __m128i hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(
+		    addPairs(_mm_loadu_si128(a + 1)),
+		    addPairs(_mm_loadu_si128(b + 1))), two), 2);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + x),
+		    _mm_packus_epi16(lo, hi));
+	}
+
+	return (x);
+}
+
+static const char VectorImplementation[] = "SSE2";
+
+#endif
+
+void
+downsample2x2(
+    const uint8_t *in,
+    const uint32_t width,
+    const uint32_t height,
+    uint8_t *out)
+{
+	const uint32_t outWidth = width / 2;
+	const uint32_t outHeight = height / 2;
+
+	for (uint32_t y{}; y < outHeight; ++y) {
+		const uint8_t *row0 = in + (static_cast<size_t>(2 * y) * width);
+		const uint8_t *row1 = row0 + width;
+		uint8_t *outRow = out + (static_cast<size_t>(y) * outWidth);
+
+		uint32_t x{};
+#if defined(FRME_PYRAMID_WASM_SIMD128) || defined(FRME_PYRAMID_NEON) || \
+    defined(FRME_PYRAMID_SSE2)
+		x = downsampleRowVector(row0, row1, outWidth, outRow);
+#endif
+		downsampleRowScalar(row0 + (2 * x), row1 + (2 * x),
+		    outWidth - x, outRow + x);
+	}
+}
+
+void
+downsampleRGBA2x2(
+    const uint8_t *in,
+    const uint32_t width,
+    const uint32_t height,
+    uint8_t *out)
+{
+	const uint32_t outWidth = width / 2;
+	const uint32_t outHeight = height / 2;
+	const size_t inStride = static_cast<size_t>(width) * 4;
+
+	for (uint32_t y{}; y < outHeight; ++y) {
+		const uint8_t *row0 = in + (static_cast<size_t>(2 * y) *
+		    inStride);
+		const uint8_t *row1 = row0 + inStride;
+		uint8_t *outRow = out + (static_cast<size_t>(y) * outWidth * 4);
+
+		for (uint32_t x{}; x < outWidth; ++x) {
+			for (uint32_t c{}; c < 4; ++c) {
+				const size_t i = (static_cast<size_t>(x) * 8) +
+				    c;
+				const uint32_t sum = row0[i] + row0[i + 4] +
+				    row1[i] + row1[i + 4];
+				outRow[(x * 4) + c] = static_cast<uint8_t>(
+				    (sum + 2) >> 2);
+			}
+		}
+	}
+}
+
+uint32_t
+getPyramidDimension(
+    const uint32_t size,
+    const uint32_t level)
+{
+	if (level >= 32)
+		return (0);
+	return (size >> level);
+}
+
+uint32_t
+getPyramidLevelCount(
+    const uint32_t width,
+    const uint32_t height)
+{
+	if ((width == 0) || (height == 0))
+		return (0);
+
+	uint32_t levels{1};
+	while ((levels < MaxPyramidLevels) &&
+	    (getPyramidDimension(width, levels) > 0) &&
+	    (getPyramidDimension(height, levels) > 0))
+		++levels;
+
+	return (levels);
+}
+
+std::string
+getDownsampleImplementation()
+{
+#if defined(FRME_PYRAMID_WASM_SIMD128) || defined(FRME_PYRAMID_NEON) || \
+    defined(FRME_PYRAMID_SSE2)
+	return (VectorImplementation);
+#else
+	return ("scalar");
+#endif
+}
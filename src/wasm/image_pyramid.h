@@ -0,0 +1,113 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef IMAGE_PYRAMID_H_
+#define IMAGE_PYRAMID_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/** Most levels an image pyramid will have, including full resolution */
+static constexpr uint32_t MaxPyramidLevels{8};
+
+/**
+ * @brief
+ * Halve an 8-bit grayscale image in each dimension.
+ *
+ * @param in
+ * width * height bytes, row-major.
+ * @param width
+ * Width of `in` in pixels, at least 2.
+ * @param height
+ * Height of `in` in pixels, at least 2.
+ * @param out
+ * Where to write (width / 2) * (height / 2) bytes, row-major.
+ *
+ * @note
+ * Each output pixel is the rounded mean of a 2x2 block of input pixels. The
+ * last column and row of odd-sized images are dropped.
+ *
+ * @note
+ * Vectorized with WebAssembly SIMD (when built with -msimd128), NEON
+ * (AArch64), or SSE2 (x86), with a scalar fallback.
+ */
+void
+downsample2x2(
+    const uint8_t *in,
+    const uint32_t width,
+    const uint32_t height,
+    uint8_t *out);
+
+/**
+ * @brief
+ * Halve an 8-bit RGBA image in each dimension.
+ *
+ * @param in
+ * width * height * 4 bytes, row-major.
+ * @param width
+ * Width of `in` in pixels, at least 2.
+ * @param height
+ * Height of `in` in pixels, at least 2.
+ * @param out
+ * Where to write (width / 2) * (height / 2) * 4 bytes, row-major.
+ *
+ * @note
+ * Each channel is averaged as by downsample2x2(), without vectorization,
+ * since color friction ridge images are rare.
+ */
+void
+downsampleRGBA2x2(
+    const uint8_t *in,
+    const uint32_t width,
+    const uint32_t height,
+    uint8_t *out);
+
+/**
+ * @brief
+ * Obtain a dimension of an image pyramid level.
+ *
+ * @param size
+ * Width or height of full resolution image, in pixels.
+ * @param level
+ * Pyramid level, where 0 is full resolution.
+ *
+ * @return
+ * `size` after being halved `level` times.
+ */
+uint32_t
+getPyramidDimension(
+    const uint32_t size,
+    const uint32_t level);
+
+/**
+ * @brief
+ * Obtain the number of levels in an image's pyramid.
+ *
+ * @param width
+ * Width of full resolution image, in pixels.
+ * @param height
+ * Height of full resolution image, in pixels.
+ *
+ * @return
+ * Number of levels, including full resolution, such that every level is at
+ * least 1x1 and there are no more than MaxPyramidLevels. 0 if the image is
+ * empty.
+ */
+uint32_t
+getPyramidLevelCount(
+    const uint32_t width,
+    const uint32_t height);
+
+/** @return Name of the implementation downsample2x2() will use. */
+std::string
+getDownsampleImplementation();
+
+#endif /* IMAGE_PYRAMID_H_ */
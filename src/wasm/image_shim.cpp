@@ -10,16 +10,55 @@
 
 #include "image_shim.h"
 
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
 #include <string>
 
-#include <emscripten.h>
-#include <emscripten/bind.h>
 #include <png.h>
 
-#include <be_text.h>
+#include "base64.h"
+#include "image_pyramid.h"
+#include "png_gray.h"
+#include "profile.h"
 
 namespace BE = BiometricEvaluation;
 
+PNGEncoding
+PNGEncoding::forDisplay()
+{
+	return {1, PNGFilter::Sub, DeflateStrategy::Default};
+}
+
+PNGEncoding
+PNGEncoding::forArchival()
+{
+	return {9, PNGFilter::Adaptive, DeflateStrategy::Default};
+}
+
+/** @return libpng filter mask for `filter` */
+static int
+toLibPNGFilters(
+    const PNGFilter filter)
+{
+	switch (filter) {
+	case PNGFilter::None:
+		return (PNG_FILTER_NONE);
+	case PNGFilter::Sub:
+		return (PNG_FILTER_SUB);
+	case PNGFilter::Up:
+		return (PNG_FILTER_UP);
+	case PNGFilter::Average:
+		return (PNG_FILTER_AVG);
+	case PNGFilter::Paeth:
+		return (PNG_FILTER_PAETH);
+	case PNGFilter::Adaptive:
+		return (PNG_ALL_FILTERS);
+	}
+
+	return (PNG_ALL_FILTERS);
+}
+
 static void
 writeCallback(
     png_structp png_ptr, png_bytep data, png_size_t length)
@@ -29,18 +68,86 @@ writeCallback(
 	encodedPNG->insert(encodedPNG->end(), data, data + length);
 }
 
-static std::vector<uint8_t>
+static void
+flushCallback(
+    png_structp)
+{
+	/* Nothing buffered outside of libpng */
+}
+
+std::vector<uint8_t>
 rawToPNG(
-    const std::vector<uint8_t> &rawData,
+    const uint8_t *rawData,
+    const size_t rawDataSize,
     const bool hasAlphaChannel,
     const uint16_t colorDepth,
     const uint16_t bitDepth,
     const uint32_t width,
-    const uint32_t height)
+    const uint32_t height,
+    const PNGEncoding &encoding)
 {
-	if (rawData.size() == 0)
+	if ((rawData == nullptr) || (rawDataSize == 0) || (bitDepth == 0) ||
+	    (colorDepth % bitDepth != 0))
+		return {};
+
+	ScopedSpan span("rawToPNG");
+
+	/* Bits per pixel over bits per component */
+	const auto channels = colorDepth / bitDepth;
+	int colorType{};
+	switch (channels) {
+	case 1:
+		colorType = PNG_COLOR_TYPE_GRAY;
+		break;
+	case 2:
+		colorType = PNG_COLOR_TYPE_GRAY_ALPHA;
+		break;
+	case 3:
+		colorType = PNG_COLOR_TYPE_RGB;
+		break;
+	case 4:
+		colorType = PNG_COLOR_TYPE_RGBA;
+		break;
+	default:
+		return {};
+	}
+	if (hasAlphaChannel != ((channels == 2) || (channels == 4)))
+		return {};
+
+	/* Sub-byte depths (e.g., bitonal) pack pixels into bytes */
+	const size_t rowBytes = ((static_cast<size_t>(width) * colorDepth) +
+	    7) / 8;
+	if (rawDataSize < (rowBytes * height))
 		return {};
 
+	/* Nearly every friction ridge image */
+	if ((channels == 1) && canEncodeGrayPNG(encoding)) {
+		std::vector<uint8_t> encodedPNG{};
+		if (bitDepth == 8)
+			encodedPNG = encodeGrayPNG<8>(rawData, width, height,
+			    encoding);
+		else if (bitDepth == 16)
+			encodedPNG = encodeGrayPNG<16>(rawData, width, height,
+			    encoding);
+
+		if (!encodedPNG.empty()) {
+			span.setBytes(encodedPNG.size());
+			return (encodedPNG);
+		}
+	}
+
+	/*
+	 * Output arena. Reserve enough for typical friction ridge images so
+	 * that libpng's chunks are appended without reallocating. Created
+	 * before setjmp() and only modified through the pointer.
+	 */
+	const auto encodedPNG = std::make_unique<std::vector<uint8_t>>();
+	if (encoding.compressionLevel == 0)
+		encodedPNG->reserve(rawDataSize + height + (rawDataSize / 8) +
+		    1024);
+	else
+		encodedPNG->reserve((rawDataSize / 2) + 1024);
+
 	png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING,
 	    nullptr, nullptr, nullptr);
 	if (png_ptr == nullptr)
@@ -57,55 +164,139 @@ rawToPNG(
 		return {};
 	}
 
-	/* Not 100%, but close enough for now */
-	const auto bytesPerPixel = colorDepth / bitDepth;
-	auto colorType = PNG_COLOR_TYPE_RGB;
-	if (hasAlphaChannel)
-		colorType = PNG_COLOR_TYPE_RGBA;
-	if (colorDepth == bitDepth)
-		colorType = PNG_COLOR_TYPE_GRAY;
+	png_set_write_fn(png_ptr, encodedPNG.get(), writeCallback,
+	    flushCallback);
+	png_set_compression_level(png_ptr, std::clamp(
+	    encoding.compressionLevel, 0, 9));
+	png_set_compression_strategy(png_ptr,
+	    toZlibStrategy(encoding.strategy));
+	png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE,
+	    toLibPNGFilters(encoding.filter));
 
 	png_set_IHDR(png_ptr, info_ptr, width, height, bitDepth,
 	    colorType, PNG_INTERLACE_NONE,
             PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(png_ptr, info_ptr);
+
+	/* Rows are read directly from the decoded image */
+	for (size_t y{}; y < height; ++y)
+		png_write_row(png_ptr, rawData + (y * rowBytes));
 
-	std::vector<uint8_t> rawDataCopy{rawData};
-        std::vector<uint8_t*> rowPointers(height);
-        for (size_t y{}; y < height; ++y) {
-        	rowPointers[y] = &rawDataCopy.at(y * width * bytesPerPixel);
-        }
-        png_set_rows(png_ptr, info_ptr, &rowPointers[0]);
+	png_write_end(png_ptr, info_ptr);
+	png_destroy_write_struct(&png_ptr, &info_ptr);
 
-	std::vector<uint8_t> encodedPNG{};
-        png_set_write_fn(png_ptr, &encodedPNG, writeCallback, nullptr);
-	png_write_png(png_ptr, info_ptr, PNG_TRANSFORM_IDENTITY, nullptr);
-	png_destroy_write_struct(&png_ptr, nullptr);
+	span.setBytes(encodedPNG->size());
 
-	return (encodedPNG);
+	return (std::move(*encodedPNG));
 }
 
-static std::vector<uint8_t>
+std::vector<uint8_t>
 rawToPNG(
-    std::shared_ptr<BiometricEvaluation::Image::Image> image)
+    std::shared_ptr<BiometricEvaluation::Image::Image> image,
+    const PNGEncoding &encoding)
 {
 	if (!image)
 		return {};
 
-	const std::vector<uint8_t> v = image->getRawData().to_vector();
-	return (rawToPNG(v,
+	const auto raw = image->getRawData();
+	return (rawToPNG(raw.data(), raw.size(),
 	    image->hasAlphaChannel(),
 	    image->getColorDepth(),
 	    image->getBitDepth(),
 	    image->getDimensions().xSize,
-	    image->getDimensions().ySize));
+	    image->getDimensions().ySize,
+	    encoding));
 }
 
 ImageShim::ImageShim(
-    std::shared_ptr<BE::Image::Image> image) :
-    image_{image}
+    std::shared_ptr<BE::Image::Image> image)
 {
-	if (!this->image_)
+	if (!image)
 		throw std::runtime_error{"Image is null"};
+	this->cache_->image = image;
+}
+
+ImageShim::ImageShim(
+    ImageLoader loader,
+    const uint32_t width,
+    const uint32_t height,
+    const uint16_t ppi)
+{
+	if (!loader)
+		throw std::runtime_error{"Image loader is empty"};
+
+	this->cache_->loader = std::move(loader);
+	this->cache_->width = width;
+	this->cache_->height = height;
+	this->cache_->ppi = ppi;
+}
+
+ImageShim::Cache::~Cache()
+{
+	ImageCache::getInstance().remove(this);
+}
+
+size_t
+ImageShim::Cache::getEvictableSize()
+    const
+{
+	size_t size = this->raw.size() + this->gray.size() +
+	    this->rgba.size() + this->base64PNG.size();
+	for (const auto &level : this->pyramid)
+		size += level.size();
+
+	return (size);
+}
+
+void
+ImageShim::Cache::evict()
+{
+	this->raw = BE::Memory::uint8Array{};
+	this->hasRaw = false;
+	this->gray = BE::Memory::uint8Array{};
+	this->hasGray = false;
+	std::vector<uint8_t>{}.swap(this->rgba);
+	this->hasRGBA = false;
+	std::string{}.swap(this->base64PNG);
+	std::vector<std::vector<uint8_t>>{}.swap(this->pyramid);
+
+	/* Only images that can be decoded again */
+	if (this->loader)
+		this->image.reset();
+}
+
+void
+ImageShim::touch(
+    const bool hit)
+    const
+{
+	auto &cache = ImageCache::getInstance();
+	if (hit)
+		cache.recordHit();
+	else
+		cache.recordMiss();
+	cache.touch(this->cache_.get());
+}
+
+const std::shared_ptr<BE::Image::Image>&
+ImageShim::getImage()
+    const
+{
+	if (!this->cache_->image && this->cache_->loader) {
+		this->cache_->image = this->cache_->loader();
+
+		/*
+		 * Keep reporting decoded dimensions if evicted. Resolution
+		 * stays as recorded, so points converted with it don't depend
+		 * on whether the image was decoded first.
+		 */
+		if (this->cache_->image) {
+			this->cache_->width = this->getWidth();
+			this->cache_->height = this->getHeight();
+		}
+	}
+
+	return (this->cache_->image);
 }
 
 std::string
@@ -113,63 +304,363 @@ ImageShim::getBase64PNG(
     bool inlineImagePrefix)
     const
 {
-	if (this->base64PNG_.empty()) {
-		const auto pngBytes = rawToPNG(this->image_);
+	const bool hit = !this->cache_->base64PNG.empty();
+	if (!hit) {
+		const auto pngBytes = this->getPNG();
 
-		BE::Memory::uint8Array aa(pngBytes.size());
-		aa.copy(pngBytes.data(), pngBytes.size());
-		this->base64PNG_ = BiometricEvaluation::Text::encodeBase64(aa);
+		ScopedSpan span("encodeBase64");
+		this->cache_->base64PNG = encodeBase64(pngBytes.data(),
+		    pngBytes.size());
+		span.setBytes(this->cache_->base64PNG.size());
 	}
+	this->touch(hit);
 
 	if (inlineImagePrefix)
-		return ("data:image/png;base64," + this->base64PNG_);
+		return ("data:image/png;base64," + this->cache_->base64PNG);
 	else
-		return (this->base64PNG_);
+		return (this->cache_->base64PNG);
 
 }
 
+std::vector<uint8_t>
+ImageShim::getPNG(
+    const PNGEncoding &encoding)
+    const
+{
+	const auto &image = this->getImage();
+	if (!image)
+		return {};
+
+	const auto &raw = this->getRawPixels();
+	return (rawToPNG(raw.data(), raw.size(),
+	    image->hasAlphaChannel(),
+	    image->getColorDepth(),
+	    image->getBitDepth(),
+	    this->getWidth(),
+	    this->getHeight(),
+	    encoding));
+}
+
+const BE::Memory::uint8Array&
+ImageShim::getRawPixels()
+    const
+{
+	const bool hit = this->cache_->hasRaw;
+	if (!hit) {
+		ScopedSpan span("decode");
+		if (this->getImage()) {
+			this->cache_->raw = this->getImage()->getRawData();
+			this->cache_->hasRaw = true;
+		}
+		span.setBytes(this->cache_->raw.size());
+	}
+	this->touch(hit);
+
+	return (this->cache_->raw);
+}
+
+bool
+ImageShim::isGray8()
+    const
+{
+	const auto &image = this->getImage();
+	if (!image)
+		return (false);
+
+	return ((image->getColorDepth() == 8) &&
+	    (image->getBitDepth() == 8));
+}
+
+const BE::Memory::uint8Array&
+ImageShim::getGrayscalePixels()
+    const
+{
+	if (this->isGray8())
+		return (this->getRawPixels());
+
+	const bool hit = this->cache_->hasGray;
+	if (!hit) {
+		ScopedSpan span("grayscale");
+		if (this->getImage()) {
+			this->cache_->gray =
+			    this->getImage()->getRawGrayscaleData(8);
+			this->cache_->hasGray = true;
+		}
+		span.setBytes(this->cache_->gray.size());
+	}
+	this->touch(hit);
+
+	return (this->cache_->gray);
+}
+
+/** Expand `count` 8-bit grayscale pixels to opaque 8-bit RGBA */
+static void
+grayToRGBA(
+    const uint8_t *gray,
+    const size_t count,
+    uint8_t *rgba)
+{
+	for (size_t i{}; i < count; ++i) {
+		rgba[(i * 4) + 0] = gray[i];
+		rgba[(i * 4) + 1] = gray[i];
+		rgba[(i * 4) + 2] = gray[i];
+		rgba[(i * 4) + 3] = 0xFF;
+	}
+}
+
+/**
+ * @return
+ * Number of 8- or 16-bit channels of `image` that can be expanded to RGBA
+ * directly, or 0 if it must be converted to grayscale first.
+ */
+static uint32_t
+getRGBAChannels(
+    const BE::Image::Image &image)
+{
+	const uint16_t bitDepth = image.getBitDepth();
+	if (((bitDepth != 8) && (bitDepth != 16)) ||
+	    ((image.getColorDepth() % bitDepth) != 0))
+		return (0);
+
+	/* Gray, gray+alpha, RGB, or RGBA */
+	const uint32_t channels = image.getColorDepth() / bitDepth;
+	if ((channels < 1) || (channels > 4))
+		return (0);
+	return (channels);
+}
+
+bool
+ImageShim::isGrayscale()
+    const
+{
+	const auto &image = this->getImage();
+	if (!image)
+		return (true);
+
+	return (getRGBAChannels(*image) <= 1);
+}
+
+const std::vector<uint8_t>&
+ImageShim::getRGBAPixels(
+    const uint32_t level)
+    const
+{
+	auto &rgba = this->cache_->rgba;
+	if (!this->getImage()) {
+		rgba.clear();
+		this->cache_->hasRGBA = false;
+		return (rgba);
+	}
+
+	/* Color levels are kept as RGBA already */
+	if ((level > 0) && !this->isGrayscale())
+		return (this->getPyramidLevel(level));
+
+	const bool hit = this->cache_->hasRGBA &&
+	    (this->cache_->rgbaLevel == level);
+	if (!hit) {
+		ScopedSpan span("RGBA");
+		if (level > 0) {
+			const auto &gray = this->getPyramidLevel(level);
+			rgba.resize(gray.size() * 4);
+			grayToRGBA(gray.data(), gray.size(), rgba.data());
+		} else {
+			this->expandToRGBA(rgba);
+		}
+		this->cache_->hasRGBA = true;
+		this->cache_->rgbaLevel = level;
+		span.setBytes(rgba.size());
+	}
+	this->touch(hit);
+
+	return (rgba);
+}
+
+void
+ImageShim::expandToRGBA(
+    std::vector<uint8_t> &rgba)
+    const
+{
+	const auto &image = this->getImage();
+	const size_t pixelCount = static_cast<size_t>(this->getWidth()) *
+	    this->getHeight();
+	rgba.resize(pixelCount * 4);
+	if (pixelCount == 0)
+		return;
+
+	const uint32_t channels = getRGBAChannels(*image);
+	if (channels == 0) {
+		const auto &gray = this->getGrayscalePixels();
+		if (gray.size() < pixelCount)
+			throw std::runtime_error{"Decoded image is smaller "
+			    "than its dimensions"};
+		grayToRGBA(gray.data(), pixelCount, rgba.data());
+		return;
+	}
+
+	/* 16-bit samples are big-endian, so keep the first byte of each */
+	const auto &raw = this->getRawPixels();
+	const size_t stride = (image->getBitDepth() / 8);
+	const size_t pixelStride = stride * channels;
+	if (raw.size() < (pixelCount * pixelStride))
+		throw std::runtime_error{"Decoded image is smaller than its "
+		    "dimensions"};
+	for (size_t i{}; i < pixelCount; ++i) {
+		const uint8_t *p = raw.data() + (i * pixelStride);
+		uint8_t *out = rgba.data() + (i * 4);
+		switch (channels) {
+		case 1:
+			out[0] = out[1] = out[2] = p[0];
+			out[3] = 0xFF;
+			break;
+		case 2:
+			out[0] = out[1] = out[2] = p[0];
+			out[3] = p[stride];
+			break;
+		case 3:
+			out[0] = p[0];
+			out[1] = p[stride];
+			out[2] = p[2 * stride];
+			out[3] = 0xFF;
+			break;
+		case 4:
+			out[0] = p[0];
+			out[1] = p[stride];
+			out[2] = p[2 * stride];
+			out[3] = p[3 * stride];
+			break;
+		}
+	}
+}
+
+const std::vector<uint8_t>&
+ImageShim::getPyramidLevel(
+    const uint32_t level)
+    const
+{
+	if ((level == 0) || (level >= this->getPyramidLevelCount()))
+		throw std::runtime_error{"Invalid pyramid level"};
+
+	auto &pyramid = this->cache_->pyramid;
+	const bool hit = (pyramid.size() >= level);
+	const bool gray = this->isGrayscale();
+	std::vector<uint8_t> fullRGBA{};
+	while (pyramid.size() < level) {
+		/* Each level is built from the one before it */
+		const uint32_t previous = static_cast<uint32_t>(pyramid.size());
+		const uint32_t width = this->getPyramidLevelWidth(previous);
+		const uint32_t height = this->getPyramidLevelHeight(previous);
+
+		const uint8_t *in{};
+		if ((previous == 0) && gray) {
+			const auto &grayPixels = this->getGrayscalePixels();
+			if (grayPixels.size() <
+			    (static_cast<size_t>(width) * height))
+				throw std::runtime_error{"Decoded image is "
+				    "smaller than its dimensions"};
+			in = grayPixels.data();
+		} else if (previous == 0) {
+			this->expandToRGBA(fullRGBA);
+			in = fullRGBA.data();
+		} else {
+			in = pyramid.back().data();
+		}
+
+		ScopedSpan span("pyramid");
+		std::vector<uint8_t> next(static_cast<size_t>(width / 2) *
+		    (height / 2) * (gray ? 1 : 4));
+		if (gray)
+			downsample2x2(in, width, height, next.data());
+		else
+			downsampleRGBA2x2(in, width, height, next.data());
+		span.setBytes(next.size());
+		pyramid.push_back(std::move(next));
+	}
+	this->touch(hit);
+
+	return (pyramid[level - 1]);
+}
+
 uint32_t
-ImageShim::getWidth()
+ImageShim::getPyramidLevelCount()
     const
 {
-	if (!this->image_)
+	if (!*this)
 		return (0);
 
-	return (this->image_->getDimensions().xSize);
+	return (::getPyramidLevelCount(this->getWidth(), this->getHeight()));
+}
+
+uint32_t
+ImageShim::getPyramidLevelForSize(
+    const uint32_t maxDimension)
+    const
+{
+	const uint32_t levels = this->getPyramidLevelCount();
+
+	uint32_t level{};
+	while (((level + 1) < levels) &&
+	    (std::max(this->getPyramidLevelWidth(level + 1),
+	    this->getPyramidLevelHeight(level + 1)) >= maxDimension))
+		++level;
+
+	return (level);
+}
+
+uint32_t
+ImageShim::getPyramidLevelWidth(
+    const uint32_t level)
+    const
+{
+	return (getPyramidDimension(this->getWidth(), level));
+}
+
+uint32_t
+ImageShim::getPyramidLevelHeight(
+    const uint32_t level)
+    const
+{
+	return (getPyramidDimension(this->getHeight(), level));
+}
+
+uint32_t
+ImageShim::getWidth()
+    const
+{
+	if (this->cache_->image)
+		return (this->cache_->image->getDimensions().xSize);
+
+	return (this->cache_->width);
 }
 
 uint32_t
 ImageShim::getHeight()
     const
 {
-	if (!this->image_)
-		return (0);
+	if (this->cache_->image)
+		return (this->cache_->image->getDimensions().ySize);
 
-	return (this->image_->getDimensions().ySize);
+	return (this->cache_->height);
 }
 
 uint16_t
 ImageShim::getPPI()
     const
 {
-	if (!this->image_)
-		return (0);
+	/* Recorded alongside the image, unless it wasn't */
+	if (this->cache_->ppi != 0)
+		return (this->cache_->ppi);
 
-	return (static_cast<uint16_t>(std::round(
-	    this->image_->getResolution().toUnits(
-	    BiometricEvaluation::Image::Resolution::Units::PPI).xRes)));
+	const auto &image = this->getImage();
+	if (!image)
+		return (0);
+	return (static_cast<uint16_t>(std::round(image->getResolution().
+	    toUnits(BiometricEvaluation::Image::Resolution::Units::PPI).
+	    xRes)));
 }
 
 ImageShim::operator bool()
     const
 {
-	return (this->image_ != nullptr);
-}
-
-EMSCRIPTEN_BINDINGS(easyimage) {
-	emscripten::class_<ImageShim>("ImageShim")
-	    .function("getBase64PNG", &ImageShim::getBase64PNG)
-	    .function("containsImage", emscripten::optional_override(
-	        [](const ImageShim &i) { return static_cast<bool>(i); }))
-	    ;
+	return (this->cache_->image || this->cache_->loader);
 }
@@ -11,11 +11,60 @@
 #ifndef IMAGE_SHIM_H_
 #define IMAGE_SHIM_H_
 
+#include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <be_image_image.h>
 
+#include "image_cache.h"
+
+/** Row filter applied to each row before compression */
+enum class PNGFilter
+{
+	None,
+	Sub,
+	Up,
+	Average,
+	Paeth,
+	/** Choose the best filter for each row (slowest) */
+	Adaptive
+};
+
+/** zlib compression strategy */
+enum class DeflateStrategy
+{
+	Default,
+	Filtered,
+	HuffmanOnly,
+	RLE
+};
+
+/** PNG encoder settings */
+struct PNGEncoding
+{
+	/**
+	 * zlib compression level, 0 (none) through 9 (smallest). Grayscale
+	 * images at level 1 use a faster, run-length-only deflate.
+	 */
+	int compressionLevel{6};
+	PNGFilter filter{PNGFilter::Adaptive};
+	DeflateStrategy strategy{DeflateStrategy::Default};
+
+	/** @return Settings favoring speed, e.g., for interactive display */
+	static PNGEncoding
+	forDisplay();
+
+	/** @return Settings favoring size, e.g., for export */
+	static PNGEncoding
+	forArchival();
+};
+
+/** Produces an image the first time its pixels are needed */
+using ImageLoader =
+    std::function<std::shared_ptr<BiometricEvaluation::Image::Image>()>;
+
 /** Trivial image representation for use on the JavaScript client side. */
 class ImageShim
 {
@@ -27,6 +76,32 @@ public:
 	ImageShim(
 	    std::shared_ptr<BiometricEvaluation::Image::Image> beImage);
 
+	/**
+	 * @brief
+	 * Instantiate an image that is decoded on demand.
+	 *
+	 * @param loader
+	 * Produces the image. Called the first time pixels or pixel format
+	 * are needed, and again if the image was evicted from ImageCache.
+	 * @param width
+	 * Width of image in pixels, as recorded alongside the image.
+	 * @param height
+	 * Height of image in pixels, as recorded alongside the image.
+	 * @param ppi
+	 * Resolution of image, in PPI, as recorded alongside the image.
+	 *
+	 * @note
+	 * getWidth() and getHeight() report the recorded values until the
+	 * image is decoded. getPPI() reports `ppi` throughout (decoding the
+	 * image for its resolution only if `ppi` is 0), so minutiae scaled by
+	 * it are placed the same whether or not the image was decoded first.
+	 */
+	ImageShim(
+	    ImageLoader loader,
+	    const uint32_t width,
+	    const uint32_t height,
+	    const uint16_t ppi);
+
 	/** Is the contents valid? */
 	explicit
 	operator bool()
@@ -51,6 +126,109 @@ public:
 	    bool inlineImagePrefix = true)
 	    const;
 
+	/**
+	 * @brief
+	 * Obtain PNG representation of image.
+	 *
+	 * @param encoding
+	 * Encoder settings.
+	 *
+	 * @return
+	 * PNG-encoded image, or empty vector if there is no image.
+	 *
+	 * @note
+	 * Encoding is not cached.
+	 */
+	std::vector<uint8_t>
+	getPNG(
+	    const PNGEncoding &encoding = PNGEncoding::forDisplay())
+	    const;
+
+	/**
+	 * @brief
+	 * Obtain decoded pixels, 8-bit grayscale.
+	 *
+	 * @return
+	 * getWidth() * getHeight() bytes, row-major.
+	 *
+	 * @note
+	 * Cached in ImageCache. For 8-bit grayscale images (nearly all
+	 * friction ridge images), this is the decoded buffer itself.
+	 * @note
+	 * Only valid until pixels of another ImageShim are requested, which
+	 * could evict these.
+	 */
+	const BiometricEvaluation::Memory::uint8Array&
+	getGrayscalePixels()
+	    const;
+
+	/**
+	 * @brief
+	 * Obtain decoded pixels, 8-bit RGBA, as expected by ImageData.
+	 *
+	 * @param level
+	 * Pyramid level, where 0 is full resolution and each subsequent
+	 * level is half the size of the last.
+	 *
+	 * @return
+	 * getPyramidLevelWidth(level) * getPyramidLevelHeight(level) * 4
+	 * bytes, row-major.
+	 *
+	 * @throw std::runtime_error
+	 * `level` is not less than getPyramidLevelCount(), or the decoded
+	 * image is smaller than its dimensions.
+	 *
+	 * @note
+	 * Cached in ImageCache, one level at a time. Only valid until pixels
+	 * of another ImageShim are requested, which could evict these.
+	 * @note
+	 * Levels other than 0 are grayscale unless the image has color (or
+	 * alpha).
+	 */
+	const std::vector<uint8_t>&
+	getRGBAPixels(
+	    const uint32_t level = 0)
+	    const;
+
+	/**
+	 * @return
+	 * Number of pyramid levels, including full resolution, or 0 if there is
+	 * no image.
+	 */
+	uint32_t
+	getPyramidLevelCount()
+	    const;
+
+	/**
+	 * @brief
+	 * Choose the pyramid level to display at a size.
+	 *
+	 * @param maxDimension
+	 * Largest width or height the image will be displayed at.
+	 *
+	 * @return
+	 * The smallest level whose width or height is at least
+	 * `maxDimension`, or 0 if even full resolution is smaller.
+	 *
+	 * @note
+	 * Does not decode the image.
+	 */
+	uint32_t
+	getPyramidLevelForSize(
+	    const uint32_t maxDimension)
+	    const;
+
+	/** @return Width of pyramid level `level` in pixels */
+	uint32_t
+	getPyramidLevelWidth(
+	    const uint32_t level)
+	    const;
+	/** @return Height of pyramid level `level` in pixels */
+	uint32_t
+	getPyramidLevelHeight(
+	    const uint32_t level)
+	    const;
+
 	/** @return Width of image in pixels */
 	uint32_t
 	getWidth()
@@ -65,15 +243,207 @@ public:
 	    const;
 
 private:
-	std::shared_ptr<BiometricEvaluation::Image::Image> image_{};
 	/**
 	 * @brief
-	 * Base64 representation of encoded PNG image.
+	 * The image and representations derived from it, populated on demand.
 	 *
 	 * @note
-	 * Populated exactly once after first call to getBase64PNG().
+	 * Everything but `loader` and the dimensions may be released by
+	 * ImageCache when it is over budget, and is recreated when next
+	 * needed.
+	 */
+	struct Cache : public Evictable
+	{
+		~Cache()
+		    override;
+
+		size_t
+		getEvictableSize()
+		    const
+		    override;
+
+		void
+		evict()
+		    override;
+
+		/** Decoded image, produced by `loader` if not yet decoded */
+		std::shared_ptr<BiometricEvaluation::Image::Image> image{};
+		/** Produces `image`, as many times as it is evicted */
+		ImageLoader loader{};
+		/**
+		 * Dimensions reported while not decoded, and resolution
+		 * reported throughout (if not 0)
+		 */
+		uint32_t width{};
+		uint32_t height{};
+		uint16_t ppi{};
+
+		/**
+		 * @brief
+		 * Decoded pixels.
+		 *
+		 * @note
+		 * Populated by getRawPixels().
+		 */
+		BiometricEvaluation::Memory::uint8Array raw{};
+		bool hasRaw{false};
+
+		/**
+		 * @brief
+		 * Decoded pixels converted to 8-bit grayscale.
+		 *
+		 * @note
+		 * Only populated when raw pixels are not 8-bit grayscale.
+		 */
+		BiometricEvaluation::Memory::uint8Array gray{};
+		bool hasGray{false};
+
+		/**
+		 * @brief
+		 * Base64 representation of encoded PNG image.
+		 *
+		 * @note
+		 * Populated by getBase64PNG().
+		 */
+		std::string base64PNG{};
+
+		/**
+		 * @brief
+		 * 8-bit RGBA pixels of pyramid level `rgbaLevel`.
+		 *
+		 * @note
+		 * Populated by getRGBAPixels(), except for color levels above
+		 * 0, which are returned from `pyramid` directly.
+		 */
+		std::vector<uint8_t> rgba{};
+		uint32_t rgbaLevel{};
+		bool hasRGBA{false};
+
+		/**
+		 * @brief
+		 * Pyramid levels 1 and up: 8-bit grayscale, or 8-bit RGBA if
+		 * the image has color (or alpha).
+		 *
+		 * @note
+		 * Each level is populated the first time it (or a smaller
+		 * level) is requested, from the level before it.
+		 */
+		std::vector<std::vector<uint8_t>> pyramid{};
+	};
+
+	/** Count a cache hit or miss, and mark this image as recently used */
+	void
+	touch(
+	    const bool hit)
+	    const;
+
+	/** @return The image, decoding it if needed (may be null) */
+	const std::shared_ptr<BiometricEvaluation::Image::Image>&
+	getImage()
+	    const;
+
+	/** @return Decoded pixels, in the image's native format */
+	const BiometricEvaluation::Memory::uint8Array&
+	getRawPixels()
+	    const;
+
+	/**
+	 * @return
+	 * Pixels of pyramid level `level`, which must be at least 1 and less
+	 * than getPyramidLevelCount(): 8-bit grayscale, or 8-bit RGBA unless
+	 * isGrayscale().
 	 */
-	mutable std::string base64PNG_{};
+	const std::vector<uint8_t>&
+	getPyramidLevel(
+	    const uint32_t level)
+	    const;
+
+	/**
+	 * @return
+	 * true unless the image has more than one channel that can be
+	 * displayed as RGBA (i.e., color or alpha).
+	 */
+	bool
+	isGrayscale()
+	    const;
+
+	/**
+	 * @brief
+	 * Expand full resolution pixels to 8-bit RGBA.
+	 *
+	 * @param rgba
+	 * Resized to getWidth() * getHeight() * 4 bytes and filled.
+	 *
+	 * @throw std::runtime_error
+	 * Decoded image is smaller than its dimensions.
+	 */
+	void
+	expandToRGBA(
+	    std::vector<uint8_t> &rgba)
+	    const;
+
+	/** @return true if raw pixels are 8-bit grayscale */
+	bool
+	isGray8()
+	    const;
+
+	/**
+	 * Shared between copies, since JavaScript receives a new copy of the
+	 * ImageShim on each access to a record.
+	 */
+	std::shared_ptr<Cache> cache_{std::make_shared<Cache>()};
 };
 
+/**
+ * @brief
+ * Encode raw pixels as PNG.
+ *
+ * @param rawData
+ * Decoded pixels, row-major. Rows are compressed in place; no copy is made.
+ * @param rawDataSize
+ * Number of bytes in `rawData`.
+ * @param hasAlphaChannel
+ * Whether or not pixels contain an alpha channel.
+ * @param colorDepth
+ * Bits per pixel.
+ * @param bitDepth
+ * Bits per color component.
+ * @param width
+ * Width of image in pixels.
+ * @param height
+ * Height of image in pixels.
+ * @param encoding
+ * Encoder settings.
+ *
+ * @return
+ * PNG-encoded pixels, or an empty vector if they could not be encoded.
+ */
+std::vector<uint8_t>
+rawToPNG(
+    const uint8_t *rawData,
+    const size_t rawDataSize,
+    const bool hasAlphaChannel,
+    const uint16_t colorDepth,
+    const uint16_t bitDepth,
+    const uint32_t width,
+    const uint32_t height,
+    const PNGEncoding &encoding = PNGEncoding::forDisplay());
+
+/**
+ * @brief
+ * Encode an image as PNG.
+ *
+ * @param image
+ * Image to encode.
+ * @param encoding
+ * Encoder settings.
+ *
+ * @return
+ * PNG-encoded `image`, or an empty vector if `image` could not be encoded.
+ */
+std::vector<uint8_t>
+rawToPNG(
+    std::shared_ptr<BiometricEvaluation::Image::Image> image,
+    const PNGEncoding &encoding = PNGEncoding::forDisplay());
+
 #endif /* EASY_IMAGE_H_ */
@@ -0,0 +1,101 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include "parse_session.h"
+
+#if defined(__EMSCRIPTEN__) || defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include <stdexcept>
+
+#if defined(__EMSCRIPTEN__)
+#include <emscripten/heap.h>
+#endif
+
+#include "profile.h"
+
+namespace BE = BiometricEvaluation;
+
+ParseSession::ParseSession(
+    BE::Memory::uint8Array &transaction)
+{
+	ScopedSpan span("ParseSession");
+	span.setBytes(transaction.size());
+
+	/* Only records outlive the parsed transaction */
+	const BE::DataInterchange::AN2KRecord an2k = [&transaction]() {
+		ScopedSpan parseSpan("parse AN2K");
+		parseSpan.setBytes(transaction.size());
+		return (BE::DataInterchange::AN2KRecord(transaction));
+	}();
+
+	this->summary_ = ::getRecordSummary(an2k);
+	this->identifiers_ = ::getFrictionRidgeImageIdentifiers(an2k);
+	this->records_ = getFrictionRidgeImagesWithMinutiaeData(an2k);
+}
+
+const RecordSummary&
+ParseSession::getRecordSummary()
+    const
+{
+	return (this->summary_);
+}
+
+const std::vector<RecordIdentifier>&
+ParseSession::getFrictionRidgeImageIdentifiers()
+    const
+{
+	return (this->identifiers_);
+}
+
+size_t
+ParseSession::getRecordCount()
+    const
+{
+	return (this->records_.size());
+}
+
+const ParseSession::Record&
+ParseSession::getRecord(
+    const size_t i)
+    const
+{
+	return (this->records_.at(i));
+}
+
+HeapStatistics
+getHeapStatistics()
+{
+	HeapStatistics stats{};
+
+#if defined(__EMSCRIPTEN__)
+	/* dlmalloc */
+	const struct mallinfo info = mallinfo();
+	stats.available = true;
+	stats.heapSize = emscripten_get_heap_size();
+	stats.footprint = static_cast<size_t>(info.arena) +
+	    static_cast<size_t>(info.hblkhd);
+	stats.peakFootprint = static_cast<size_t>(info.usmblks);
+	stats.allocatedBytes = static_cast<size_t>(info.uordblks);
+	stats.freeBytes = static_cast<size_t>(info.fordblks);
+#elif defined(__GLIBC__) && \
+    ((__GLIBC__ > 2) || ((__GLIBC__ == 2) && (__GLIBC_MINOR__ >= 33)))
+	/* glibc does not track a high-water mark */
+	const struct mallinfo2 info = mallinfo2();
+	stats.available = true;
+	stats.footprint = info.arena + info.hblkhd;
+	stats.heapSize = stats.footprint;
+	stats.allocatedBytes = info.uordblks + info.hblkhd;
+	stats.freeBytes = info.fordblks;
+#endif
+
+	return (stats);
+}
@@ -0,0 +1,116 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef PARSE_SESSION_H_
+#define PARSE_SESSION_H_
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include <be_data_interchange_an2k.h>
+#include <be_memory_autoarray.h>
+
+#include "frme_an2k.h"
+#include "image_shim.h"
+
+/**
+ * @brief
+ * Everything derived from one transaction, owned in one place.
+ *
+ * @details
+ * The transaction is parsed once, on construction. Its summary and record
+ * identifiers are computed up front and the parsed AN2KRecord is then
+ * released, so only the records (each of which holds its own encoded image)
+ * remain. Destroying the session releases all of it at once.
+ */
+class ParseSession
+{
+public:
+	/** (image, minutiae data records) pair, as displayed by the client */
+	using Record = std::pair<ImageShim,
+	    std::vector<BiometricEvaluation::Finger::AN2KMinutiaeDataRecord>>;
+
+	/**
+	 * @brief
+	 * Parse a transaction.
+	 *
+	 * @param transaction
+	 * ANSI/NIST-ITL transaction. Not referenced after construction.
+	 *
+	 * @throw BiometricEvaluation::Error::Exception
+	 * Transaction could not be parsed.
+	 */
+	explicit ParseSession(
+	    BiometricEvaluation::Memory::uint8Array &transaction);
+
+	/** @return Summary of the transaction */
+	const RecordSummary&
+	getRecordSummary()
+	    const;
+
+	/** @return Record type and IDC of each friction ridge image record */
+	const std::vector<RecordIdentifier>&
+	getFrictionRidgeImageIdentifiers()
+	    const;
+
+	/** @return Number of friction ridge image records */
+	size_t
+	getRecordCount()
+	    const;
+
+	/**
+	 * @return
+	 * Friction ridge image record `i`, in the same order as
+	 * getFrictionRidgeImageIdentifiers().
+	 *
+	 * @throw std::out_of_range
+	 * `i` is not less than getRecordCount().
+	 */
+	const Record&
+	getRecord(
+	    const size_t i)
+	    const;
+
+private:
+	RecordSummary summary_{};
+	std::vector<RecordIdentifier> identifiers_{};
+	std::vector<Record> records_{};
+};
+
+/** Snapshot of the allocator's view of the heap. */
+struct HeapStatistics
+{
+	/** Whether the platform's allocator reports statistics at all */
+	bool available{false};
+	/** Bytes of memory (WebAssembly linear memory) given to the program */
+	size_t heapSize{};
+	/** Bytes obtained by the allocator, in use or free */
+	size_t footprint{};
+	/** Most bytes the allocator has ever obtained (high-water mark) */
+	size_t peakFootprint{};
+	/** Bytes in allocated blocks */
+	size_t allocatedBytes{};
+	/** Bytes in free blocks, available for reuse */
+	size_t freeBytes{};
+};
+
+/**
+ * @return
+ * Current heap statistics.
+ *
+ * @note
+ * Fields the platform's allocator does not report are 0, and all are 0
+ * with `available` false if it reports none.
+ */
+HeapStatistics
+getHeapStatistics();
+
+#endif /* PARSE_SESSION_H_ */
@@ -0,0 +1,883 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+/*
+ * The Sub and Up filters both subtract one run of bytes from another (the row
+ * shifted by one pixel, or the row above), so a single vector kernel
+ * implements both. Results are identical to the scalar implementation.
+ */
+
+#include "png_gray.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <queue>
+#include <utility>
+
+#include <zlib.h>
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define FRME_PNG_WASM_SIMD128
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FRME_PNG_NEON
+#elif (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#include <emmintrin.h>
+#define FRME_PNG_SSE2
+#endif
+
+/** Uncompressed bytes filtered per call to deflate() */
+static constexpr size_t FilterBatchSize{64 * 1024};
+
+/** PNG file signature */
+static constexpr uint8_t PNGSignature[]{
+    0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+/** IHDR color type for grayscale */
+static constexpr uint8_t PNGColorTypeGray{0};
+
+#if defined(FRME_PNG_WASM_SIMD128)
+
+/**
+ * @brief
+ * Subtract bytes with WebAssembly SIMD.
+ *
+ * @return
+ * Number of bytes written (a multiple of 16).
+ */
+static size_t
+subtractBytesVector(
+    const uint8_t *a,
+    const uint8_t *b,
+    const size_t count,
+    uint8_t *out)
+{
+	size_t i{};
+	for (; (i + 16) <= count; i += 16)
+		wasm_v128_store(out + i, wasm_i8x16_sub(wasm_v128_load(a + i),
+		    wasm_v128_load(b + i)));
+
+	return (i);
+}
+
+static const char VectorImplementation[] = "WebAssembly SIMD";
+
+#elif defined(FRME_PNG_NEON)
+
+/**
+ * @brief
+ * Subtract bytes with NEON.
+ *
+ * @return
+ * Number of bytes written (a multiple of 16).
+ */
+static size_t
+subtractBytesVector(
+    const uint8_t *a,
+    const uint8_t *b,
+    const size_t count,
+    uint8_t *out)
+{
+	size_t i{};
+	for (; (i + 16) <= count; i += 16)
+		vst1q_u8(out + i, vsubq_u8(vld1q_u8(a + i), vld1q_u8(b + i)));
+
+	return (i);
+}
+
+static const char VectorImplementation[] = "NEON";
+
+#elif defined(FRME_PNG_SSE2)
+
+/**
+ * @brief
+ * Subtract bytes with SSE2.
+ *
+ * @return
+ * Number of bytes written (a multiple of 16).
+ */
+static size_t
+subtractBytesVector(
+    const uint8_t *a,
+    const uint8_t *b,
+    const size_t count,
+    uint8_t *out)
+{
+	size_t i{};
+	for (; (i + 16) <= count; i += 16)
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+		    _mm_sub_epi8(
+		    _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)),
+		    _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i))));
+
+	return (i);
+}
+
+static const char VectorImplementation[] = "SSE2";
+
+#endif
+
+/**
+ * @brief
+ * Subtract one run of bytes from another, modulo 256.
+ *
+ * @param a
+ * Minuends.
+ * @param b
+ * Subtrahends.
+ * @param count
+ * Number of bytes in `a`, `b`, and `out`.
+ * @param out
+ * Where to write `a[i] - b[i]`.
+ */
+static void
+subtractBytes(
+    const uint8_t *a,
+    const uint8_t *b,
+    const size_t count,
+    uint8_t *out)
+{
+	size_t i{};
+#if defined(FRME_PNG_WASM_SIMD128) || defined(FRME_PNG_NEON) || \
+    defined(FRME_PNG_SSE2)
+	i = subtractBytesVector(a, b, count, out);
+#endif
+	for (; i < count; ++i)
+		out[i] = static_cast<uint8_t>(a[i] - b[i]);
+}
+
+/** @return PNG filter type byte for `filter` */
+static uint8_t
+getFilterType(
+    const PNGFilter filter,
+    const bool firstRow)
+{
+	switch (filter) {
+	case PNGFilter::Sub:
+		return (1);
+	case PNGFilter::Up:
+		/* Up from an implicit row of zeros is None */
+		return (firstRow ? 0 : 2);
+	default:
+		return (0);
+	}
+}
+
+/** Append `value` to `out` as 4 big-endian bytes */
+static void
+appendUInt32(
+    std::vector<uint8_t> &out,
+    const uint32_t value)
+{
+	out.push_back(static_cast<uint8_t>(value >> 24));
+	out.push_back(static_cast<uint8_t>(value >> 16));
+	out.push_back(static_cast<uint8_t>(value >> 8));
+	out.push_back(static_cast<uint8_t>(value));
+}
+
+/** Write `value` at `out` as 4 big-endian bytes */
+static void
+writeUInt32(
+    uint8_t *out,
+    const uint32_t value)
+{
+	out[0] = static_cast<uint8_t>(value >> 24);
+	out[1] = static_cast<uint8_t>(value >> 16);
+	out[2] = static_cast<uint8_t>(value >> 8);
+	out[3] = static_cast<uint8_t>(value);
+}
+
+/**
+ * @brief
+ * Append a complete chunk.
+ *
+ * @param out
+ * PNG stream.
+ * @param type
+ * Four-character chunk type.
+ * @param data
+ * Chunk data.
+ * @param length
+ * Number of bytes in `data`.
+ */
+static void
+appendChunk(
+    std::vector<uint8_t> &out,
+    const char type[4],
+    const uint8_t *data,
+    const uint32_t length)
+{
+	appendUInt32(out, length);
+	const size_t typeOffset = out.size();
+	out.insert(out.end(), type, type + 4);
+	if (length > 0)
+		out.insert(out.end(), data, data + length);
+	appendUInt32(out, static_cast<uint32_t>(::crc32(0,
+	    out.data() + typeOffset, length + 4)));
+}
+
+int
+toZlibStrategy(
+    const DeflateStrategy strategy)
+{
+	switch (strategy) {
+	case DeflateStrategy::Default:
+		return (Z_DEFAULT_STRATEGY);
+	case DeflateStrategy::Filtered:
+		return (Z_FILTERED);
+	case DeflateStrategy::HuffmanOnly:
+		return (Z_HUFFMAN_ONLY);
+	case DeflateStrategy::RLE:
+		return (Z_RLE);
+	}
+
+	return (Z_DEFAULT_STRATEGY);
+}
+
+bool
+canEncodeGrayPNG(
+    const PNGEncoding &encoding)
+{
+	switch (encoding.filter) {
+	case PNGFilter::None:
+	case PNGFilter::Sub:
+	case PNGFilter::Up:
+		return (true);
+	default:
+		return (false);
+	}
+}
+
+void
+filterPNGRow(
+    const PNGFilter filter,
+    const uint8_t *row,
+    const uint8_t *prior,
+    const size_t rowBytes,
+    const size_t bytesPerPixel,
+    uint8_t *out)
+{
+	switch (getFilterType(filter, prior == nullptr)) {
+	case 1: {
+		const size_t first = std::min(bytesPerPixel, rowBytes);
+		std::memcpy(out, row, first);
+		subtractBytes(row + first, row, rowBytes - first, out + first);
+		break;
+	}
+	case 2:
+		subtractBytes(row, prior, rowBytes, out);
+		break;
+	default:
+		std::memcpy(out, row, rowBytes);
+		break;
+	}
+}
+
+/*
+ * Fast deflate: each batch of filtered rows becomes one dynamic Huffman
+ * block of literals and runs (matches at distance 1). Filtered friction
+ * ridge images are mostly small residuals and long runs of background, so
+ * this compresses nearly as well as zlib's fastest level at a fraction of
+ * the time spent searching for matches.
+ */
+
+/** Longest Huffman code deflate allows for literals and lengths */
+static constexpr unsigned MaxCodeLength{15};
+
+/** Longest Huffman code deflate allows for code lengths */
+static constexpr unsigned MaxCodeLengthCodeLength{7};
+
+/** Literal/length alphabet size (literals, end of block, lengths) */
+static constexpr size_t LiteralLengthSymbols{286};
+
+/** End of block symbol */
+static constexpr uint16_t EndOfBlock{256};
+
+/** Shortest and longest runs a length symbol encodes */
+static constexpr size_t MinRunLength{3};
+static constexpr size_t MaxRunLength{258};
+
+/** Token flag marking a run rather than a literal */
+static constexpr uint32_t RunToken{0x10000};
+
+/** Order in which code length code lengths are written */
+static constexpr uint8_t CodeLengthOrder[]{
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+/** Length symbol and extra bits for a run length */
+struct LengthCode
+{
+	uint16_t symbol{};
+	uint8_t extraBits{};
+	uint16_t extraValue{};
+};
+
+/** @return LengthCode for each run length, indexed by length */
+static const std::array<LengthCode, MaxRunLength + 1>&
+getLengthCodes()
+{
+	static const auto codes = []() {
+		static constexpr uint16_t Base[]{3, 4, 5, 6, 7, 8, 9, 10, 11,
+		    13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99,
+		    115, 131, 163, 195, 227, 258};
+		static constexpr uint8_t Extra[]{0, 0, 0, 0, 0, 0, 0, 0, 1,
+		    1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5,
+		    0};
+
+		std::array<LengthCode, MaxRunLength + 1> table{};
+		for (uint16_t i{}; i < std::size(Base); ++i) {
+			for (uint16_t v{}; v < (1u << Extra[i]); ++v) {
+				const size_t length = Base[i] + v;
+				if (length <= MaxRunLength)
+					table[length] = {static_cast<uint16_t>(
+					    257 + i), Extra[i], v};
+			}
+		}
+		return (table);
+	}();
+
+	return (codes);
+}
+
+/** Huffman code for each symbol of an alphabet */
+struct HuffmanCode
+{
+	/** Code, bit-reversed for writing least significant bit first */
+	std::vector<uint16_t> codes{};
+	std::vector<uint8_t> lengths{};
+};
+
+/**
+ * @brief
+ * Build a length-limited Huffman code.
+ *
+ * @param frequencies
+ * Occurrences of each symbol.
+ * @param limit
+ * Longest code allowed.
+ *
+ * @return
+ * Canonical code with a length of 0 for each unused symbol.
+ */
+static HuffmanCode
+buildHuffmanCode(
+    const std::vector<uint32_t> &frequencies,
+    const unsigned limit)
+{
+	const size_t symbolCount = frequencies.size();
+	HuffmanCode code{std::vector<uint16_t>(symbolCount),
+	    std::vector<uint8_t>(symbolCount)};
+
+	/* Used symbols, most frequent first */
+	std::vector<uint16_t> used{};
+	for (uint16_t s{}; s < symbolCount; ++s)
+		if (frequencies[s] > 0)
+			used.push_back(s);
+	std::stable_sort(used.begin(), used.end(), [&](auto a, auto b) {
+		return (frequencies[a] > frequencies[b]);
+	});
+
+	/* A code needs two symbols, even if only one is used */
+	if (used.size() == 1)
+		used.push_back((used.front() == 0) ? 1 : 0);
+
+	/* Depth of each used symbol in an unlimited Huffman tree */
+	std::vector<unsigned> depths(used.size());
+	if (used.size() > 1) {
+		using Node = std::pair<uint64_t, size_t>;
+		std::priority_queue<Node, std::vector<Node>,
+		    std::greater<Node>> queue{};
+		std::vector<size_t> parents(used.size());
+		for (size_t i{}; i < used.size(); ++i)
+			queue.emplace(frequencies[used[i]], i);
+		while (queue.size() > 1) {
+			const auto [f0, n0] = queue.top();
+			queue.pop();
+			const auto [f1, n1] = queue.top();
+			queue.pop();
+
+			const size_t parent = parents.size();
+			parents.push_back(parent);
+			parents[n0] = parent;
+			parents[n1] = parent;
+			queue.emplace(f0 + f1, parent);
+		}
+		for (size_t i{}; i < used.size(); ++i)
+			for (size_t n = i; parents[n] != n; n = parents[n])
+				++depths[i];
+	}
+
+	/* Symbols per length, lengthened beyond the limit as in JPEG K.3 */
+	std::vector<uint32_t> lengthCounts(std::max<size_t>(limit,
+	    *std::max_element(depths.begin(), depths.end())) + 1);
+	for (const auto depth : depths)
+		++lengthCounts[depth];
+	for (size_t i = lengthCounts.size() - 1; i > limit; --i) {
+		while (lengthCounts[i] > 0) {
+			size_t j = i - 2;
+			while (lengthCounts[j] == 0)
+				--j;
+			lengthCounts[i] -= 2;
+			lengthCounts[i - 1] += 1;
+			lengthCounts[j + 1] += 2;
+			lengthCounts[j] -= 1;
+		}
+	}
+
+	/* Shortest lengths to the most frequent symbols */
+	size_t next{};
+	for (uint8_t length = 1; length <= limit; ++length)
+		for (uint32_t i{}; i < lengthCounts[length]; ++i)
+			code.lengths[used[next++]] = length;
+
+	/* Canonical codes (RFC 1951 3.2.2), reversed */
+	uint16_t nextCode[MaxCodeLength + 2]{};
+	uint16_t value{};
+	for (uint8_t length = 1; length <= limit; ++length) {
+		value = static_cast<uint16_t>((value +
+		    lengthCounts[length - 1]) << 1);
+		nextCode[length] = value;
+	}
+	for (size_t s{}; s < symbolCount; ++s) {
+		const uint8_t length = code.lengths[s];
+		if (length == 0)
+			continue;
+
+		const uint16_t c = nextCode[length]++;
+		uint16_t reversed{};
+		for (uint8_t b{}; b < length; ++b)
+			reversed |= ((c >> b) & 1) << (length - 1 - b);
+		code.codes[s] = reversed;
+	}
+
+	return (code);
+}
+
+/** Writes bits least significant first, as deflate requires */
+struct BitWriter
+{
+	uint8_t *out{};
+	uint64_t buffer{};
+	unsigned count{};
+};
+
+/** Write the low `count` (at most 16) bits of `bits` */
+static inline void
+putBits(
+    BitWriter &writer,
+    const uint32_t bits,
+    const unsigned count)
+{
+	writer.buffer |= static_cast<uint64_t>(bits) << writer.count;
+	writer.count += count;
+	if (writer.count >= 32) {
+		for (unsigned i{}; i < 4; ++i)
+			*writer.out++ = static_cast<uint8_t>(writer.buffer >>
+			    (8 * i));
+		writer.buffer >>= 32;
+		writer.count -= 32;
+	}
+}
+
+/** Write any remaining bits, padded to a byte */
+static void
+flushBits(
+    BitWriter &writer)
+{
+	while (writer.count > 0) {
+		*writer.out++ = static_cast<uint8_t>(writer.buffer);
+		writer.buffer >>= 8;
+		writer.count = (writer.count > 8) ? (writer.count - 8) : 0;
+	}
+}
+
+/**
+ * @brief
+ * Split filtered bytes into literals and runs.
+ *
+ * @param data
+ * Filtered bytes.
+ * @param size
+ * Number of bytes in `data`.
+ * @param tokens
+ * Where to write literals (the byte) and runs (RunToken | length) of the
+ * preceding byte.
+ * @param frequencies
+ * Occurrences of each literal/length symbol, incremented.
+ */
+static void
+tokenize(
+    const uint8_t *data,
+    const size_t size,
+    std::vector<uint32_t> &tokens,
+    std::vector<uint32_t> &frequencies)
+{
+	const auto &lengthCodes = getLengthCodes();
+
+	tokens.clear();
+	size_t i{};
+	while (i < size) {
+		const uint8_t value = data[i++];
+		tokens.push_back(value);
+		++frequencies[value];
+
+		const size_t maxRun = std::min(MaxRunLength, size - i);
+		size_t run{};
+		while ((run < maxRun) && (data[i + run] == value))
+			++run;
+		if (run >= MinRunLength) {
+			tokens.push_back(RunToken | static_cast<uint32_t>(run));
+			++frequencies[lengthCodes[run].symbol];
+			i += run;
+		}
+	}
+}
+
+/**
+ * @brief
+ * Write one dynamic Huffman block.
+ *
+ * @param writer
+ * Destination.
+ * @param data
+ * Filtered bytes.
+ * @param size
+ * Number of bytes in `data`.
+ * @param last
+ * Whether or not this is the final block.
+ * @param tokens
+ * Scratch space.
+ */
+static void
+writeDynamicBlock(
+    BitWriter &writer,
+    const uint8_t *data,
+    const size_t size,
+    const bool last,
+    std::vector<uint32_t> &tokens)
+{
+	const auto &lengthCodes = getLengthCodes();
+
+	std::vector<uint32_t> frequencies(LiteralLengthSymbols);
+	tokenize(data, size, tokens, frequencies);
+	frequencies[EndOfBlock] = 1;
+	const HuffmanCode literals = buildHuffmanCode(frequencies,
+	    MaxCodeLength);
+
+	/* Runs are all at distance 1, so two 1-bit distance codes suffice */
+	size_t literalCount = LiteralLengthSymbols;
+	while (literals.lengths[literalCount - 1] == 0)
+		--literalCount;
+	std::vector<uint8_t> lengths(literals.lengths.begin(),
+	    literals.lengths.begin() + literalCount);
+	lengths.push_back(1);
+	lengths.push_back(1);
+
+	/* Run-length encode the code lengths (symbols 16, 17, and 18) */
+	std::vector<std::pair<uint8_t, uint8_t>> lengthSymbols{};
+	std::vector<uint32_t> lengthFrequencies(19);
+	for (size_t i{}; i < lengths.size();) {
+		const uint8_t length = lengths[i];
+		size_t run{1};
+		while (((i + run) < lengths.size()) &&
+		    (lengths[i + run] == length))
+			++run;
+		i += run;
+
+		if (length == 0) {
+			while (run >= 11) {
+				const size_t n = std::min<size_t>(run, 138);
+				lengthSymbols.emplace_back(18, n - 11);
+				run -= n;
+			}
+			if (run >= 3) {
+				lengthSymbols.emplace_back(17, run - 3);
+				run = 0;
+			}
+		} else {
+			lengthSymbols.emplace_back(length, 0);
+			--run;
+			while (run >= 3) {
+				const size_t n = std::min<size_t>(run, 6);
+				lengthSymbols.emplace_back(16, n - 3);
+				run -= n;
+			}
+		}
+		for (; run > 0; --run)
+			lengthSymbols.emplace_back(length, 0);
+	}
+	for (const auto &[symbol, extra] : lengthSymbols)
+		++lengthFrequencies[symbol];
+	const HuffmanCode lengthCode = buildHuffmanCode(lengthFrequencies,
+	    MaxCodeLengthCodeLength);
+
+	size_t lengthCodeCount = std::size(CodeLengthOrder);
+	while ((lengthCodeCount > 4) && (lengthCode.lengths[
+	    CodeLengthOrder[lengthCodeCount - 1]] == 0))
+		--lengthCodeCount;
+
+	/* Header: BFINAL, BTYPE 2, HLIT, HDIST, HCLEN */
+	putBits(writer, last ? 1 : 0, 1);
+	putBits(writer, 2, 2);
+	putBits(writer, literalCount - 257, 5);
+	putBits(writer, 2 - 1, 5);
+	putBits(writer, lengthCodeCount - 4, 4);
+	for (size_t i{}; i < lengthCodeCount; ++i)
+		putBits(writer, lengthCode.lengths[CodeLengthOrder[i]], 3);
+	for (const auto &[symbol, extra] : lengthSymbols) {
+		putBits(writer, lengthCode.codes[symbol],
+		    lengthCode.lengths[symbol]);
+		if (symbol == 16)
+			putBits(writer, extra, 2);
+		else if (symbol == 17)
+			putBits(writer, extra, 3);
+		else if (symbol == 18)
+			putBits(writer, extra, 7);
+	}
+
+	for (const auto token : tokens) {
+		if ((token & RunToken) == 0) {
+			putBits(writer, literals.codes[token],
+			    literals.lengths[token]);
+		} else {
+			const LengthCode &length = lengthCodes[
+			    token & ~RunToken];
+			putBits(writer, literals.codes[length.symbol],
+			    literals.lengths[length.symbol]);
+			putBits(writer, length.extraValue, length.extraBits);
+			/* Distance code 0 (distance 1) */
+			putBits(writer, 0, 1);
+		}
+	}
+	putBits(writer, literals.codes[EndOfBlock],
+	    literals.lengths[EndOfBlock]);
+}
+
+/**
+ * @brief
+ * Filter rows into a batch.
+ *
+ * @param rawData
+ * First row of the image.
+ * @param y
+ * First row to filter.
+ * @param rows
+ * Number of rows to filter.
+ * @param rowBytes
+ * Number of bytes in each unfiltered row.
+ * @param bytesPerPixel
+ * Bytes per pixel.
+ * @param filter
+ * Filter to apply.
+ * @param batch
+ * Where to write `rows` filtered rows, each preceded by its filter type.
+ */
+static void
+filterRows(
+    const uint8_t *rawData,
+    const size_t y,
+    const size_t rows,
+    const size_t rowBytes,
+    const size_t bytesPerPixel,
+    const PNGFilter filter,
+    uint8_t *batch)
+{
+	for (size_t r{}; r < rows; ++r) {
+		const uint8_t *row = rawData + ((y + r) * rowBytes);
+		const uint8_t *prior = ((y + r) == 0) ? nullptr :
+		    row - rowBytes;
+		uint8_t *out = batch + (r * (rowBytes + 1));
+
+		out[0] = getFilterType(filter, prior == nullptr);
+		filterPNGRow(filter, row, prior, rowBytes, bytesPerPixel,
+		    out + 1);
+	}
+}
+
+/**
+ * @brief
+ * Compress filtered rows with the fast deflate.
+ *
+ * @return
+ * zlib stream.
+ */
+static std::vector<uint8_t>
+compressFast(
+    const uint8_t *rawData,
+    const size_t height,
+    const size_t rowBytes,
+    const size_t bytesPerPixel,
+    const PNGFilter filter)
+{
+	const size_t filteredRowBytes = rowBytes + 1;
+	const size_t batchRows = std::max<size_t>(1,
+	    FilterBatchSize / filteredRowBytes);
+	std::vector<uint8_t> batch(batchRows * filteredRowBytes);
+	std::vector<uint32_t> tokens{};
+	tokens.reserve(batch.size());
+
+	/* Worst case is 15 bits per byte, plus a header */
+	std::vector<uint8_t> block((batch.size() * 2) + 1024);
+
+	std::vector<uint8_t> compressed{};
+	compressed.reserve((filteredRowBytes * height) / 2);
+	/* zlib header: deflate, 32 KiB window, fastest */
+	compressed.push_back(0x78);
+	compressed.push_back(0x01);
+
+	BitWriter writer{};
+	uLong adler = adler32(0, nullptr, 0);
+	for (size_t y{}; y < height; y += batchRows) {
+		const size_t rows = std::min(batchRows, height - y);
+		const size_t size = rows * filteredRowBytes;
+		filterRows(rawData, y, rows, rowBytes, bytesPerPixel, filter,
+		    batch.data());
+		adler = adler32(adler, batch.data(), static_cast<uInt>(size));
+
+		writer.out = block.data();
+		writeDynamicBlock(writer, batch.data(), size,
+		    (y + rows) >= height, tokens);
+		if ((y + rows) >= height)
+			flushBits(writer);
+		compressed.insert(compressed.end(), block.data(), writer.out);
+	}
+
+	appendUInt32(compressed, static_cast<uint32_t>(adler));
+
+	return (compressed);
+}
+
+/**
+ * @brief
+ * Compress filtered rows with zlib.
+ *
+ * @return
+ * zlib stream, or an empty vector if zlib failed.
+ */
+static std::vector<uint8_t>
+compressZlib(
+    const uint8_t *rawData,
+    const size_t height,
+    const size_t rowBytes,
+    const size_t bytesPerPixel,
+    const PNGEncoding &encoding)
+{
+	const size_t filteredRowBytes = rowBytes + 1;
+
+	z_stream stream{};
+	if (deflateInit2(&stream, std::clamp(encoding.compressionLevel, 0, 9),
+	    Z_DEFLATED, 15, 9, toZlibStrategy(encoding.strategy)) != Z_OK)
+		return {};
+
+	std::vector<uint8_t> compressed(deflateBound(&stream,
+	    static_cast<uLong>(filteredRowBytes * height)));
+	stream.next_out = compressed.data();
+	stream.avail_out = static_cast<uInt>(compressed.size());
+
+	const size_t batchRows = std::max<size_t>(1,
+	    FilterBatchSize / filteredRowBytes);
+	std::vector<uint8_t> batch(batchRows * filteredRowBytes);
+	int status{Z_OK};
+	for (size_t y{}; (y < height) && (status == Z_OK); y += batchRows) {
+		const size_t rows = std::min(batchRows, height - y);
+		filterRows(rawData, y, rows, rowBytes, bytesPerPixel,
+		    encoding.filter, batch.data());
+
+		stream.next_in = batch.data();
+		stream.avail_in = static_cast<uInt>(rows * filteredRowBytes);
+		status = deflate(&stream, ((y + rows) < height) ?
+		    Z_NO_FLUSH : Z_FINISH);
+	}
+	compressed.resize(stream.total_out);
+	deflateEnd(&stream);
+	if (status != Z_STREAM_END)
+		return {};
+
+	return (compressed);
+}
+
+/** Encode BitDepth-bit (8 or 16) grayscale pixels, see encodeGrayPNG() */
+template<uint16_t BitDepth>
+static std::vector<uint8_t>
+encodeGray(
+    const uint8_t *rawData,
+    const uint32_t width,
+    const uint32_t height,
+    const PNGEncoding &encoding)
+{
+	static_assert((BitDepth == 8) || (BitDepth == 16));
+	static constexpr size_t BytesPerPixel{BitDepth / 8};
+
+	if ((rawData == nullptr) || (width == 0) || (height == 0) ||
+	    !canEncodeGrayPNG(encoding))
+		return {};
+
+	const size_t rowBytes = static_cast<size_t>(width) * BytesPerPixel;
+	const std::vector<uint8_t> compressed = (encoding.compressionLevel ==
+	    1) ? compressFast(rawData, height, rowBytes, BytesPerPixel,
+	    encoding.filter) : compressZlib(rawData, height, rowBytes,
+	    BytesPerPixel, encoding);
+	if (compressed.empty())
+		return {};
+
+	std::vector<uint8_t> png{};
+	png.reserve(sizeof(PNGSignature) + 25 + compressed.size() + 24);
+	png.insert(png.end(), std::begin(PNGSignature), std::end(PNGSignature));
+
+	uint8_t ihdr[13]{};
+	writeUInt32(ihdr, width);
+	writeUInt32(ihdr + 4, height);
+	ihdr[8] = BitDepth;
+	ihdr[9] = PNGColorTypeGray;
+	/* Compression, filter, and interlace methods are all 0 */
+	appendChunk(png, "IHDR", ihdr, sizeof(ihdr));
+	appendChunk(png, "IDAT", compressed.data(),
+	    static_cast<uint32_t>(compressed.size()));
+	appendChunk(png, "IEND", nullptr, 0);
+
+	return (png);
+}
+
+template<>
+std::vector<uint8_t>
+encodeGrayPNG<8>(
+    const uint8_t *rawData,
+    const uint32_t width,
+    const uint32_t height,
+    const PNGEncoding &encoding)
+{
+	return (encodeGray<8>(rawData, width, height, encoding));
+}
+
+template<>
+std::vector<uint8_t>
+encodeGrayPNG<16>(
+    const uint8_t *rawData,
+    const uint32_t width,
+    const uint32_t height,
+    const PNGEncoding &encoding)
+{
+	return (encodeGray<16>(rawData, width, height, encoding));
+}
+
+std::string
+getPNGFilterImplementation()
+{
+#if defined(FRME_PNG_WASM_SIMD128) || defined(FRME_PNG_NEON) || \
+    defined(FRME_PNG_SSE2)
+	return (VectorImplementation);
+#else
+	return ("scalar");
+#endif
+}
@@ -0,0 +1,124 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef PNG_GRAY_H_
+#define PNG_GRAY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "image_shim.h"
+
+/** @return zlib strategy for `strategy` */
+int
+toZlibStrategy(
+    const DeflateStrategy strategy);
+
+/**
+ * @brief
+ * Whether or not encodeGrayPNG() supports encoder settings.
+ *
+ * @param encoding
+ * Encoder settings.
+ *
+ * @return
+ * true if `encoding` uses a filter encodeGrayPNG() implements (None, Sub, or
+ * Up), false if the image must be encoded with libpng.
+ */
+bool
+canEncodeGrayPNG(
+    const PNGEncoding &encoding);
+
+/**
+ * @brief
+ * Apply a PNG row filter.
+ *
+ * @param filter
+ * PNGFilter::None, PNGFilter::Sub, or PNGFilter::Up.
+ * @param row
+ * Row to filter.
+ * @param prior
+ * Row before `row`, or nullptr if `row` is the first row.
+ * @param rowBytes
+ * Number of bytes in `row`.
+ * @param bytesPerPixel
+ * Distance between a byte and the corresponding byte of the pixel to its
+ * left, 1 or 2.
+ * @param out
+ * Where to write `rowBytes` filtered bytes (not including the filter type).
+ *
+ * @note
+ * Vectorized with WebAssembly SIMD (when built with -msimd128), NEON
+ * (AArch64), or SSE2 (x86), with a scalar fallback.
+ */
+void
+filterPNGRow(
+    const PNGFilter filter,
+    const uint8_t *row,
+    const uint8_t *prior,
+    const size_t rowBytes,
+    const size_t bytesPerPixel,
+    uint8_t *out);
+
+/**
+ * @brief
+ * Encode grayscale pixels as PNG without libpng.
+ *
+ * @param rawData
+ * width * height pixels of BitDepth bits each, row-major. 16-bit samples are
+ * big-endian, as PNG stores them.
+ * @param width
+ * Width of image in pixels.
+ * @param height
+ * Height of image in pixels.
+ * @param encoding
+ * Encoder settings, for which canEncodeGrayPNG() is true.
+ *
+ * @return
+ * PNG-encoded pixels, or an empty vector if they could not be encoded.
+ *
+ * @note
+ * Specialized for 8- and 16-bit grayscale, which is nearly every friction
+ * ridge image. Rows are filtered in batches and compressed into a single IDAT
+ * chunk. At compression level 1 (PNGEncoding::forDisplay()), batches are
+ * compressed by a built-in deflate that encodes only literals and runs,
+ * several times faster than zlib; other levels use zlib.
+ */
+template<uint16_t BitDepth>
+std::vector<uint8_t>
+encodeGrayPNG(
+    const uint8_t *rawData,
+    const uint32_t width,
+    const uint32_t height,
+    const PNGEncoding &encoding);
+
+template<>
+std::vector<uint8_t>
+encodeGrayPNG<8>(
+    const uint8_t *rawData,
+    const uint32_t width,
+    const uint32_t height,
+    const PNGEncoding &encoding);
+
+template<>
+std::vector<uint8_t>
+encodeGrayPNG<16>(
+    const uint8_t *rawData,
+    const uint32_t width,
+    const uint32_t height,
+    const PNGEncoding &encoding);
+
+/** @return Name of the instruction set filterPNGRow() uses */
+std::string
+getPNGFilterImplementation();
+
+#endif /* PNG_GRAY_H_ */
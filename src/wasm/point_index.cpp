@@ -0,0 +1,255 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include "point_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+/** Smallest width and height of a cell, in pixels */
+static constexpr uint32_t MinCellSize{4};
+
+/** @return Distance between two coordinates */
+static uint64_t
+getDifference(
+    const uint32_t a,
+    const uint32_t b)
+{
+	return ((a > b) ? (a - b) : (b - a));
+}
+
+/**
+ * @return
+ * Column or row (possibly negative, or past the last) of the cell containing
+ * `coordinate`, for cells of `cellSize` starting at `origin`.
+ */
+static int64_t
+getUnboundedCell(
+    const uint32_t coordinate,
+    const uint32_t origin,
+    const uint32_t cellSize)
+{
+	const int64_t offset{static_cast<int64_t>(coordinate) - origin};
+	if (offset >= 0)
+		return (offset / cellSize);
+	return (-((-offset + cellSize - 1) / cellSize));
+}
+
+PointIndex::PointIndex(
+    const PointSet &points) :
+    PointIndex(points.x, points.y)
+{
+
+}
+
+PointIndex::PointIndex(
+    std::vector<uint32_t> x,
+    std::vector<uint32_t> y) :
+    x_{std::move(x)},
+    y_{std::move(y)}
+{
+	if (this->x_.size() != this->y_.size())
+		throw std::invalid_argument{"Point coordinates differ in "
+		    "count"};
+
+	this->build();
+}
+
+size_t
+PointIndex::size()
+    const
+{
+	return (this->x_.size());
+}
+
+void
+PointIndex::build()
+{
+	const size_t count{this->x_.size()};
+	if (count == 0) {
+		this->cellStart_.assign(2, 0);
+		return;
+	}
+
+	const auto [minX, maxX] = std::minmax_element(this->x_.cbegin(),
+	    this->x_.cend());
+	const auto [minY, maxY] = std::minmax_element(this->y_.cbegin(),
+	    this->y_.cend());
+	this->originX_ = *minX;
+	this->originY_ = *minY;
+	const uint64_t width{static_cast<uint64_t>(*maxX) - *minX + 1};
+	const uint64_t height{static_cast<uint64_t>(*maxY) - *minY + 1};
+
+	/* About one point per cell, with at most a few cells per point */
+	uint64_t cellSize{std::max<uint64_t>(MinCellSize, static_cast<uint64_t>(
+	    std::ceil(std::sqrt(static_cast<double>(width) * height /
+	    count))))};
+	uint64_t columns{}, rows{};
+	while (true) {
+		columns = (width + cellSize - 1) / cellSize;
+		rows = (height + cellSize - 1) / cellSize;
+		if ((columns * rows) <= ((4 * count) + 16))
+			break;
+		cellSize *= 2;
+	}
+	this->cellSize_ = static_cast<uint32_t>(std::min<uint64_t>(cellSize,
+	    UINT32_MAX));
+	this->columns_ = static_cast<uint32_t>(columns);
+	this->rows_ = static_cast<uint32_t>(rows);
+
+	/* Counting sort by cell, so each cell's points are in order */
+	std::vector<uint32_t> cells(count);
+	this->cellStart_.assign((columns * rows) + 1, 0);
+	for (size_t i{}; i < count; ++i) {
+		cells[i] = (this->getCell(this->y_[i], this->originY_,
+		    this->rows_) * this->columns_) + this->getCell(this->x_[i],
+		    this->originX_, this->columns_);
+		++this->cellStart_[cells[i] + 1];
+	}
+	std::partial_sum(this->cellStart_.cbegin(), this->cellStart_.cend(),
+	    this->cellStart_.begin());
+
+	std::vector<uint32_t> next(this->cellStart_.cbegin(),
+	    this->cellStart_.cend() - 1);
+	this->order_.resize(count);
+	for (size_t i{}; i < count; ++i)
+		this->order_[next[cells[i]]++] = static_cast<uint32_t>(i);
+}
+
+uint32_t
+PointIndex::getCell(
+    const uint32_t coordinate,
+    const uint32_t origin,
+    const uint32_t count)
+    const
+{
+	if (coordinate < origin)
+		return (0);
+	return (std::min((coordinate - origin) / this->cellSize_, count - 1));
+}
+
+int32_t
+PointIndex::nearest(
+    const uint32_t x,
+    const uint32_t y,
+    const uint32_t maxDistance)
+    const
+{
+	if (this->x_.empty())
+		return (NoPoint);
+
+	int32_t best{NoPoint};
+	uint64_t bestSquared{static_cast<uint64_t>(maxDistance) * maxDistance};
+	const auto visit = [&](const int64_t column, const int64_t row) {
+		const size_t cell{static_cast<size_t>((row * this->columns_) +
+		    column)};
+		for (uint32_t k{this->cellStart_[cell]};
+		    k < this->cellStart_[cell + 1]; ++k) {
+			const uint32_t i{this->order_[k]};
+			const uint64_t dx{getDifference(this->x_[i], x)};
+			const uint64_t dy{getDifference(this->y_[i], y)};
+			const uint64_t squared{(dx * dx) + (dy * dy)};
+			if ((squared < bestSquared) || ((squared ==
+			    bestSquared) && ((best == NoPoint) ||
+			    (static_cast<int32_t>(i) < best)))) {
+				best = static_cast<int32_t>(i);
+				bestSquared = squared;
+			}
+		}
+	};
+
+	/* Cell containing (x, y), which may be outside of the grid */
+	const int64_t cx{getUnboundedCell(x, this->originX_, this->cellSize_)};
+	const int64_t cy{getUnboundedCell(y, this->originY_, this->cellSize_)};
+	const int64_t lastColumn{static_cast<int64_t>(this->columns_) - 1};
+	const int64_t lastRow{static_cast<int64_t>(this->rows_) - 1};
+	const int64_t lastRing{std::max({std::abs(cx), std::abs(lastColumn -
+	    cx), std::abs(cy), std::abs(lastRow - cy)})};
+
+	for (int64_t ring{}; ring <= lastRing; ++ring) {
+		/* Points in this ring are at least (ring - 1) cells away */
+		if (ring > 1) {
+			const uint64_t gap{static_cast<uint64_t>(ring - 1) *
+			    this->cellSize_};
+			if (gap > (bestSquared / gap))
+				break;
+		}
+
+		const int64_t firstColumn{std::max<int64_t>(cx - ring, 0)};
+		const int64_t endColumn{std::min(cx + ring, lastColumn)};
+		const int64_t firstRow{std::max<int64_t>(cy - ring + 1, 0)};
+		const int64_t endRow{std::min(cy + ring - 1, lastRow)};
+
+		/* Top and bottom edges, then left and right between them */
+		for (const int64_t row : {cy - ring, cy + ring}) {
+			if ((row < 0) || (row > lastRow))
+				continue;
+			for (int64_t column{firstColumn}; column <= endColumn;
+			    ++column)
+				visit(column, row);
+			if (ring == 0)
+				break;
+		}
+		for (const int64_t column : {cx - ring, cx + ring}) {
+			if ((ring == 0) || (column < 0) ||
+			    (column > lastColumn))
+				continue;
+			for (int64_t row{firstRow}; row <= endRow; ++row)
+				visit(column, row);
+		}
+	}
+
+	return (best);
+}
+
+std::vector<uint32_t>
+PointIndex::query(
+    const uint32_t left,
+    const uint32_t top,
+    const uint32_t right,
+    const uint32_t bottom)
+    const
+{
+	std::vector<uint32_t> found{};
+	if (this->x_.empty() || (left > right) || (top > bottom))
+		return (found);
+
+	const uint32_t firstColumn{this->getCell(left, this->originX_,
+	    this->columns_)};
+	const uint32_t lastColumn{this->getCell(right, this->originX_,
+	    this->columns_)};
+	const uint32_t firstRow{this->getCell(top, this->originY_,
+	    this->rows_)};
+	const uint32_t lastRow{this->getCell(bottom, this->originY_,
+	    this->rows_)};
+
+	for (uint32_t row{firstRow}; row <= lastRow; ++row) {
+		for (uint32_t column{firstColumn}; column <= lastColumn;
+		    ++column) {
+			const size_t cell{(static_cast<size_t>(row) *
+			    this->columns_) + column};
+			for (uint32_t k{this->cellStart_[cell]};
+			    k < this->cellStart_[cell + 1]; ++k) {
+				const uint32_t i{this->order_[k]};
+				if ((this->x_[i] >= left) &&
+				    (this->x_[i] <= right) &&
+				    (this->y_[i] >= top) &&
+				    (this->y_[i] <= bottom))
+					found.push_back(i);
+			}
+		}
+	}
+	std::sort(found.begin(), found.end());
+
+	return (found);
+}
@@ -0,0 +1,150 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef POINT_INDEX_H_
+#define POINT_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "point_shim.h"
+
+/**
+ * @brief
+ * Uniform grid over the points of a PointSet, for hit-testing.
+ *
+ * @details
+ * Points are bucketed into square cells sized so that each holds about one
+ * point on average, and stored cell by cell in one array. Finding the point
+ * under the cursor then examines a handful of cells instead of every point,
+ * however many thousands a palm or EFS latent markup has.
+ */
+class PointIndex
+{
+public:
+	/** Returned by nearest() when no point is close enough */
+	static constexpr int32_t NoPoint{-1};
+
+	/**
+	 * @brief
+	 * Index points.
+	 *
+	 * @param points
+	 * Points, in pixels. Coordinates are copied.
+	 */
+	explicit PointIndex(
+	    const PointSet &points);
+
+	/**
+	 * @brief
+	 * Index points.
+	 *
+	 * @param x
+	 * X coordinate of each point, in pixels.
+	 * @param y
+	 * Y coordinate of each point, in pixels.
+	 *
+	 * @throw std::invalid_argument
+	 * `x` and `y` differ in size.
+	 */
+	PointIndex(
+	    std::vector<uint32_t> x,
+	    std::vector<uint32_t> y);
+
+	/** @return Number of points indexed */
+	size_t
+	size()
+	    const;
+
+	/**
+	 * @brief
+	 * Find the point nearest a location.
+	 *
+	 * @param x
+	 * X coordinate of the location, in pixels.
+	 * @param y
+	 * Y coordinate of the location, in pixels.
+	 * @param maxDistance
+	 * Farthest a point may be from (x, y), in pixels.
+	 *
+	 * @return
+	 * Position of the nearest point in the PointSet (the lowest position,
+	 * if several are equally near), or NoPoint if none is within
+	 * `maxDistance`.
+	 *
+	 * @note
+	 * Cells are examined in rings outward from (x, y), stopping once no
+	 * nearer point can remain, so a small `maxDistance` examines only the
+	 * cells it overlaps.
+	 */
+	int32_t
+	nearest(
+	    const uint32_t x,
+	    const uint32_t y,
+	    const uint32_t maxDistance)
+	    const;
+
+	/**
+	 * @brief
+	 * Find the points within a rectangle.
+	 *
+	 * @param left
+	 * Smallest X coordinate, in pixels.
+	 * @param top
+	 * Smallest Y coordinate, in pixels.
+	 * @param right
+	 * Largest X coordinate, in pixels.
+	 * @param bottom
+	 * Largest Y coordinate, in pixels.
+	 *
+	 * @return
+	 * Positions in the PointSet of the points within the rectangle (edges
+	 * included), in ascending order.
+	 */
+	std::vector<uint32_t>
+	query(
+	    const uint32_t left,
+	    const uint32_t top,
+	    const uint32_t right,
+	    const uint32_t bottom)
+	    const;
+
+private:
+	/** Build the grid from x_ and y_ */
+	void
+	build();
+
+	/** @return Column or row of the cell containing `coordinate` */
+	uint32_t
+	getCell(
+	    const uint32_t coordinate,
+	    const uint32_t origin,
+	    const uint32_t count)
+	    const;
+
+	std::vector<uint32_t> x_{};
+	std::vector<uint32_t> y_{};
+
+	/** Smallest coordinates of any point */
+	uint32_t originX_{};
+	uint32_t originY_{};
+	/** Width and height of each cell, in pixels */
+	uint32_t cellSize_{1};
+	uint32_t columns_{1};
+	uint32_t rows_{1};
+
+	/** Positions of points, ordered by cell (row-major) */
+	std::vector<uint32_t> order_{};
+	/** Start of each cell's points in order_, plus the end */
+	std::vector<uint32_t> cellStart_{};
+};
+
+#endif /* POINT_INDEX_H_ */
@@ -8,13 +8,165 @@
  * about its quality, reliability, or any other characteristic.
  */
 
+#include <algorithm>
+#include <cmath>
+
 #include "image_shim.h"
 #include "point_shim.h"
 
-#include <emscripten/bind.h>
-
 namespace BE = BiometricEvaluation;
 
+/**
+ * @brief
+ * Scale and clamp coordinates, as efsToPixel() (lossless) does for each.
+ *
+ * @param values
+ * Coordinates to convert, in place.
+ * @param count
+ * Number of coordinates at `values`.
+ * @param ppi
+ * Resolution of the image.
+ * @param maxValue
+ * Largest coordinate permitted.
+ */
+static void
+efsToPixel(
+    uint32_t *values,
+    const size_t count,
+    const uint16_t ppi,
+    const double maxValue)
+{
+	static constexpr double losslessFactor{1.0 / 2540.0};
+
+	/*
+	 * Same order of operations as efsToPixel(), so results are identical,
+	 * with the loop left simple enough to vectorize.
+	 */
+	const uint32_t resolution{ppi};
+	for (size_t i{}; i < count; ++i) {
+		const double val = std::min(maxValue, std::max(0.0,
+		    std::ceil(static_cast<double>(values[i] * resolution) *
+		    losslessFactor)));
+		values[i] = static_cast<uint32_t>(val);
+	}
+}
+
+size_t
+PointSet::size()
+    const
+{
+	return (this->x.size());
+}
+
+bool
+PointSet::empty()
+    const
+{
+	return (this->x.empty());
+}
+
+void
+PointSet::reserve(
+    const size_t count)
+{
+	this->x.reserve(count);
+	this->y.reserve(count);
+	this->angle.reserve(count);
+	this->type.reserve(count);
+}
+
+void
+PointSet::push_back(
+    const uint32_t pointX,
+    const uint32_t pointY,
+    const uint32_t pointAngle,
+    const PointShim::Type pointType)
+{
+	this->x.push_back(pointX);
+	this->y.push_back(pointY);
+	this->angle.push_back(pointAngle);
+	this->type.push_back(static_cast<uint8_t>(pointType));
+}
+
+std::vector<PointShim>
+PointSet::toPointShims()
+    const
+{
+	std::vector<PointShim> points{};
+	points.reserve(this->size());
+	for (size_t i{}; i < this->size(); ++i)
+		points.emplace_back(this->x[i], this->y[i], this->angle[i],
+		    static_cast<PointShim::Type>(this->type[i]));
+
+	return (points);
+}
+
+PointConversionContext::PointConversionContext(
+    const ImageShim &image) :
+    ppi{image.getPPI()},
+    width{image.getWidth()},
+    height{image.getHeight()}
+{
+
+}
+
+template<>
+void
+convertPoints<PointSystem::EFS>(
+    PointSet &points,
+    const PointConversionContext &context)
+{
+	/* Unsigned subtraction, as in PointShim */
+	efsToPixel(points.x.data(), points.size(), context.ppi,
+	    static_cast<uint32_t>(context.width - 1));
+	efsToPixel(points.y.data(), points.size(), context.ppi,
+	    static_cast<uint32_t>(context.height - 1));
+}
+
+template<>
+void
+convertPoints<PointSystem::Legacy>(
+    PointSet &points,
+    const PointConversionContext &context)
+{
+	const size_t count{points.size()};
+
+	efsToPixel(points.x.data(), count, context.ppi,
+	    static_cast<uint32_t>(context.width - 1));
+
+	/* Origin is bottom left */
+	uint32_t *y = points.y.data();
+	efsToPixel(y, count, context.ppi,
+	    static_cast<uint32_t>(context.height - 1));
+	for (size_t i{}; i < count; ++i)
+		y[i] = context.height - y[i];
+
+	// XXX: Is this correct?
+	uint32_t *angle = points.angle.data();
+	for (size_t i{}; i < count; ++i) {
+		const uint32_t rotated = angle[i] + 180;
+		angle[i] = (rotated > 359) ? (rotated - 360) : rotated;
+	}
+}
+
+void
+convertPoints(
+    const PointSystem system,
+    PointSet &points,
+    const PointConversionContext &context)
+{
+	switch (system) {
+	case PointSystem::EFS:
+		convertPoints<PointSystem::EFS>(points, context);
+		break;
+	case PointSystem::Legacy:
+		convertPoints<PointSystem::Legacy>(points, context);
+		break;
+	default:
+		throw std::runtime_error{"Unsupported PointSystem"};
+	}
+}
+
 PointShim::PointShim(
     const unsigned int x,
     const unsigned int y,
@@ -47,28 +199,13 @@ PointShim::convertFromSystemRepresentation(
     const PointSystem system,
     const ImageShim &i)
 {
-	switch (system) {
-	case PointSystem::EFS:
-		this->x_ = efsToPixel(this->x_, i.getPPI(), 0,
-		    i.getWidth() - 1);
-		this->y_ = efsToPixel(this->y_, i.getPPI(), 0,
-		    i.getHeight() - 1);
-		break;
-	case PointSystem::Legacy:
-		this->x_ = efsToPixel(this->x_, i.getPPI(), 0,
-		    i.getWidth() - 1);
-		this->y_ = i.getHeight() - efsToPixel(this->y_, i.getPPI(), 0,
-		    i.getHeight() - 1);
-
-		// XXX: Is this correct?
-		this->angle_ += 180;
-		if (this->angle_ > 359)
-			this->angle_ -= 360;
+	PointSet point{};
+	point.push_back(this->x_, this->y_, this->angle_, this->type_);
+	convertPoints(system, point, PointConversionContext(i));
 
-		break;
-	default:
-		throw std::runtime_error{"Unsupported PointSystem"};
-	}
+	this->x_ = point.x.front();
+	this->y_ = point.y.front();
+	this->angle_ = point.angle.front();
 }
 
 std::string
@@ -100,38 +237,3 @@ getPointSystemName(
 
 	return ("Unknown");
 }
-
-EMSCRIPTEN_BINDINGS(point_shim)
-{
-	emscripten::enum_<PointShim::Type>("MinutiaeType")
-	    .value("RidgeEnding", PointShim::Type::RidgeEnding)
-	    .value("Bifurcation", PointShim::Type::Bifurcation)
-	    .value("Core", PointShim::Type::Core)
-	    .value("Delta", PointShim::Type::Delta)
-	    .value("Other", PointShim::Type::Other)
-	    ;
-
-	emscripten::enum_<PointSystem>("PointSystem")
-	    .value("Legacy", PointSystem::Legacy)
-	    .value("IAFIS", PointSystem::IAFIS)
-	    .value("Cogent", PointSystem::Cogent)
-	    .value("Motorola", PointSystem::Motorola)
-	    .value("Sagem", PointSystem::Sagem)
-	    .value("NEC", PointSystem::NEC)
-	    .value("Identix", PointSystem::Identix)
-	    .value("M1", PointSystem::M1)
-	    .value("Other", PointSystem::Other)
-	    .value("EFS", PointSystem::EFS)
-	    ;
-
-	emscripten::class_<PointShim>("PointShim")
-	    .property("x", &PointShim::x_)
-	    .property("y", &PointShim::y_)
-	    .property("angle", &PointShim::angle_)
-	    .property("type", &PointShim::type_)
-	    ;
-
-	emscripten::register_vector<PointShim>("VectorPointShim");
-
-	emscripten::function("getPointSystemName", &getPointSystemName);
-}
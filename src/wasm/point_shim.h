@@ -11,6 +11,11 @@
 #ifndef POINT_SHIM_H_
 #define POINT_SHIM_H_
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
 #include <string>
 #include <type_traits>
 #include <vector>
@@ -60,8 +65,12 @@ enum class PointSystem
 	EFS
 };
 
+/** Number of PointSystem values (which are contiguous from 0) */
+static constexpr size_t PointSystemCount{
+    static_cast<size_t>(PointSystem::EFS) + 1};
+
 /** @return Human-readable name for a PointSystem. */
-static std::string
+std::string
 getPointSystemName(
     const PointSystem system);
 
@@ -76,7 +85,8 @@ public:
 		Bifurcation,
 		Core,
 		Delta,
-		Other = 0
+		/** Type not recorded, or not one of the above */
+		Other
 	};
 
 	/**********************************************************************/
@@ -150,4 +160,109 @@ efsToPixel(
 	return (static_cast<T>(val));
 }
 
+/**
+ * @brief
+ * Minutiae stored as a structure of arrays.
+ *
+ * @details
+ * Each member holds one property of every point, so conversions run as
+ * simple loops over contiguous values that the compiler can vectorize, and
+ * JavaScript can read each property as a typed array.
+ */
+struct PointSet
+{
+	/** System the points were recorded in */
+	PointSystem system{PointSystem::Other};
+
+	std::vector<uint32_t> x{};
+	std::vector<uint32_t> y{};
+	std::vector<uint32_t> angle{};
+	/** PointShim::Type of each point */
+	std::vector<uint8_t> type{};
+
+	/** @return Number of points */
+	size_t
+	size()
+	    const;
+
+	/** @return true if there are no points */
+	bool
+	empty()
+	    const;
+
+	/** Reserve space for `count` points */
+	void
+	reserve(
+	    const size_t count);
+
+	/** Append a point */
+	void
+	push_back(
+	    const uint32_t pointX,
+	    const uint32_t pointY,
+	    const uint32_t pointAngle,
+	    const PointShim::Type pointType);
+
+	/** @return Points as individual PointShims */
+	std::vector<PointShim>
+	toPointShims()
+	    const;
+};
+
+/** Image properties used to convert points, computed once per image. */
+struct PointConversionContext
+{
+	/** Obtain properties from `image` */
+	explicit PointConversionContext(
+	    const ImageShim &image);
+
+	uint16_t ppi{};
+	uint32_t width{};
+	uint32_t height{};
+};
+
+/**
+ * @brief
+ * Convert a set of points from `System`'s representation to pixels.
+ *
+ * @param points
+ * Points to convert, in place.
+ * @param context
+ * Properties of the image the points describe.
+ *
+ * @note
+ * Specialized for PointSystem::EFS and PointSystem::Legacy. Results match
+ * PointShim::convertFromSystemRepresentation().
+ */
+template<PointSystem System>
+void
+convertPoints(
+    PointSet &points,
+    const PointConversionContext &context);
+
+template<>
+void
+convertPoints<PointSystem::EFS>(
+    PointSet &points,
+    const PointConversionContext &context);
+
+template<>
+void
+convertPoints<PointSystem::Legacy>(
+    PointSet &points,
+    const PointConversionContext &context);
+
+/**
+ * @brief
+ * Convert a set of points from `system`'s representation to pixels.
+ *
+ * @throw std::runtime_error
+ * Conversion from `system` not possible or unknown.
+ */
+void
+convertPoints(
+    const PointSystem system,
+    PointSet &points,
+    const PointConversionContext &context);
+
 #endif /* POINT_SHIM_H_ */
@@ -0,0 +1,113 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include "profile.h"
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+
+#if defined(__EMSCRIPTEN__)
+#include <emscripten.h>
+#endif
+
+/** Spans, oldest first, and what is needed to add to them */
+struct Profile
+{
+	std::mutex mutex{};
+	std::deque<ProfileSpan> spans{};
+	AllocationCounter allocationCounter{};
+};
+
+static Profile&
+getInstance()
+{
+	static Profile profile{};
+	return (profile);
+}
+
+/** @return Milliseconds since an arbitrary, fixed point */
+static double
+now()
+{
+#if defined(__EMSCRIPTEN__)
+	return (emscripten_get_now());
+#else
+	return (std::chrono::duration<double, std::milli>(
+	    std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+/** @return Allocations made so far, or 0 if not counted */
+static uint64_t
+getAllocationCount()
+{
+	const auto counter = getInstance().allocationCounter;
+	return ((counter == nullptr) ? 0 : counter());
+}
+
+/** Depth of the innermost open span on this thread */
+static thread_local uint32_t openSpans{};
+
+ScopedSpan::ScopedSpan(
+    const char *name) :
+    name_{name},
+    depth_{openSpans++},
+    allocations_{getAllocationCount()}
+{
+	/* Last, so setup is not timed */
+	this->start_ = now();
+}
+
+ScopedSpan::~ScopedSpan()
+{
+	const double end = now();
+	const uint64_t allocations = getAllocationCount() - this->allocations_;
+	--openSpans;
+
+	auto &profile = getInstance();
+	const std::lock_guard<std::mutex> lock(profile.mutex);
+	if (profile.spans.size() == MaxProfileSpans)
+		profile.spans.pop_front();
+	profile.spans.push_back({this->name_, this->depth_, this->start_,
+	    end - this->start_, this->bytes_,
+	    static_cast<size_t>(allocations)});
+}
+
+void
+ScopedSpan::setBytes(
+    const size_t bytes)
+{
+	this->bytes_ = bytes;
+}
+
+std::vector<ProfileSpan>
+getProfile()
+{
+	auto &profile = getInstance();
+	const std::lock_guard<std::mutex> lock(profile.mutex);
+	return (std::vector<ProfileSpan>(profile.spans.cbegin(),
+	    profile.spans.cend()));
+}
+
+void
+clearProfile()
+{
+	auto &profile = getInstance();
+	const std::lock_guard<std::mutex> lock(profile.mutex);
+	profile.spans.clear();
+}
+
+void
+setAllocationCounter(
+    AllocationCounter counter)
+{
+	getInstance().allocationCounter = counter;
+}
@@ -0,0 +1,102 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/** Most recent spans retained by the profile */
+static constexpr size_t MaxProfileSpans{512};
+
+/** One timed phase of work. */
+struct ProfileSpan
+{
+	/** Phase name, e.g., "decode" */
+	std::string name{};
+	/** Nesting depth, 0 for outermost spans */
+	uint32_t depth{};
+	/**
+	 * Start, in milliseconds. Under Emscripten, this is the same clock as
+	 * performance.now().
+	 */
+	double start{};
+	/** Duration, in milliseconds */
+	double duration{};
+	/** Bytes produced or consumed by the phase, if set */
+	size_t bytes{};
+	/** Allocations made during the phase (including nested spans) */
+	size_t allocations{};
+};
+
+/**
+ * @brief
+ * Record the duration of the enclosing scope.
+ *
+ * @details
+ * The span is added to the profile when the ScopedSpan is destroyed, so
+ * nested spans appear before the spans enclosing them.
+ */
+class ScopedSpan
+{
+public:
+	/**
+	 * @param name
+	 * Phase name. Not copied until the span ends.
+	 */
+	explicit ScopedSpan(
+	    const char *name);
+
+	~ScopedSpan();
+
+	ScopedSpan(const ScopedSpan&) = delete;
+	ScopedSpan&
+	operator=(const ScopedSpan&) = delete;
+
+	/** Set the number of bytes the phase produced or consumed */
+	void
+	setBytes(
+	    const size_t bytes);
+
+private:
+	const char *name_{};
+	uint32_t depth_{};
+	double start_{};
+	size_t bytes_{};
+	uint64_t allocations_{};
+};
+
+/** @return Spans recorded since the last clearProfile(), oldest first */
+std::vector<ProfileSpan>
+getProfile();
+
+/** Discard all recorded spans */
+void
+clearProfile();
+
+/** @return Number of allocations made so far */
+using AllocationCounter = uint64_t (*)();
+
+/**
+ * @brief
+ * Set how allocations are counted.
+ *
+ * @param counter
+ * Function returning the number of allocations made so far, e.g., from a
+ * replacement operator new. Allocations are reported as 0 if not set.
+ */
+void
+setAllocationCounter(
+    AllocationCounter counter);
+
+#endif /* PROFILE_H_ */